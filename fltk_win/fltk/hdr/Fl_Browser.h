@@ -28,6 +28,8 @@
 #include "Fl_Image.h"
 
 struct FL_BLINE;
+class Fl_Browser_Index; // private class declared in src/Fl_Browser_Index.h
+struct Fl_Browser_Loader; // private struct defined in src/Fl_Browser_load.cpp
 
 /**
   The Fl_Browser widget displays a scrolling list of text
@@ -87,13 +89,21 @@ class FL_EXPORT Fl_Browser : public Fl_Browser_ {
 
   FL_BLINE *first;              // the array of lines
   FL_BLINE *last;
-  FL_BLINE *cache;
-  int cacheline;                // line number of cache
+  Fl_Browser_Index *index_;     // line number <-> line
   int lines;                    // Number of lines
-  int full_height_;
+  int full_height_;             // sum of the lines' heights, w/o linespacing()
   const int* column_widths_;
   char format_char_;            // alternative to @-sign
   char column_char_;            // alternative to tab
+  char *arena_;                 // blocks of lines allocated by load()
+  int arena_left_;              // free bytes in the first block
+  Fl_Browser_Loader *loader_;   // load_async() in progress, or 0
+
+  FL_BLINE *arena_line(const char *text, int len);
+  void free_arena();
+  int load_lines(int blocks);
+  void cancel_load();
+  static void load_cb(void *v);
 
 protected:
 
@@ -116,6 +126,7 @@ protected:
       \see swap(int,int), item_swap()
    */
   void item_swap(void *a, void *b) FL_OVERRIDE { swap((FL_BLINE*)a, (FL_BLINE*)b); }
+  void item_reorder(void **items, int n) FL_OVERRIDE;
   /** Return the item at specified \p line.
       \param[in] line The line of the item to return. (1 based)
       \returns The item, or NULL if line out of range.
@@ -128,6 +139,8 @@ protected:
   void insert(int line, FL_BLINE* item);
   int lineno(void *item) const ;
   void swap(FL_BLINE *a, FL_BLINE *b);
+  void measure(FL_BLINE *l);
+  void update_heights();
 
 public:
 
@@ -136,6 +149,11 @@ public:
   void insert(int line, const char* newtext, void* d = 0);
   void move(int to, int from);
   int  load(const char* filename);
+  int  load_async(const char* filename);
+  /**
+    Returns 1 while load_async() is adding lines, 0 otherwise.
+  */
+  int  loading() const { return loader_ != 0; }
   void swap(int a, int b);
   void clear();
 
@@ -158,6 +176,17 @@ public:
   */
   void textsize(Fl_Fontsize newSize);
 
+  /**
+    Gets the default text font for the lines in the browser.
+  */
+  Fl_Font textfont() const { return Fl_Browser_::textfont(); }
+
+  /*
+    Sets the default text font for the lines in the browser to font.
+    Defined and documented in Fl_Browser.cxx
+  */
+  void textfont(Fl_Font font);
+
   int topline() const ;
   /** For internal use only? */
   enum Fl_Line_Position { TOP, BOTTOM, MIDDLE };
@@ -210,7 +239,7 @@ public:
   /**
     The destructor deletes all list items and destroys the browser.
    */
-  ~Fl_Browser() { clear(); }
+  ~Fl_Browser();
 
   /**
     Gets the current format code prefix character, which by default is '\@'.
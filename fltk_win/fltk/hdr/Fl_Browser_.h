@@ -36,6 +36,7 @@
 #define FL_SORT_ASCENDING       0       /**< sort browser items in ascending alphabetic order. */
 #define FL_SORT_DESCENDING      1       /**< sort in descending order */
 #define FL_SORT_CASEINSENSITIVE 0x2     /**< sort case insensitively */
+#define FL_SORT_NUMERIC         0x4     /**< sort runs of digits by their numeric value */
 
 /**
   This is the base class for browsers.  To be useful it must be
@@ -162,6 +163,7 @@ protected:
     \param[in] a,b The two items to be swapped.
    */
   virtual void item_swap(void *a,void *b) { (void)a; (void)b; }
+  virtual void item_reorder(void **items, int n);
   /**
     This method must be provided by the subclass
     to return the item for the specified \p index.
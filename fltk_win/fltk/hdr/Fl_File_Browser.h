@@ -57,7 +57,7 @@ public:
   /**    Sets or gets the size of the icons. The default size is 20 pixels.  */
   uchar         iconsize() const { return (iconsize_); }
   /**    Sets or gets the size of the icons. The default size is 20 pixels.  */
-  void          iconsize(uchar s) { iconsize_ = s; redraw(); }
+  void          iconsize(uchar s) { iconsize_ = s; update_heights(); redraw(); }
 
   /**
     Sets or gets the filename filter. The pattern matching uses
@@ -73,7 +73,7 @@ public:
   const char    *filter() const { return (pattern_); }
   int           load(const char *directory, Fl_File_Sort_F *sort = fl_numericsort);
   Fl_Fontsize  textsize() const { return Fl_Browser::textsize(); }
-  void          textsize(Fl_Fontsize s) { Fl_Browser::textsize(s); iconsize_ = (uchar)(3 * s / 2); }
+  void          textsize(Fl_Fontsize s) { iconsize_ = (uchar)(3 * s / 2); Fl_Browser::textsize(s); }
 
   /**
     Sets or gets the file browser type, FILES or
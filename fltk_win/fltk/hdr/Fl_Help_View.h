@@ -33,6 +33,9 @@
 #include "filename.h"
 
 class Fl_Shared_Image;
+class HV_Display_List; // internal class declared in src/Fl_Help_View.cpp
+class HV_Text_Index;   // internal class declared in src/Fl_Help_View.cpp
+struct HV_Format_State; // internal struct declared in src/Fl_Help_View.cpp
 //
 // Fl_Help_Func type - link callback function for files...
 //
@@ -55,6 +58,8 @@ struct Fl_Help_Block {
   int           line[32];       // Left starting position for each line
   int           ol;             // is ordered list <OL> element
   int           ol_num;         // item number in ordered list
+  int           dl_first,       // First display list entry, -1 if not recorded
+                dl_last;        // Last display list entry + 1
 };
 
 //
@@ -132,7 +137,11 @@ struct Fl_Help_Target {
 /**
   The Fl_Help_View widget displays HTML text. Most HTML 2.0
   elements are supported, as well as a primitive implementation of tables.
-  GIF, JPEG, and PNG images are displayed inline.
+  GIF, JPEG, and PNG images are displayed inline. With async_images(1),
+  image files that are not in the Fl_Shared_Image pool yet are decoded
+  on a worker thread; the document is laid out with the WIDTH and HEIGHT
+  of such an image (or a placeholder size) and formatted again when the
+  image arrives.
 
   Supported HTML tags:
      - A: HREF/NAME
@@ -214,6 +223,9 @@ class FL_EXPORT Fl_Help_View : public Fl_Group {        // Help viewer widget
   int           nblocks_,               ///< Number of blocks/paragraphs
                 ablocks_;               ///< Allocated blocks
   Fl_Help_Block *blocks_;               ///< Blocks
+  HV_Display_List *dlist_;              ///< What draw() draws for the blocks
+  HV_Text_Index *tindex_;               ///< Text and matches of find()
+  HV_Format_State *fstate_;             ///< Where format() stopped
 
   Fl_Help_Func  *link_;                 ///< Link transform function
 
@@ -261,28 +273,41 @@ class FL_EXPORT Fl_Help_View : public Fl_Group {        // Help viewer widget
   void          add_target(const char *n, int yy);
   static int    compare_targets(const Fl_Help_Target *t0, const Fl_Help_Target *t1);
   int           do_align(Fl_Help_Block *block, int line, int xx, int a, int &l);
+  void          record_block(Fl_Help_Block *block);
+  void          free_display_list();
 protected:
   void          draw() FL_OVERRIDE;
 private:
   void          format();
+  int           format_step(int ylimit, double seconds);
+  void          format_finish();
+  static void   format_cb(void *v);
+  void          update_scrollbars();
   void          format_table(int *table_width, int *columns, const char *table);
   void          free_data();
   int           get_align(const char *p, int a);
   const char    *get_attr(const char *p, const char *n, char *buf, int bufsize);
   Fl_Color      get_color(const char *n, Fl_Color c);
   Fl_Shared_Image *get_image(const char *name, int W, int H);
+  const char    *image_file(const char *name, char *temp, int tempsize);
+  void          format_image(const char *tag, const char *name, int &W, int &H);
+  int           image_ready(const char *file);
+  static void   image_done(Fl_Shared_Image *img, void *v);
+  static void   images_cb(void *v);
   int           get_length(const char *l);
 public:
   int           handle(int) FL_OVERRIDE;
 private:
 
-  void          hv_draw(const char *t, int x, int y, int entity_extra_length = 0);
+  void          hv_draw(const char *t, int x, int y, int w, int entity_extra_length = 0);
   char          begin_selection();
   char          extend_selection();
   void          end_selection(int c=0);
   void          clear_global_selection();
   Fl_Help_Link  *find_link(int, int);
   void          follow_link(Fl_Help_Link*);
+  HV_Text_Index *text_index();
+  void          show_match(int i);
 
 public:
 
@@ -295,6 +320,13 @@ public:
   const char    *filename() const { if (filename_[0]) return (filename_);
                                         else return ((const char *)0); }
   int           find(const char *s, int p = 0);
+  int           find_all(const char *s);
+  int           find_next();
+  int           find_prev();
+  void          clear_matches();
+  int           matches() const;
+  int           match(int i) const;
+  int           current_match() const;
   /**
     This method assigns a callback function to use when a link is
     followed or a file is loaded (via Fl_Help_View::load()) that
@@ -323,8 +355,7 @@ public:
   /** Gets the size of the help view. */
   int           size() const { return (size_); }
   void          size(int W, int H) { Fl_Widget::size(W, H); }
-  /** Sets the default text color. */
-  void          textcolor(Fl_Color c) { if (textcolor_ == defcolor_) textcolor_ = c; defcolor_ = c; }
+  void          textcolor(Fl_Color c);
   /** Returns the current default text color. */
   Fl_Color      textcolor() const { return (defcolor_); }
   /** Sets the default text font. */
@@ -383,6 +414,8 @@ public:
   void scrollbar_size(int newSize) {
       scrollbar_size_ = newSize;
   }
+  void async_images(int val);
+  int async_images() const;
 };
 
 #endif // !Fl_Help_View_H
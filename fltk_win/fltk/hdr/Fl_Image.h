@@ -35,7 +35,10 @@ class Fl_RGB_Image;
 */
 enum Fl_RGB_Scaling {
   FL_RGB_SCALING_NEAREST = 0, ///< default RGB image scaling algorithm
-  FL_RGB_SCALING_BILINEAR     ///< more accurate, but slower RGB image scaling algorithm
+  FL_RGB_SCALING_BILINEAR,    ///< more accurate, but slower RGB image scaling algorithm
+  FL_RGB_SCALING_BOX,         ///< area averaging, for shrinking by large factors
+  FL_RGB_SCALING_CATMULL_ROM, ///< bicubic (Catmull-Rom) filter, sharper than bilinear
+  FL_RGB_SCALING_LANCZOS      ///< Lanczos filter with 3 lobes, the sharpest and slowest
 };
 
 
@@ -310,7 +313,9 @@ public:
   // set the image drawing size
   virtual void scale(int width, int height, int proportional = 1, int can_expand = 0);
   /** Sets what algorithm is used when resizing a source image to draw it.
-   The default algorithm is FL_RGB_SCALING_BILINEAR.
+   The default algorithm is FL_RGB_SCALING_BILINEAR. Bilinear scaling
+   aliases when shrinking images by more than 2x, FL_RGB_SCALING_BOX,
+   FL_RGB_SCALING_CATMULL_ROM or FL_RGB_SCALING_LANCZOS don't.
    Drawing an Fl_Image is sometimes performed by first resizing the source image
    and then drawing the resized copy. This occurs, e.g., when drawing to screen under X11
    without Xrender support after having called scale().
@@ -72,6 +72,16 @@ typedef Fl_Image *(*Fl_Shared_Handler)(const char *name,
                                        uchar *header,
                                        int headerlen);
 
+class Fl_Shared_Image;
+
+/** Callback (typedef) of Fl_Shared_Image::get_async().
+
+  \p img is the requested image, which must be released when no longer
+  needed, or NULL if it could not be loaded. \p data is the pointer that
+  was given to Fl_Shared_Image::get_async().
+*/
+typedef void (*Fl_Shared_Image_Cb)(Fl_Shared_Image *img, void *data);
+
 /**
   This class supports caching, loading, and drawing of image files.
 
@@ -86,6 +96,12 @@ typedef Fl_Image *(*Fl_Shared_Handler)(const char *name,
   A refcount is used to determine if a released image is to be destroyed
   with delete.
 
+  If a cache size is set with cache_size(), released images are kept in
+  the pool until its images take up more memory than that, and those
+  unused for the longest time are deleted first. Getting such an image
+  again does not need to load the file. Then the resized copies drawn
+  for the scale factor of the screen are also kept in the pool, see draw().
+
   \see fl_register_image()
   \see Fl_Shared_Image::get()
   \see Fl_Shared_Image::find()
@@ -106,14 +122,34 @@ protected:
   static Fl_Shared_Handler *handlers_;  // Additional format handlers
   static int    num_handlers_;          // Number of format handlers
   static int    alloc_handlers_;        // Allocated format handlers
+  static size_t cache_size_;            // Bytes of released images kept in the pool
+  static size_t cache_bytes_;           // Bytes of all images in the pool
+  static long   cache_hits_;            // Requests found in the pool
+  static long   cache_misses_;          // Requests that loaded the file
+  static long   cache_evictions_;       // Released images deleted by the cache
+  static Fl_Shared_Image *lru_first_;   // Most recently released image
+  static Fl_Shared_Image *lru_last_;    // Least recently released image
 
   const char    *name_;                 // Name of image file
   int           original_;              // Original image?
   int           refcount_;              // Number of times this image has been used
   Fl_Image      *image_;                // The image that is shared
   int           alloc_image_;           // Was the image allocated?
+  size_t        bytes_;                 // Size of the image data
+  int           pooled_;                // Is the image in the pool?
+  int           scaling_;               // RGB_scaling() of a resized copy, -1 for any
+  int           cacheable_;             // Can it be found again by its name?
+  Fl_Shared_Image *lru_prev_;           // More recently released image
+  Fl_Shared_Image *lru_next_;           // Less recently released image
 
   static int    compare(Fl_Shared_Image **i0, Fl_Shared_Image **i1);
+  static Fl_Shared_Image *find_(const char *name, int W, int H, int same_scaling = 0);
+  static int    lower_bound_(const char *name, int W, int H);
+  void          remove_();
+  static void   trim_cache_();
+  void          lru_add_();
+  void          lru_remove_();
+  void          destroy_();
 
   // Use get() and release() to load/delete images in memory...
   Fl_Shared_Image();
@@ -122,6 +158,9 @@ protected:
   void add();
   void update();
   Fl_Shared_Image *copy_(int W, int H) const;
+  static Fl_Shared_Image *get_(const char *name, Fl_Image *img, int W, int H);
+  static void   async_run_(void *v);
+  static void   async_done_(void *v);
 
 public:
 #ifdef SHIM_DEBUG
@@ -132,7 +171,8 @@ public:
   const char    *name() { return name_; }
 
   /** Returns the number of references of this shared image.
-    When reference is below 1, the image is deleted.
+    When reference is below 1, the image is deleted, or kept in the
+    cache (see cache_size()).
   */
   int           refcount() { return refcount_; }
 
@@ -165,11 +205,29 @@ public:
   static Fl_Shared_Image *find(const char *name, int W = 0, int H = 0);
   static Fl_Shared_Image *get(const char *name, int W = 0, int H = 0);
   static Fl_Shared_Image *get(Fl_RGB_Image *rgb, int own_it = 1);
+  static void           get_async(const char *name, int W, int H,
+                                  Fl_Shared_Image_Cb cb, void *data = 0);
+  static void           cancel_async(Fl_Shared_Image_Cb cb, void *data);
+  static Fl_Image       *decode(const char *name);
   static Fl_Shared_Image **images();
   static int            num_images();
   static void           add_handler(Fl_Shared_Handler f);
   static void           remove_handler(Fl_Shared_Handler f);
 
+  static void           cache_size(size_t bytes);
+  /** Returns the memory budget of the shared image cache, see cache_size(size_t) */
+  static size_t         cache_size() { return cache_size_; }
+  /** Returns the approximate size in bytes of all images in the pool,
+    in use or cached. */
+  static size_t         cache_bytes() { return cache_bytes_; }
+  /** Returns how many get() requests were found in the pool */
+  static long           cache_hits() { return cache_hits_; }
+  /** Returns how many get() requests had to load the image file */
+  static long           cache_misses() { return cache_misses_; }
+  /** Returns how many released images were deleted to stay within cache_size() */
+  static long           cache_evictions() { return cache_evictions_; }
+  static void           flush_cache();
+
   /**
     Returns a pointer to the internal Fl_Image object.
 
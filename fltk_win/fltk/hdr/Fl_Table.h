@@ -22,17 +22,59 @@
 #include "Fl_Group.h"
 #include "Fl_Scroll.h"
 
-// EXPERIMENTAL
-// We use either std::vector or the private class Fl_Int_Vector
-// depending on the build option FLTK_OPTION_STD or --enable-use_std.
-// This option allows to use std::string and std::vector in FLTK 1.4.x
-
-#if (FLTK_USE_STD)
-#include <vector>
-typedef std::vector<int> Fl_Int_Vector;
-#else
-class Fl_Int_Vector; // private class declared in src/Fl_Int_Vector.h
-#endif
+class Fl_Table_Sizes; // private class declared in src/Fl_Table_Sizes.h
+class Fl_Table_Cache; // private class declared in src/Fl_Table_Cache.h
+class Fl_Table_Sort;  // private class declared in src/Fl_Table_Sort.h
+class Fl_Table_Autosize; // private class declared in src/Fl_Table_Autosize.h
+
+/**
+  Compares two rows of an Fl_Table's data for Fl_Table::sort_rows().
+
+  \p model_a and \p model_b are rows of the application's data (model
+  rows), \p data is the pointer given to sort_rows(). Returns a negative
+  value if \p model_a sorts before \p model_b, a positive value if after,
+  and 0 if they are equal (their order is then kept).
+
+  Called on worker threads while the main thread runs, so it must not
+  call FLTK functions and the data it reads must not change meanwhile.
+*/
+typedef int (Fl_Table_Row_Compare)(int model_a, int model_b, void *data);
+
+/**
+  Supplies the cell data of an Fl_Table in blocks, on worker threads.
+
+  Derive from this class and install it with Fl_Table::data_provider()
+  when cell contents come from a slow source, such as a large file or a
+  database, so that scrolling does not wait for them.
+
+  The table requests blocks of cells covering the visible cells plus a
+  prefetch margin (see Fl_Table::data_prefetch()); fetch() fills them
+  on a worker thread. The subclass's draw_cell() gets the data with
+  Fl_Table::cell_data(), drawing a placeholder for cells that did not
+  arrive yet. When a block arrives only its visible cells are redrawn.
+  At most Fl_Table::data_cache_size() blocks are kept.
+
+  fetch() must not call FLTK functions, and must be safe to run while
+  the main thread runs (and alongside itself if the table uses more
+  than one thread). As for all threaded FLTK programs the application
+  must call Fl::lock() before Fl::run(). A fetch() that is running when
+  the provider is replaced or the table is destroyed is not waited for,
+  so don't delete the provider while it may still be in fetch().
+*/
+class FL_EXPORT Fl_Table_Provider {
+public:
+  /** The destructor. */
+  virtual ~Fl_Table_Provider() { }
+  /**
+    Fetches cells of rows R .. R+nrows-1 and columns C .. C+ncols-1.
+
+    Called on a worker thread. Store a pointer to the data of each cell
+    in cells[r*ncols + c], allocated with malloc() (e.g. with strdup()),
+    or leave it 0 if the cell has no data. The table frees the data with
+    free() when the block leaves the cache.
+  */
+  virtual void fetch(int R, int C, int nrows, int ncols, void **cells) = 0;
+};
 
 /**
   A table of widgets or other content.
@@ -167,8 +209,13 @@ private:
   };
   unsigned int flags_;
 
-  Fl_Int_Vector *_colwidths;            // column widths in pixels
-  Fl_Int_Vector *_rowheights;           // row heights in pixels
+  Fl_Table_Sizes *_colwidths;           // column widths in pixels, indexed by position
+  Fl_Table_Sizes *_rowheights;          // row heights in pixels, indexed by position
+  Fl_Table_Cache *_cache;               // cell data from data_provider()
+  friend class Fl_Table_Cache;
+  Fl_Table_Sort *_sort;                 // view row -> model row, see sort_rows()
+  Fl_Table_Autosize *_autosize;         // see col_autosize()
+  friend class Fl_Table_Autosize;
 
   // number of columns and rows == size of corresponding vectors
   int col_size();                       // size of the column widths vector
@@ -193,6 +240,12 @@ private:
   // Redraw single cell
   void _redraw_cell(TableContext context, int R, int C);
 
+  // Scroll position of the cells last drawn, for blitting on scroll (-1: none)
+  int _drawn_hoff, _drawn_voff;
+  void _scroll_redraw();
+  void _draw_cells_area(int X, int Y, int W, int H);
+  static void _draw_cells_area_cb(void *d, int X, int Y, int W, int H);
+
   void _start_auto_drag();
   void _stop_auto_drag();
   void _auto_drag_cb();
@@ -376,6 +429,18 @@ protected:
                          int X=0, int Y=0, int W=0, int H=0)
   { (void)context; (void)R; (void)C; (void)X; (void)Y; (void)W; (void)H;}                                           // overridden by deriving class
 
+  /**
+    Returns the text of cell \p R, \p C, or 0 if it has none.
+
+    Used by col_autosize() to measure the columns; draw_cell() is not
+    used for this, so subclasses whose columns should fit their contents
+    must override this method. The default returns 0.
+  */
+  virtual const char *cell_text(int R, int C) {
+    (void)R; (void)C;
+    return(0);
+  }
+
   long row_scroll_position(int row);            // find scroll position of row (in pixels)
   long col_scroll_position(int col);            // find scroll position of col (in pixels)
 
@@ -682,25 +747,8 @@ public:
   // Returns the current width of the specified column in pixels.
   int col_width(int col);
 
-  /**
-    Convenience method to set the height of all rows to the
-    same value, in pixels. The screen is redrawn.
-  */
-  void row_height_all(int height) {             // set all row/col heights
-    for ( int r=0; r<rows(); r++ ) {
-      row_height(r, height);
-    }
-  }
-
-  /**
-    Convenience method to set the width of all columns to the
-    same value, in pixels. The screen is redrawn.
-  */
-  void col_width_all(int width) {
-    for ( int c=0; c<cols(); c++ ) {
-      col_width(c, width);
-    }
-  }
+  void row_height_all(int height);              // set all row/col heights
+  void col_width_all(int width);
 
   void row_position(int row);                   // set/get table's current scroll position
   void col_position(int col);
@@ -1068,6 +1116,26 @@ public:
       _scrollbar_size = newSize;
   }
 
+  void data_provider(Fl_Table_Provider *p, int threads = 1);
+  Fl_Table_Provider *data_provider() const;
+  void data_block_size(int rows, int cols);
+  void data_prefetch(int rows, int cols);
+  void data_cache_size(int blocks);
+  int data_cache_size() const;
+  void *cell_data(int R, int C, int *ready = 0);
+  void data_changed();
+
+  void sort_rows(Fl_Table_Row_Compare *cmp, void *data = 0);
+  void unsort_rows();
+  int sorting_rows() const;
+  int row_model(int R) const;
+  int row_view(int M);
+
+  void col_autosize(int col = -1);
+  void col_autosize_sample(int rows);
+  int col_autosize_sample() const;
+  void col_autosize_font(Fl_Font font, Fl_Fontsize size);
+
   /**
     Flag to control if Tab navigates table cells or not.
 
@@ -49,55 +49,54 @@ public:
     SELECT_MULTI                // multiple row selection (default)
   };
 private:
-  // An STL-ish vector without templates
-  class FL_EXPORT CharVector {
-    char *arr;
-    int _size;
+  // A sorted set of row ranges without templates.
+  //    Ranges are half open [start,end), sorted, disjoint and never adjacent.
+  //    If inverted, the ranges hold the rows *not* in the set, so that
+  //    "all rows" or "all rows except a few" take O(1) space.
+  //
+  class FL_EXPORT RowRanges {
+    int *_start;                // first row of each range
+    int *_end;                  // one past the last row of each range
+    int _count;                 // number of ranges
+    int _alloc;                 // number of ranges allocated
+    int _size;                  // number of rows
+    char _inverted;             // 1: ranges are the rows not in the set
     void init() {
-      arr = 0;
-      _size = 0;
+      _start = _end = 0;
+      _count = _alloc = _size = 0;
+      _inverted = 0;
     }
-    void copy(char *newarr, int newsize);
+    int lower(int row) const;
+    void replace(int i, int j, int n, const int *s, const int *e);
+    void add(int a, int b);
+    void remove(int a, int b);
+    RowRanges(const RowRanges&);                // not copyable
+    RowRanges& operator=(const RowRanges&);
   public:
-    CharVector() {                              // CTOR
-      init();
-    }
-    ~CharVector();                              // DTOR
-    CharVector(CharVector&o) {                  // COPY CTOR
+    RowRanges() {                               // CTOR
       init();
-      copy(o.arr, o._size);
-    }
-    CharVector& operator=(CharVector&o) {       // ASSIGN
-      init();
-      copy(o.arr, o._size);
-      return(*this);
-    }
-    char operator[](int x) const {
-      return(arr[x]);
     }
-    char& operator[](int x) {
-      return(arr[x]);
-    }
-    int size() {
+    ~RowRanges();                               // DTOR
+    int size() const {
       return(_size);
     }
     void size(int count);
-    char pop_back() {
-      char tmp = arr[_size-1];
-      _size--;
-      return(tmp);
-    }
-    void push_back(char val) {
-      int x = _size;
-      size(_size+1);
-      arr[x] = val;
+    int get(int row) const;
+    void set(int a, int b, int val);
+    void toggle(int a, int b);
+    void all(int val) {
+      _count = 0;
+      _inverted = val ? 1 : 0;
     }
-    char back() {
-      return(arr[_size-1]);
+    void toggle_all() {
+      _inverted ^= 1;
     }
+    int count(int a, int b) const;
+    int first(int row) const;
+    int ranges(int *first, int *last, int max) const;
   };
 
-  CharVector _rowselect;                // selection flag for each row
+  RowRanges _rowselect;                 // selected rows
 
   // handle() state variables.
   //    Put here instead of local statics in handle(), so more
@@ -177,6 +176,42 @@ public:
    */
   void select_all_rows(int flag=1);     // all rows to a known state
 
+  /**
+   Changes the selection state for rows 'from' through 'to' (inclusive),
+   depending on the value of 'flag'. 0=deselected, 1=select, 2=toggle existing state.
+   Takes time proportional to the number of selected ranges, not rows.
+   */
+  int select_rows(int from, int to, int flag=1); // select state for row range
+  // returns: 0=no change, 1=changed, -1=range err
+
+  /**
+   Returns the number of selected rows.
+   */
+  int selected_row_count() const {
+    return(_rowselect.count(0, _rowselect.size()));
+  }
+
+  /**
+   Returns the first selected row at or after 'row', or -1 if there is none.
+   Use this to iterate over the selected rows:
+   \code
+   for ( int r = table->next_selected_row(0); r >= 0; r = table->next_selected_row(r+1) ) ...
+   \endcode
+   */
+  int next_selected_row(int row) const {
+    return(_rowselect.first(row));
+  }
+
+  /**
+   Returns the selected rows as ranges of consecutive rows in bulk.
+   Stores up to 'max' ranges in ascending order, each from 'first[i]'
+   to 'last[i]' (inclusive). Returns the total number of ranges,
+   which may be more than 'max'; call with max=0 to query the count.
+   */
+  int selected_row_ranges(int *first, int *last, int max) const {
+    return(_rowselect.ranges(first, last, max));
+  }
+
   void clear() FL_OVERRIDE {
     rows(0);            // implies clearing selection
     cols(0);
@@ -103,6 +103,8 @@
  next_selected_item().<BR>
  Items can be found by their pathname using find_item(const char*),
  and an item's pathname can be found with item_pathname().<BR>
+ Displayed items can be found by the start of their label using find_prefix(),
+ which also lets users jump to items by typing once enabled with typeahead(1).<BR>
  The selected items' colors are controlled by selection_color()
  (inherited from Fl_Widget).<BR>
  A hook is provided to allow you to redefine how item's labels are drawn
@@ -128,6 +130,31 @@
  adding the FL_TREE_ITEM_HEIGHT_FROM_WIDGET flag causes widget's height
  to define the widget()'s height.
 
+ \par VIRTUAL TREES
+ Very large hierarchies don't need to be created up front. An item can be
+ marked with Fl_Tree_Item::children_unloaded(1); it then shows an open/close
+ icon, and its children are created by the populate_callback() (or an
+ overridden populate()) when the item is opened, or when an open item
+ scrolls into view. With unload_budget() set, the children of closed
+ populated items are released again, oldest first, so memory stays
+ proportional to what the user has expanded.
+ \par
+ \code
+ void MyPopulate(Fl_Tree_Item *item, void *data) {
+     Fl_Tree *tree = item->tree();
+     for ( ..each child of item in the app's model.. ) {
+         Fl_Tree_Item *child = tree->add(item, name);
+         if ( ..child has children in the model.. ) {
+             child->close();
+             child->children_unloaded(1);
+         }
+     }
+ }
+ [..]
+ tree->populate_callback(MyPopulate);
+ tree->unload_budget(100000);   // keep at most ~100k loaded items
+ \endcode
+
  \par ICONS
  The tree's open/close icons can be redefined with
  Fl_Tree::openicon(), Fl_Tree::closeicon(). User icons
@@ -283,6 +310,13 @@ enum Fl_Tree_Reason {
   FL_TREE_REASON_DRAGGED    = FL_REASON_DRAGGED         ///< an item was dragged into a new place
 };
 
+/// Callback used by virtual trees to create an item's children on demand.
+/// \see Fl_Tree::populate_callback()
+///
+typedef void (Fl_Tree_Populate_Callback)(Fl_Tree_Item*, void*);
+
+struct Fl_Tree_Item_Pool;
+
 class FL_EXPORT Fl_Tree : public Fl_Group {
   friend class Fl_Tree_Item;
   Fl_Tree_Item  *_root;                         // can be null!
@@ -293,7 +327,45 @@ class FL_EXPORT Fl_Tree : public Fl_Group {
   int            _scrollbar_size;               // size of scrollbar trough
   Fl_Tree_Item  *_lastselect;                   // last selected item
   char           _lastpushed;                   // FL_PUSH occurred on: 0=nothing, 1=open/close, 2=usericon, 3=label
+  Fl_Tree_Populate_Callback *_populate_cb;      // creates children of unloaded items (0=none)
+  void          *_populate_data;                // data for populate callback
+  Fl_Tree_Item_Array _unload_queue;             // closed populated items, oldest first
+  Fl_Tree_Item_Array _populate_queue;           // open unloaded items that scrolled into view
+  int            _unload_budget;                // max #loaded items before unloading (0=no limit)
+  int            _loaded_items;                 // #items created by populate()
+  Fl_Tree_Item_Array _selection;                // all selected items (see sort_selection())
+  char           _selection_sorted;             // 1: _selection is in tree order
+  char           _order_valid;                  // 1: items' _order numbers are current
+  char           _label_arena;                  // 1: item labels are stored in arena blocks
+  char         **_arena_blocks;                 // label arena blocks (freed by clear())
+  int            _arena_nblocks;                // #blocks in _arena_blocks
+  int            _arena_left;                   // #bytes unused in last block
+  Fl_Tree_Item_Pool *_item_pool;                // slab allocator for the tree's items (0=none yet)
+  Fl_Tree_Item **_prefix_items;                 // all items sorted by label (see find_prefix())
+  int           *_prefix_min;                   // segment tree: displayed slot first in tree order
+  int            _prefix_total;                 // #items in _prefix_items
+  char           _prefix_valid;                 // 1: _prefix_items is current
+  char           _typeahead_on;                 // 1: typing jumps to matching items
+  char           _typeahead[64];                // text typed so far
+  int            _typeahead_len;                // strlen(_typeahead)
   void fix_scrollbar_order();
+  void enforce_unload_budget();
+  void populate_later(Fl_Tree_Item *item);
+  void unload_later();
+  static void populate_timeout_cb(void *data);
+  void selection_add(Fl_Tree_Item *item);
+  void selection_remove(Fl_Tree_Item *item);
+  void sort_selection();
+  const char *arena_strdup(const char *s);
+  void arena_free();
+  void renumber_items();
+  void build_prefix_index();
+  int prefix_first(int a, int b) const;
+  void prefix_index_set(Fl_Tree_Item *item, int displayed, int propagate=1);
+  void prefix_index_walk(Fl_Tree_Item *item, int shown, int propagate=1);
+  void prefix_index_display(Fl_Tree_Item *item);
+  int typeahead_key(const char *text, int len);
+  static void typeahead_timeout_cb(void *data);
 
 protected:
   Fl_Scrollbar *_vscroll;       ///< Vertical scrollbar
@@ -313,6 +385,7 @@ protected:
 
   // draw() has to be protected per FLTK convention (was public in 1.3.x)
   void draw() FL_OVERRIDE;
+  virtual void populate(Fl_Tree_Item *item);
 
 public:
   Fl_Tree(int X, int Y, int W, int H, const char *L=0);
@@ -348,6 +421,9 @@ public:
   int item_pathname(char *pathname, int pathnamelen, const Fl_Tree_Item *item) const;
   const Fl_Tree_Item* find_clicked(int yonly=0) const;
   Fl_Tree_Item* find_clicked(int yonly=0);
+  Fl_Tree_Item *find_prefix(const char *prefix);
+  void typeahead(int val);
+  int typeahead() const;
   Fl_Tree_Item *item_clicked();
   Fl_Tree_Item *first();
   Fl_Tree_Item *first_visible();                // deprecated in ABI 10303
@@ -477,6 +553,18 @@ public:
   int is_vscroll_visible() const;
   int is_hscroll_visible() const;
 
+  ///////////////////////
+  // virtual tree
+  ///////////////////////
+  void populate_callback(Fl_Tree_Populate_Callback *cb, void *data=0);
+  Fl_Tree_Populate_Callback* populate_callback() const;
+  void* populate_user_data() const;
+  int unload_budget() const;
+  void unload_budget(int nitems);
+  int loaded_items() const;
+  void label_arena(int val);
+  int label_arena() const;
+
   ///////////////////////
   // callback related
   ///////////////////////
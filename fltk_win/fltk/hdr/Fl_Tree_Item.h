@@ -62,32 +62,44 @@
 ///   \image latex Fl_Tree_Item-dimensions.png "Fl_Tree_Item's internal dimensions." width=6cm
 ///
 class Fl_Tree;
+struct Fl_Tree_Item_Pool;
 class FL_EXPORT Fl_Tree_Item {
+  friend class Fl_Tree;
   Fl_Tree                *_tree;                // parent tree
   const char             *_label;               // label (memory managed)
-  Fl_Font                 _labelfont;           // label's font face
-  Fl_Fontsize             _labelsize;           // label's font size
-  Fl_Color                _labelfgcolor;        // label's fg color
-  Fl_Color                _labelbgcolor;        // label's bg color (0xffffffff is 'transparent')
+  unsigned int            _style;               // shared font/color/icon record (see labelfont())
   /// \enum Fl_Tree_Item_Flags
   enum Fl_Tree_Item_Flags {
     OPEN                = 1<<0,         ///> item is open
     VISIBLE             = 1<<1,         ///> item is visible
     ACTIVE              = 1<<2,         ///> item is active
-    SELECTED            = 1<<3          ///> item is selected
+    SELECTED            = 1<<3,         ///> item is selected
+    UNLOADED            = 1<<4,         ///> item has children that are not loaded yet
+    POPULATED           = 1<<5,         ///> children were created by Fl_Tree::populate()
+    UNLOAD_QUEUED       = 1<<6,         ///> closed, waiting in the tree's unload queue
+    LABEL_IN_ARENA      = 1<<7,         ///> label is owned by the tree's label arena
+    LOADED              = 1<<8,         ///> item was created by Fl_Tree::populate()
+    POPULATE_QUEUED     = 1<<9          ///> waiting in the tree's populate queue
   };
   unsigned short _flags;                // misc flags
   int                     _xywh[4];             // xywh of this widget (if visible)
   int                     _collapse_xywh[4];    // xywh of collapse icon (if visible)
   int                     _label_xywh[4];       // xywh of label
   Fl_Widget              *_widget;              // item's label widget (optional)
-  Fl_Image               *_usericon;            // item's user-specific icon (optional)
-  Fl_Image               *_userdeicon;          // deactivated usericon
   Fl_Tree_Item_Array      _children;            // array of child items
   Fl_Tree_Item           *_parent;              // parent item (=0 if root)
   void                   *_userdata;            // user data that can be associated with an item
   Fl_Tree_Item           *_prev_sibling;        // previous sibling (same level)
   Fl_Tree_Item           *_next_sibling;        // next sibling (same level)
+  int                     _selindex;            // index in tree's selection array (if selected)
+  int                     _order;               // position in tree (see Fl_Tree::sort_selection())
+  int                     _prefixslot;          // slot in tree's label index (see Fl_Tree::find_prefix())
+  void update_selection(int val);
+  void update_selection_r(int val);
+  void update_displayed();
+  int mark_loaded(int val);
+  void unarena_labels();
+  static void release_pool(Fl_Tree_Item_Pool *&pool, int tree_gone);
   // Protected methods
 protected:
   void _Init(const Fl_Tree_Prefs &prefs, Fl_Tree *tree);
@@ -105,6 +117,10 @@ public:
   Fl_Tree_Item(Fl_Tree *tree);                  // CTOR -- ABI 1.3.3+
   virtual ~Fl_Tree_Item();                      // DTOR -- ABI 1.3.3+
   Fl_Tree_Item(const Fl_Tree_Item *o);          // COPY CTOR
+  static void *operator new(size_t size);                       // heap allocation
+  static void *operator new(size_t size, Fl_Tree *tree);        // from tree's item pool
+  static void operator delete(void *p);
+  static void operator delete(void *p, Fl_Tree *tree);
   /// The item's x position relative to the window
   int x() const { return(_xywh[0]); }
   /// The item's y position relative to the window
@@ -140,32 +156,12 @@ public:
   /// Retrieve the user-data value that has been assigned to the item.
   inline void* user_data() const { return _userdata; }
 
-  /// Set item's label font face.
-  void labelfont(Fl_Font val) {
-    _labelfont = val;
-    recalc_tree();              // may change tree geometry
-  }
-  /// Get item's label font face.
-  Fl_Font labelfont() const {
-    return(_labelfont);
-  }
-  /// Set item's label font size.
-  void labelsize(Fl_Fontsize val) {
-    _labelsize = val;
-    recalc_tree();              // may change tree geometry
-  }
-  /// Get item's label font size.
-  Fl_Fontsize labelsize() const {
-    return(_labelsize);
-  }
-  /// Set item's label foreground text color.
-  void labelfgcolor(Fl_Color val) {
-    _labelfgcolor = val;
-  }
-  /// Return item's label foreground text color.
-  Fl_Color labelfgcolor() const {
-    return(_labelfgcolor);
-  }
+  void labelfont(Fl_Font val);
+  Fl_Font labelfont() const;
+  void labelsize(Fl_Fontsize val);
+  Fl_Fontsize labelsize() const;
+  void labelfgcolor(Fl_Color val);
+  Fl_Color labelfgcolor() const;
   /// Set item's label text color. Alias for labelfgcolor(Fl_Color)).
   void labelcolor(Fl_Color val) {
      labelfgcolor(val);
@@ -174,18 +170,8 @@ public:
   Fl_Color labelcolor() const {
     return labelfgcolor();
   }
-  /// Set item's label background color.
-  /// A special case is made for color 0xffffffff which uses the parent tree's bg color.
-  void labelbgcolor(Fl_Color val) {
-    _labelbgcolor = val;
-  }
-  /// Return item's label background text color.
-  /// If the color is 0xffffffff, the default behavior is the parent tree's
-  /// bg color will be used. (An overloaded draw_item_content() can override
-  /// this behavior.)
-  Fl_Color labelbgcolor() const {
-    return(_labelbgcolor);
-  }
+  void labelbgcolor(Fl_Color val);
+  Fl_Color labelbgcolor() const;
   /// Assign an FLTK widget to this item.
   void widget(Fl_Widget *val) {
     _widget = val;
@@ -199,6 +185,11 @@ public:
   int children() const {
     return(_children.total());
   }
+  /// Make room for \p 'count' children without reallocating.
+  /// Useful before adding many children at once, e.g. in a populate callback.
+  void reserve_children(int count) {
+    _children.reserve(count);
+  }
   /// Return the child item for the given 'index'.
   Fl_Tree_Item *child(int index) {
     return(_children[index]);
@@ -209,6 +200,24 @@ public:
   int has_children() const {
     return(children());
   }
+  /// Mark this item as having children that are not loaded yet.
+  ///
+  /// Used for 'virtual' trees: the item shows an open/close icon, and its
+  /// children are created by Fl_Tree::populate() when the item is opened,
+  /// or when an open item scrolls into view.
+  ///
+  /// \see load_children(), unload_children(), Fl_Tree::populate_callback()
+  ///
+  void children_unloaded(int val) {
+    set_flag(UNLOADED, val);
+    recalc_tree();              // may change tree geometry
+  }
+  /// See if this item has children that are not loaded yet.
+  int children_unloaded() const {
+    return(is_flag(UNLOADED));
+  }
+  int load_children();
+  int unload_children();
   int find_child(const char *name);
   int find_child(Fl_Tree_Item *item);
   int remove_child(Fl_Tree_Item *item);
@@ -403,57 +412,10 @@ public:
   }
   int is_visible_r() const;
 
-  /// Set the item's user icon to an Fl_Image. Use '0' to disable.
-  /// No internal copy is made, caller must manage icon's memory.
-  ///
-  /// Note, if you expect your items to be deactivated(),
-  /// use userdeicon(Fl_Image*) to set up a 'grayed out' version of your icon
-  /// to be used for display.
-  ///
-  /// \see userdeicon(Fl_Image*)
-  ///
-  void usericon(Fl_Image *val) {
-    _usericon = val;
-    recalc_tree();              // may change tree geometry
-  }
-  /// Get the item's user icon as an Fl_Image. Returns '0' if disabled.
-  Fl_Image *usericon() const {
-    return(_usericon);
-  }
-  /// Set the usericon to draw when the item is deactivated. Use '0' to disable.
-  /// No internal copy is made; caller must manage icon's memory.
-  ///
-  /// To create a typical 'grayed out' version of your usericon image,
-  /// you can do the following:
-  ///
-  /// \code
-  ///      // Create tree + usericon for items
-  ///      Fl_Tree *tree = new Fl_Tree(..);
-  ///      Fl_Image *usr_icon = new Fl_Pixmap(..); // your usericon
-  ///      Fl_Image *de_icon  = usr_icon->copy();  // make a copy, and..
-  ///      de_icon->inactive();                    // make it 'grayed out'
-  ///      ...
-  ///      for ( .. ) {                 // item loop..
-  ///        item = tree->add("...");   // create new item
-  ///        item->usericon(usr_icon);  // assign usericon to items
-  ///        item->userdeicon(de_icon); // assign userdeicon to items
-  ///        ..
-  ///      }
-  /// \endcode
-  ///
-  /// In the above example, the app should 'delete' the two icons
-  /// when they're no longer needed (e.g. after the tree is destroyed)
-  ///
-  /// \version 1.3.4
-  ///
-  void userdeicon(Fl_Image* val) {
-    _userdeicon = val;
-  }
-  /// Return the deactivated version of the user icon, if any.
-  /// Returns 0 if none.
-  Fl_Image* userdeicon() const {
-    return _userdeicon;
-  }
+  void usericon(Fl_Image *val);
+  Fl_Image *usericon() const;
+  void userdeicon(Fl_Image* val);
+  Fl_Image* userdeicon() const;
   //////////////////
   // Events
   //////////////////
@@ -476,7 +438,14 @@ protected:
     if ( flag==OPEN || flag==VISIBLE ) {
       recalc_tree();            // may change tree geometry
     }
+    if ( flag==SELECTED && (val?1:0) != is_flag(SELECTED) ) {
+      update_selection(val);    // keep tree's selection index current
+    }
+    unsigned short was = _flags;
     if ( val ) _flags |= flag; else _flags &= ~flag;
+    if ( (flag==OPEN || flag==VISIBLE) && _flags != was ) {
+      update_displayed();       // keep tree's label index current
+    }
   }
   /// See if flag set. Returns 0 or 1.
   inline int is_flag(unsigned short val) const {
@@ -46,7 +46,7 @@ class FL_EXPORT Fl_Tree_Item_Array {
   Fl_Tree_Item **_items;        // items array
   int _total;                   // #items in array
   int _size;                    // #items *allocated* for array
-  int _chunksize;               // #items to enlarge mem allocation
+  int _chunksize;               // minimum #items to enlarge mem allocation
   enum {
     MANAGE_ITEM = 1             ///> manage the Fl_Tree_Item's internals (internal use only)
   };
@@ -74,6 +74,7 @@ public:
   int deparent(int pos);
   int reparent(Fl_Tree_Item *item, Fl_Tree_Item *newparent, int pos);
   void clear();
+  void reserve(int count);
   void add(Fl_Tree_Item *val);
   void insert(int pos, Fl_Tree_Item *new_item);
   void replace(int pos, Fl_Tree_Item *new_item);
@@ -24,34 +24,21 @@
 #include "../hdr/Fl_Hold_Browser.h"
 #include "../hdr/Fl_Multi_Browser.h"
 #include "../hdr/Fl_Select_Browser.h"
+#include "Fl_Browser_Index.h"
 
 
 // I modified this from the original Forms data to use a linked list
 // so that the number of items in the browser and size of those items
 // is unlimited. The only problem is that the old browser used an
 // index number to identify a line, and it is slow to convert from/to
-// a pointer. I use a cache of the last match to try to speed this up.
+// a pointer. Fl_Browser_Index keeps the lines in order in an array of
+// chunks to convert between them in O(log n).
 
 // Also added the ability to "hide" a line. This sets its height to
 // zero, so the Fl_Browser_ cannot pick it.
 
-#define SELECTED 1
-#define NOTDISPLAYED 2
-
-// WARNING:
-//       Fl_File_Chooser.cxx also has a definition of this structure (FL_BLINE).
-//       Changes to FL_BLINE *must* be reflected in Fl_File_Chooser.cxx as well.
-//       This hack in Fl_File_Chooser should be solved.
-//
-struct FL_BLINE {       // data is in a linked list of these
-  FL_BLINE* prev;
-  FL_BLINE* next;
-  void* data;
-  Fl_Image* icon;
-  short length;         // sizeof(txt)-1, may be longer than string
-  char flags;           // selected, displayed
-  char txt[1];          // start of allocated array
-};
+// FL_BLINE, the data of each line, and its flags are defined in
+// Fl_Browser_Index.h
 
 /**
   Returns the very first item in the list.
@@ -129,13 +116,9 @@ const char *Fl_Browser::item_text(void *item) const {
 /**
   Returns the item for specified \p line.
 
-  Note: This call is slow. It's fine for e.g. responding to user
-  clicks, but slow if called often, such as in a tight sorting loop.
-  Finding an item 'by line' involves a linear lookup on the internal
-  linked list. The performance hit can be significant if the browser's
-  contents is large, and the method is called often (e.g. during a sort).
-  If you're writing a subclass, use the protected methods item_first(),
-  item_next(), etc. to access the internal linked list more efficiently.
+  Finding an item 'by line' takes O(log n) time using an index of the
+  internal linked list. If you're walking all the items in a subclass,
+  the protected methods item_first(), item_next(), etc. are still faster.
 
   \param[in] line The line number of the item to return. (1 based)
   \retval item that was found.
@@ -143,72 +126,40 @@ const char *Fl_Browser::item_text(void *item) const {
   \see item_at(), find_line(), lineno()
 */
 FL_BLINE* Fl_Browser::find_line(int line) const {
-  int n; FL_BLINE* l;
-  if (line == cacheline) return cache;
-  if (cacheline && line > (cacheline/2) && line < ((cacheline+lines)/2)) {
-    n = cacheline; l = cache;
-  } else if (line <= (lines/2)) {
-    n = 1; l = first;
-  } else {
-    n = lines; l = last;
-  }
-  for (; n < line && l; n++) l = l->next;
-  for (; n > line && l; n--) l = l->prev;
-  ((Fl_Browser*)this)->cacheline = line;
-  ((Fl_Browser*)this)->cache = l;
-  return l;
+  return index_->at(line);
 }
 
 /**
   Returns line number corresponding to \p item, or zero if not found.
-  Caveat: See efficiency note in find_line().
   \param[in] item The item to be found
   \returns The line number of the item, or 0 if not found.
   \see item_at(), find_line(), lineno()
 */
 int Fl_Browser::lineno(void *item) const {
-  FL_BLINE* l = (FL_BLINE*)item;
-  if (!l) return 0;
-  if (l == cache) return cacheline;
-  if (l == first) return 1;
-  if (l == last) return lines;
-  if (!cache) {
-    ((Fl_Browser*)this)->cache = first;
-    ((Fl_Browser*)this)->cacheline = 1;
-  }
-  // assume it is near cache, search both directions:
-  FL_BLINE* b = cache->prev;
-  int bnum = cacheline-1;
-  FL_BLINE* f = cache->next;
-  int fnum = cacheline+1;
-  int n = 0;
-  for (;;) {
-    if (b == l) {n = bnum; break;}
-    if (f == l) {n = fnum; break;}
-    if (b) {b = b->prev; bnum--;}
-    if (f) {f = f->next; fnum++;}
-  }
-  ((Fl_Browser*)this)->cache = l;
-  ((Fl_Browser*)this)->cacheline = n;
-  return n;
+  return index_->line((FL_BLINE*)item);
+}
+
+// Free a line unless it belongs to the arena of load()
+static void free_line(FL_BLINE *l) {
+  if (!(l->flags & INARENA)) free(l);
 }
 
 /**
   Removes the item at the specified \p line.
-  Caveat: See efficiency note in find_line().
   You must call redraw() to make any changes visible.
   \param[in] line The line number to be removed. (1 based) Must be in range!
   \returns Pointer to browser item that was removed (and is no longer valid).
+           Lines added by load() are not allocated with malloc(), so this must
+           not be passed to free().
   \see add(), insert(), remove(), swap(int,int), clear()
 */
 FL_BLINE* Fl_Browser::_remove(int line) {
   FL_BLINE* ttt = find_line(line);
   deleting(ttt);
 
-  cacheline = line-1;
-  cache = ttt->prev;
+  index_->remove(line);
   lines--;
-  full_height_ -= item_height(ttt) + linespacing();
+  full_height_ -= ttt->height;
   if (ttt->prev) ttt->prev->next = ttt->next;
   else first = ttt->next;
   if (ttt->next) ttt->next->prev = ttt->prev;
@@ -226,15 +177,13 @@ FL_BLINE* Fl_Browser::_remove(int line) {
 */
 void Fl_Browser::remove(int line) {
   if (line < 1 || line > lines) return;
-  free(_remove(line));
+  free_line(_remove(line));
 }
 
 /**
   Insert specified \p item above \p line.
   If \p line > size() then the line is added to the end.
 
-  Caveat: See efficiency note in find_line().
-
   \param[in] line  The new line will be inserted above this line (1 based).
   \param[in] item  The item to be added.
 */
@@ -261,10 +210,10 @@ void Fl_Browser::insert(int line, FL_BLINE* item) {
     item->prev->next = item;
     n->prev = item;
   }
-  cacheline = line;
-  cache = item;
+  index_->insert(line, item);
   lines++;
-  full_height_ += item_height(item) + linespacing();
+  item->height = item_height(item);
+  full_height_ += item->height;
   redraw_line(item);
 }
 
@@ -323,20 +272,24 @@ void Fl_Browser::text(int line, const char* newtext) {
   if (l > t->length) {
     FL_BLINE* n = (FL_BLINE*)malloc(sizeof(FL_BLINE)+l);
     replacing(t, n);
-    cache = n;
+    index_->replace(t, n);
     n->data = t->data;
     n->icon = t->icon;
     n->length = (short)l;
-    n->flags = t->flags;
+    n->flags = t->flags & ~INARENA;
+    n->height = t->height;
     n->prev = t->prev;
     if (n->prev) n->prev->next = n; else first = n;
     n->next = t->next;
     if (n->next) n->next->prev = n; else last = n;
-    free(t);
+    free_line(t);
     t = n;
   }
   strcpy(t->txt, newtext);
-  redraw_line(t);
+  int old_h = t->height;
+  measure(t);
+  if (t->height != old_h) redraw();             // lines below moved
+  else redraw_line(t);
 }
 
 /**
@@ -478,7 +431,7 @@ int Fl_Browser::item_width(void *item) const {
        incr_height(), full_height()
 */
 int Fl_Browser::full_height() const {
-  return full_height_;
+  return full_height_ + lines * linespacing();
 }
 
 /**
@@ -601,10 +554,18 @@ Fl_Browser::Fl_Browser(int X, int Y, int W, int H, const char *L)
   column_widths_ = no_columns;
   lines = 0;
   full_height_ = 0;
-  cacheline = 0;
+  index_ = new Fl_Browser_Index();
+  arena_ = 0;
+  arena_left_ = 0;
+  loader_ = 0;
   format_char_ = '@';
   column_char_ = '\t';
-  first = last = cache = 0;
+  first = last = 0;
+}
+
+Fl_Browser::~Fl_Browser() {
+  clear();
+  delete index_;
 }
 
 /**
@@ -620,9 +581,9 @@ void Fl_Browser::lineposition(int line, Fl_Line_Position pos) {
 
   FL_BLINE* l;
   for (l=first; l && line>1; l = l->next) {
-    line--; p += item_height(l) + linespacing();
+    line--; p += l->height + linespacing();
   }
-  if (l && (pos == BOTTOM)) p += item_height(l) + linespacing();
+  if (l && (pos == BOTTOM)) p += l->height + linespacing();
 
   int final = p, X, Y, W, H;
   bbox(X, Y, W, H);
@@ -667,10 +628,43 @@ void Fl_Browser::textsize(Fl_Fontsize newSize) {
     return; // avoid recalculation
   Fl_Browser_::textsize(newSize);
   new_list();
+  update_heights();
+}
+
+/**
+  Sets the default text font for the lines in the browser to \p font.
+
+  Like textsize(Fl_Fontsize) this recalculates all item heights, and
+  returns immediately if \p font equals the current textfont().
+*/
+void Fl_Browser::textfont(Fl_Font font) {
+  if (font == textfont())
+    return; // avoid recalculation
+  Fl_Browser_::textfont(font);
+  new_list();
+  update_heights();
+}
+
+/**
+  Measures \p l again with item_height() and updates full_height().
+  Call this after changing anything that affects the height of a line.
+*/
+void Fl_Browser::measure(FL_BLINE *l) {
+  int h = item_height(l);
+  full_height_ += h - l->height;
+  l->height = h;
+}
+
+/**
+  Measures all lines again, e.g. because the font changed.
+  full_height() is kept up to date when lines are added, changed or
+  removed, so this is only needed when all heights change.
+*/
+void Fl_Browser::update_heights() {
   full_height_ = 0;
-  if (lines == 0) return;
-  for (FL_BLINE* itm=(FL_BLINE *)item_first(); itm; itm=(FL_BLINE *)item_next(itm)) {
-    full_height_ += item_height(itm) + linespacing();
+  for (FL_BLINE* l = first; l; l = l->next) {
+    l->height = item_height(l);
+    full_height_ += l->height;
   }
 }
 
@@ -679,15 +673,18 @@ void Fl_Browser::textsize(Fl_Fontsize newSize) {
   \see add(), insert(), remove(), swap(int,int), clear()
 */
 void Fl_Browser::clear() {
+  cancel_load();
   for (FL_BLINE* l = first; l;) {
     FL_BLINE* n = l->next;
-    free(l);
+    free_line(l);
     l = n;
   }
+  free_arena();
   full_height_ = 0;
   first = 0;
   last = 0;
   lines = 0;
+  index_->clear();
   new_list();
 }
 
@@ -769,7 +766,7 @@ void Fl_Browser::show(int line) {
   FL_BLINE* t = find_line(line);
   if (t->flags & NOTDISPLAYED) {
     t->flags &= ~NOTDISPLAYED;
-    full_height_ += item_height(t) + linespacing();
+    measure(t);
     if (Fl_Browser_::displayed(t)) redraw();
   }
 }
@@ -786,8 +783,8 @@ void Fl_Browser::show(int line) {
 void Fl_Browser::hide(int line) {
   FL_BLINE* t = find_line(line);
   if (!(t->flags & NOTDISPLAYED)) {
-    full_height_ -= item_height(t) + linespacing();
     t->flags |= NOTDISPLAYED;
+    measure(t);
     if (Fl_Browser_::displayed(t)) redraw();
   }
 }
@@ -863,9 +860,26 @@ void Fl_Browser::swap(FL_BLINE *a, FL_BLINE *b) {
      if ( bprev ) bprev->next = a; else first = a;
      a->next = bnext;
   }
-  // Disable cache -- we played around with positions
-  cacheline = 0;
-  cache = 0;
+  index_->swap(a, b);
+}
+
+/**
+  Puts the lines in the order of \p items, which holds all lines.
+  Used by sort(): the list is relinked and indexed in one pass.
+  \param[in] items The lines in their new order.
+  \param[in] n The number of lines, size().
+*/
+void Fl_Browser::item_reorder(void **items, int n) {
+  FL_BLINE *prev = 0;
+  for (int i = 0; i < n; i++) {
+    FL_BLINE *l = (FL_BLINE*)items[i];
+    l->prev = prev;
+    if (prev) prev->next = l; else first = l;
+    prev = l;
+  }
+  if (prev) prev->next = 0;
+  last = prev;
+  index_->build(first);
 }
 
 /**
@@ -895,16 +909,11 @@ void Fl_Browser::icon(int line, Fl_Image* icon) {
 
   FL_BLINE* bl = find_line(line);
 
-  int old_h = bl->icon ? bl->icon->h()+2 : 0;   // init with *old* icon height
-  bl->icon = 0;                                 // remove icon, if any
-  int th = item_height(bl);                     // height of text only
-  int new_h = icon ? icon->h()+2 : 0;           // init with *new* icon height
-  if (th > old_h) old_h = th;
-  if (th > new_h) new_h = th;
-  int dh = new_h - old_h;
-  full_height_ += dh;                           // do this *always*
-
+  int old_h = bl->height;
   bl->icon = icon;                              // set new icon
+  measure(bl);
+  int dh = bl->height - old_h;
+
   if (dh>0) {
     redraw();                                   // icon larger than item? must redraw widget
   } else {
@@ -22,6 +22,9 @@
 #include "../hdr/Fl_Browser_.h"
 #include "../hdr/fl_draw.h"
 #include "../hdr/fl_utf8.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
 
 
 // This is the base class for browsers.  To be useful it must be
@@ -981,53 +984,144 @@ Fl_Browser_::Fl_Browser_(int X, int Y, int W, int H, const char* L)
   end();
 }
 
+// An item and its sort key, for Fl_Browser_::sort()
+struct Fl_Browser_Sort_Item {
+  const char *key;
+  void *item;
+};
+
+// Compare strings, with runs of digits compared by their numeric value
+static int natural_cmp(const char *a, const char *b) {
+  while (*a && *b) {
+    if (isdigit(*a & 255) && isdigit(*b & 255)) {
+      while (*a == '0') a++;
+      while (*b == '0') b++;
+      int la = 0, lb = 0;
+      while (isdigit(a[la] & 255)) la++;
+      while (isdigit(b[lb] & 255)) lb++;
+      if (la != lb) return la - lb;             // more digits: larger
+      int r = strncmp(a, b, la);
+      if (r) return r;
+      a += la;
+      b += lb;
+    } else {
+      if (*a != *b) return (*a & 255) - (*b & 255);
+      a++;
+      b++;
+    }
+  }
+  return (*a & 255) - (*b & 255);
+}
+
+static int sort_cmp(const Fl_Browser_Sort_Item &a, const Fl_Browser_Sort_Item &b, int flags) {
+  int r = (flags & FL_SORT_NUMERIC) ? natural_cmp(a.key, b.key) : strcmp(a.key, b.key);
+  return (flags & FL_SORT_DESCENDING) ? -r : r;
+}
+
+// Stable merge sort of v[0..n-1], using tmp[0..n-1]
+static void sort_items(Fl_Browser_Sort_Item *v, Fl_Browser_Sort_Item *tmp, int n, int flags) {
+  int i, width;
+  for (i = 1; i < n; i++) {                     // insertion sort runs of 8
+    if (i % 8 == 0) continue;
+    Fl_Browser_Sort_Item x = v[i];
+    int j = i;
+    for ( ; j % 8 && sort_cmp(v[j-1], x, flags) > 0; j--) v[j] = v[j-1];
+    v[j] = x;
+  }
+  Fl_Browser_Sort_Item *src = v, *dst = tmp;
+  for (width = 8; width < n; width *= 2) {
+    for (int lo = 0; lo < n; lo += 2 * width) {
+      int mid = (lo + width < n) ? lo + width : n;
+      int hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+      int p = lo, q = mid, k = lo;
+      while (p < mid && q < hi)
+        dst[k++] = (sort_cmp(src[q], src[p], flags) < 0) ? src[q++] : src[p++];
+      while (p < mid) dst[k++] = src[p++];
+      while (q < hi) dst[k++] = src[q++];
+    }
+    Fl_Browser_Sort_Item *t = src; src = dst; dst = t;
+  }
+  if (src != v) memcpy(v, src, n * sizeof(Fl_Browser_Sort_Item));
+}
+
 /**
   Sort the items in the browser based on \p flags.
-  item_swap(void*, void*) and item_text(void*) must be implemented for this call.
+  item_text(void*) and item_swap(void*, void*) or item_reorder(void**, int)
+  must be implemented for this call.
+
+  This is a stable sort: items that compare equal keep their order.
+  It takes O(n log n) time: the items and their sort keys (lower-cased
+  once per item for FL_SORT_CASEINSENSITIVE) are collected in an array,
+  sorted, and then put in the new order at once with item_reorder().
+
+  The line at the top of the browser and the focused line stay at the
+  same positions.
+
   \param[in] flags FL_SORT_ASCENDING -- sort in ascending order\n
                    FL_SORT_DESCENDING -- sort in descending order\n
                   FL_SORT_CASEINSENSITIVE -- add this to sort case-insensitively\n
+                  FL_SORT_NUMERIC -- add this to compare runs of digits by value\n
                    Values other than the above will cause undefined behavior\n
                    Other flags may appear in the future.
 */
 void Fl_Browser_::sort(int flags) {
-  //
-  // Simple bubble sort - pure lazyness on my side.
-  //
-  int i, j, n = -1, desc = ((flags&FL_SORT_DESCENDING)==FL_SORT_DESCENDING);
-  bool caseinsensitive = (flags&FL_SORT_CASEINSENSITIVE);
-  void *a =item_first(), *b, *c;
-  if (!a) return;
-  while (a) {
-    a = item_next(a);
-    n++;
+  int i, n = 0, keylen = 0;
+  void *a;
+  for (a = item_first(); a; a = item_next(a)) n++;
+  if (n < 2) return;
+  bool caseinsensitive = (flags&FL_SORT_CASEINSENSITIVE) != 0;
+  Fl_Browser_Sort_Item *v = (Fl_Browser_Sort_Item*)malloc(2 * n * sizeof(Fl_Browser_Sort_Item));
+  int topline = -1, selline = -1;
+  for (a = item_first(), i = 0; a; a = item_next(a), i++) {
+    const char *t = item_text(a);
+    v[i].key = t ? t : "";
+    v[i].item = a;
+    if (a == top_) topline = i;
+    if (a == selection_) selline = i;
+    if (caseinsensitive) keylen += 4 * (int)strlen(v[i].key) + 1;
   }
-  for (i=n; i>0; i--) {
-    char swapped = 0;
-    a = item_first();
-    b = item_next(a);
-    for (j=0; j<i; j++) {
-      const char *ta = item_text(a);
-      const char *tb = item_text(b);
-      c = item_next(b);
-      if (desc) {
-        if ( (caseinsensitive && fl_utf_strcasecmp(ta, tb) < 0) ||
-            (!caseinsensitive && strcmp(ta, tb) < 0) ) {
-          item_swap(a, b);
-          swapped = 1;
-        }
-      } else {
-        if ( (caseinsensitive && fl_utf_strcasecmp(ta, tb) > 0) ||
-            (!caseinsensitive && strcmp(ta, tb) > 0) ) {
-          item_swap(a, b);
-          swapped = 1;
-        }
-      }
-      if (!c) break;
-      b = c; a = item_prev(b);
+  char *keys = 0;
+  if (caseinsensitive) {                        // lower-case the keys once
+    char *k = keys = (char*)malloc(keylen);
+    for (i = 0; i < n; i++) {
+      int l = fl_utf_tolower((const unsigned char*)v[i].key, (int)strlen(v[i].key), k);
+      k[l] = 0;
+      v[i].key = k;
+      k += l + 1;
+    }
+  }
+  sort_items(v, v + n, n, flags);
+  void **items = (void**)v;                     // reuse the array
+  for (i = 0; i < n; i++) items[i] = v[i].item;
+  item_reorder(items, n);
+  // keep the top and focused lines at the same positions:
+  if (topline >= 0) top_ = items[topline];
+  if (selline >= 0) selection_ = items[selline];
+  redraw_lines();
+  free(keys);
+  free(v);
+}
+
+/**
+  Puts the items in the order of \p items, an array of all \p n items
+  of the browser, for sort().
+
+  The default implementation moves each item to its place with
+  item_swap(), so it takes time proportional to n if item_swap() is fast.
+  Subclasses that can relink all items at once should override this.
+  Unlike item_swap(), this need not call swapping(): sort() updates the
+  browser afterwards.
+  \param[in] items The items in their new order.
+  \param[in] n The number of items.
+*/
+void Fl_Browser_::item_reorder(void **items, int n) {
+  void *cur = item_first();
+  for (int i = 0; i < n && cur; i++) {
+    if (cur != items[i]) {
+      item_swap(cur, items[i]);                 // items[i] takes the place of cur
+      cur = items[i];
     }
-    if (!swapped)
-      break;
+    cur = item_next(cur);
   }
 }
 
@@ -0,0 +1,255 @@
+//
+// Line index for the Fl_Browser widget of the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "Fl_Browser_Index.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Max #lines per chunk
+static const int CHUNK = 256;
+
+// A run of consecutive lines
+struct Fl_Browser_Chunk {
+  int index;                    // position in chunks_
+  int n;                        // #lines
+  FL_BLINE *line[CHUNK];
+};
+
+/** Create an empty index. */
+Fl_Browser_Index::Fl_Browser_Index() {
+  chunks_ = 0;
+  nchunks_ = 0;
+  alloc_ = 0;
+  sum_ = 0;
+  size_ = 0;
+}
+
+/** Free the index; the lines are not freed. */
+Fl_Browser_Index::~Fl_Browser_Index() {
+  clear();
+  if (chunks_) free(chunks_);
+  if (sum_) free(sum_);
+}
+
+/** Forget all lines; the lines are not freed. */
+void Fl_Browser_Index::clear() {
+  for (int k = 0; k < nchunks_; k++) free(chunks_[k]);
+  nchunks_ = 0;
+  size_ = 0;
+}
+
+/** Return the number of lines in the chunks before chunk \p k. */
+int Fl_Browser_Index::start(int k) const {
+  int s = 0;
+  for (int i = k; i > 0; i -= i & -i) s += sum_[i];
+  return s;
+}
+
+/** Add \p delta to the size of chunk \p k in the Fenwick tree. */
+void Fl_Browser_Index::add(int k, int delta) {
+  for (int i = k + 1; i <= nchunks_; i += i & -i) sum_[i] += delta;
+}
+
+/**
+  Return the chunk holding the line at 0-based position \p pos < size(),
+  and set \p off to its position in the chunk.
+*/
+int Fl_Browser_Index::find(int pos, int &off) const {
+  int k = 0, mask = 1;
+  while (mask * 2 <= nchunks_) mask *= 2;
+  for ( ; mask; mask >>= 1) {
+    int t = k + mask;
+    if (t <= nchunks_ && sum_[t] <= pos) {
+      k = t;
+      pos -= sum_[t];
+    }
+  }
+  off = pos;
+  return k;
+}
+
+/** Renumber the chunks from chunk \p from on and rebuild the Fenwick tree in O(n). */
+void Fl_Browser_Index::rebuild(int from) {
+  int i;
+  for (i = from; i < nchunks_; i++) chunks_[i]->index = i;
+  for (i = 1; i <= nchunks_; i++) sum_[i] = chunks_[i-1]->n;
+  for (i = 1; i <= nchunks_; i++) {
+    int j = i + (i & -i);
+    if (j <= nchunks_) sum_[j] += sum_[i];
+  }
+}
+
+/** Insert an empty chunk at position \p k; call rebuild() after this. */
+void Fl_Browser_Index::insert_chunk(int k) {
+  if (nchunks_ >= alloc_) {
+    alloc_ = alloc_ ? alloc_ * 2 : 16;
+    chunks_ = (Fl_Browser_Chunk**)realloc(chunks_, alloc_ * sizeof(Fl_Browser_Chunk*));
+    sum_ = (int*)realloc(sum_, (alloc_ + 1) * sizeof(int));
+  }
+  memmove(chunks_ + k + 1, chunks_ + k, (nchunks_ - k) * sizeof(Fl_Browser_Chunk*));
+  chunks_[k] = (Fl_Browser_Chunk*)malloc(sizeof(Fl_Browser_Chunk));
+  chunks_[k]->n = 0;
+  nchunks_++;
+}
+
+/** Free chunk \p k; call rebuild() after this. */
+void Fl_Browser_Index::remove_chunk(int k) {
+  free(chunks_[k]);
+  nchunks_--;
+  memmove(chunks_ + k, chunks_ + k + 1, (nchunks_ - k) * sizeof(Fl_Browser_Chunk*));
+}
+
+/** Return the position of line \p l in its chunk, or -1 if it is not there. */
+int Fl_Browser_Index::slot(const FL_BLINE *l) {
+  const Fl_Browser_Chunk *c = l->chunk;
+  for (int i = 0; i < c->n; i++)
+    if (c->line[i] == l) return i;
+  return -1;
+}
+
+/** Return line \p n (1 based), or 0 if \p n is out of range. */
+FL_BLINE *Fl_Browser_Index::at(int n) const {
+  if (n < 1 || n > size_) return 0;
+  int off, k = find(n - 1, off);
+  return chunks_[k]->line[off];
+}
+
+/** Return the line number of \p l (1 based), or 0 if it is not indexed. */
+int Fl_Browser_Index::line(const FL_BLINE *l) const {
+  if (!l || !l->chunk) return 0;
+  int s = slot(l);
+  if (s < 0) return 0;
+  return start(l->chunk->index) + s + 1;
+}
+
+/**
+  Insert \p l as line \p n (1 based), or as the last line if \p n > size().
+*/
+void Fl_Browser_Index::insert(int n, FL_BLINE *l) {
+  int pos = n < 1 ? 0 : (n > size_ ? size_ : n - 1);
+  int k, off;
+  if (!nchunks_) {
+    insert_chunk(0);
+    rebuild(0);
+  }
+  if (pos == size_) {           // append to the last chunk
+    k = nchunks_ - 1;
+    off = chunks_[k]->n;
+  } else {
+    k = find(pos, off);
+  }
+  Fl_Browser_Chunk *c = chunks_[k];
+  if (c->n == CHUNK) {
+    if (off == CHUNK) {         // at its end: start a new chunk (e.g. add())
+      insert_chunk(k + 1);
+      rebuild(k + 1);
+      k++;
+      off = 0;
+    } else {                    // split it in halves
+      int h = CHUNK / 2;
+      insert_chunk(k + 1);
+      Fl_Browser_Chunk *d = chunks_[k + 1];
+      d->n = CHUNK - h;
+      memcpy(d->line, c->line + h, d->n * sizeof(FL_BLINE*));
+      for (int i = 0; i < d->n; i++) d->line[i]->chunk = d;
+      c->n = h;
+      rebuild(k + 1);
+      if (off > h) {
+        k++;
+        off -= h;
+      }
+    }
+    c = chunks_[k];
+  }
+  memmove(c->line + off + 1, c->line + off, (c->n - off) * sizeof(FL_BLINE*));
+  c->line[off] = l;
+  c->n++;
+  l->chunk = c;
+  add(k, 1);
+  size_++;
+}
+
+/** Remove line \p n (1 based), which must be in range. */
+void Fl_Browser_Index::remove(int n) {
+  int off, k = find(n - 1, off);
+  Fl_Browser_Chunk *c = chunks_[k];
+  c->line[off]->chunk = 0;
+  memmove(c->line + off, c->line + off + 1, (c->n - off - 1) * sizeof(FL_BLINE*));
+  c->n--;
+  size_--;
+  if (c->n == 0) {
+    remove_chunk(k);
+    rebuild(k);
+    return;
+  }
+  add(k, -1);
+  if (k + 1 < nchunks_ && c->n + chunks_[k+1]->n <= CHUNK / 2) {
+    Fl_Browser_Chunk *d = chunks_[k+1]; // merge small neighbors
+    memcpy(c->line + c->n, d->line, d->n * sizeof(FL_BLINE*));
+    for (int i = 0; i < d->n; i++) d->line[i]->chunk = c;
+    c->n += d->n;
+    remove_chunk(k + 1);
+    rebuild(k + 1);
+  }
+}
+
+/** Put line \p with in the place of line \p l. */
+void Fl_Browser_Index::replace(FL_BLINE *l, FL_BLINE *with) {
+  Fl_Browser_Chunk *c = l->chunk;
+  c->line[slot(l)] = with;
+  with->chunk = c;
+  l->chunk = 0;
+}
+
+/** Exchange the places of lines \p a and \p b. */
+void Fl_Browser_Index::swap(FL_BLINE *a, FL_BLINE *b) {
+  Fl_Browser_Chunk *ca = a->chunk, *cb = b->chunk;
+  int sa = slot(a), sb = slot(b);
+  ca->line[sa] = b;
+  cb->line[sb] = a;
+  a->chunk = cb;
+  b->chunk = ca;
+}
+
+/**
+  Index the list of lines starting at \p first, in the order of their
+  next pointers, replacing the current lines. Chunks are filled up.
+*/
+void Fl_Browser_Index::build(FL_BLINE *first) {
+  clear();
+  Fl_Browser_Chunk *c = 0;
+  for (FL_BLINE *l = first; l; l = l->next) {
+    if (!c || c->n == CHUNK) {
+      insert_chunk(nchunks_);
+      c = chunks_[nchunks_ - 1];
+    }
+    c->line[c->n++] = l;
+    l->chunk = c;
+    size_++;
+  }
+  rebuild(0);
+}
+
+/**
+ \}
+ \endcond
+ */
@@ -0,0 +1,111 @@
+//
+// Line index for the Fl_Browser widget of the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#ifndef Fl_Browser_Index_H
+#define Fl_Browser_Index_H
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "../hdr/Fl_Export.h"
+
+class Fl_Image;
+struct Fl_Browser_Chunk;
+
+/** \file src/Fl_Browser_Index.h
+  The lines of an Fl_Browser, and their index by line number.
+*/
+
+// This is the only definition of FL_BLINE: Fl_Browser and Fl_File_Browser
+// both include this file.
+
+#define SELECTED 1      // FL_BLINE::flags
+#define NOTDISPLAYED 2
+#define INARENA 4       // allocated by Fl_Browser::load(), freed by clear()
+
+struct FL_BLINE {       // data is in a linked list of these
+  FL_BLINE* prev;
+  FL_BLINE* next;
+  void* data;
+  Fl_Image* icon;
+  Fl_Browser_Chunk* chunk; // chunk of the index holding this line
+  int height;           // item_height() when last measured, 0 if hidden
+  short length;         // sizeof(txt)-1, may be longer than string
+  char flags;           // selected, displayed
+  char txt[1];          // start of allocated array
+};
+
+/**
+  Finds the lines of an Fl_Browser by line number and vice versa.
+
+  The browser keeps its lines in a doubly linked list of FL_BLINE, which
+  makes walking the lines fast but finding line n slow. This index keeps
+  pointers to the lines, in order, in chunks of at most CHUNK lines; each
+  line points back to its chunk. A Fenwick tree (binary indexed tree) of
+  the chunk sizes gives the first line number of each chunk, so that:
+
+  - at(n) finds line n in O(log n)
+  - line(l) returns the line number of l in O(log n)
+  - insert() and remove() take O(log n) plus moving at most CHUNK
+    pointers, except when a chunk is split or dropped, which renumbers
+    the chunks in O(n / CHUNK)
+  - build() indexes a whole list of lines in O(n)
+
+  \note This class is only for internal use by Fl_Browser.
+*/
+class FL_EXPORT Fl_Browser_Index {
+  Fl_Browser_Chunk **chunks_;   // the chunks, in line order
+  int nchunks_;                 // #chunks
+  int alloc_;                   // #chunks allocated
+  int *sum_;                    // Fenwick tree of the chunk sizes, 1-based
+  int size_;                    // #lines
+  int find(int pos, int &off) const;
+  int start(int k) const;
+  void add(int k, int delta);
+  void rebuild(int from);
+  void insert_chunk(int k);
+  void remove_chunk(int k);
+  static int slot(const FL_BLINE *l);
+  Fl_Browser_Index(const Fl_Browser_Index&);    // not copyable
+  Fl_Browser_Index& operator=(const Fl_Browser_Index&);
+
+public:
+  Fl_Browser_Index();
+  ~Fl_Browser_Index();
+
+  /** Return the number of lines. */
+  int size() const {
+    return size_;
+  }
+  FL_BLINE *at(int n) const;
+  int line(const FL_BLINE *l) const;
+  void insert(int n, FL_BLINE *l);
+  void remove(int n);
+  void replace(FL_BLINE *l, FL_BLINE *with);
+  void swap(FL_BLINE *a, FL_BLINE *b);
+  void build(FL_BLINE *first);
+  void clear();
+};
+
+/**
+ \}
+ \endcond
+ */
+
+#endif // Fl_Browser_Index_H
@@ -17,7 +17,125 @@
 #include "../hdr/Fl.h"
 #include "../hdr/Fl_Browser.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "../hdr/fl_utf8.h"
+#include "Fl_Browser_Index.h"
+
+// Lines longer than this are split
+#define MAXFL_BLINE 1024
+// Bytes read from the file at a time
+#define LOAD_BLOCK 65536
+// Size of the blocks of the arena the lines are allocated from
+#define ARENA_BLOCK 65536
+// The lines in an arena block are aligned to this, which is also the
+// size of the block header (the pointer to the next block)
+#define ARENA_ALIGN 8
+// Seconds spent loading per idle callback of load_async()
+#define LOAD_SLICE 0.01
+
+// The state of a load() in progress
+struct Fl_Browser_Loader {
+  FILE *fl;
+  int n;                        // length of the line being read
+  char line[MAXFL_BLINE];       // the line being read
+  char buf[LOAD_BLOCK];         // the last block read
+};
+
+// Allocate a line from the arena of load(); it is freed by clear()
+FL_BLINE *Fl_Browser::arena_line(const char *text, int len) {
+  int size = ((int)sizeof(FL_BLINE) + len + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+  if (size > arena_left_) {
+    char *b = (char*)malloc(ARENA_BLOCK);
+    *(char**)b = arena_;        // link the blocks for free_arena()
+    arena_ = b;
+    arena_left_ = ARENA_BLOCK - ARENA_ALIGN;
+  }
+  FL_BLINE *l = (FL_BLINE*)(arena_ + ARENA_BLOCK - arena_left_);
+  arena_left_ -= size;
+  l->data = 0;
+  l->icon = 0;
+  l->chunk = 0;
+  l->height = 0;
+  l->length = (short)len;
+  l->flags = INARENA;
+  memcpy(l->txt, text, len);
+  l->txt[len] = 0;
+  return l;
+}
+
+// Free all blocks of the arena
+void Fl_Browser::free_arena() {
+  while (arena_) {
+    char *next = *(char**)arena_;
+    free(arena_);
+    arena_ = next;
+  }
+  arena_left_ = 0;
+}
+
+// Read up to blocks blocks of the file (all if blocks <= 0) and append
+// their lines, updating full_height() and the line index once.
+// Returns 1 if there is more to read, 0 at the end of the file.
+int Fl_Browser::load_lines(int blocks) {
+  Fl_Browser_Loader *ld = loader_;
+  FL_BLINE *head = 0, *tail = 0;
+  int more = 1;
+  for (int b = 0; more && (blocks <= 0 || b < blocks); b++) {
+    size_t got = fread(ld->buf, 1, LOAD_BLOCK, ld->fl);
+    if (got < LOAD_BLOCK) more = 0;     // end of file or error
+    for (size_t i = 0; i <= got; i++) {
+      char c = 0;
+      if (i < got) c = ld->buf[i];
+      else if (more) break;             // the line goes on in the next block
+      if (i == got || c == '\n' || c == 0 || ld->n >= MAXFL_BLINE-1) {
+        FL_BLINE *l = arena_line(ld->line, ld->n);
+        l->prev = tail;
+        l->next = 0;
+        if (tail) tail->next = l; else head = l;
+        tail = l;
+        ld->n = 0;
+        if (i == got || c == '\n' || c == 0) continue;
+      }
+      ld->line[ld->n++] = c;
+    }
+  }
+  if (head) {                           // append the new lines
+    int was_empty = (lines == 0);
+    head->prev = last;
+    if (last) last->next = head; else first = head;
+    last = tail;
+    for (FL_BLINE *l = head; l; l = l->next) {
+      l->height = item_height(l);
+      full_height_ += l->height;
+      if (!was_empty) index_->insert(lines + 1, l);
+      lines++;
+    }
+    if (was_empty) index_->build(first);
+  }
+  return more;
+}
+
+// Stop load_async() and close the file
+void Fl_Browser::cancel_load() {
+  if (!loader_) return;
+  Fl::remove_idle(load_cb, this);
+  fclose(loader_->fl);
+  free(loader_);
+  loader_ = 0;
+}
+
+// Load blocks of the file of load_async() for a while
+void Fl_Browser::load_cb(void *v) {
+  Fl_Browser *b = (Fl_Browser*)v;
+  Fl_Timestamp start = Fl::now();
+  int more;
+  do {
+    more = b->load_lines(1);
+  } while (more && Fl::seconds_since(start) < LOAD_SLICE);
+  if (!more) b->cancel_load();
+  b->redraw();
+}
 
 /**
   Clears the browser and reads the file, adding each line from the file
@@ -26,30 +144,48 @@
   was any error in opening or reading the file, in which case errno
   is set to the system error.  The data() of each line is set
   to NULL.
+
+  The file is read in large blocks and the lines are allocated together,
+  so this is much faster than calling add() for each line.
+  Lines longer than 1023 bytes are split.
   \param[in] filename The filename to load
   \returns 1 if OK, 0 on error (errno has reason)
-  \see add()
+  \see add(), load_async()
 */
 int Fl_Browser::load(const char *filename) {
-#define MAXFL_BLINE 1024
-    char newtext[MAXFL_BLINE];
-    int c;
-    int i;
-    clear();
-    if (!filename || !(filename[0])) return 1;
-    FILE *fl = fl_fopen(filename,"r");
-    if (!fl) return 0;
-    i = 0;
-    do {
-        c = getc(fl);
-        if (c == '\n' || c <= 0 || i>=(MAXFL_BLINE-1)) {
-            newtext[i] = 0;
-            add(newtext);
-            i = 0;
-        } else {
-            newtext[i++] = c;
-        }
-    } while (c >= 0);
-    fclose(fl);
-    return 1;
+  clear();
+  if (!filename || !(filename[0])) return 1;
+  FILE *fl = fl_fopen(filename,"r");
+  if (!fl) return 0;
+  loader_ = (Fl_Browser_Loader*)malloc(sizeof(Fl_Browser_Loader));
+  loader_->fl = fl;
+  loader_->n = 0;
+  load_lines(0);
+  cancel_load();
+  redraw();
+  return 1;
+}
+
+/**
+  Clears the browser and starts reading the file like load(), without
+  waiting for it to be read.
+
+  The lines are added a block at a time while the program is idle, so
+  that the user interface stays responsive while large files are read.
+  loading() returns 1 until the whole file was read. clear() (and thus
+  another load() or load_async()) stops reading the file.
+  \param[in] filename The filename to load
+  \returns 1 if OK, 0 if the file could not be opened (errno has reason)
+  \see load(), loading()
+*/
+int Fl_Browser::load_async(const char *filename) {
+  clear();
+  if (!filename || !(filename[0])) return 1;
+  FILE *fl = fl_fopen(filename,"r");
+  if (!fl) return 0;
+  loader_ = (Fl_Browser_Loader*)malloc(sizeof(Fl_Browser_Loader));
+  loader_->fl = fl;
+  loader_->n = 0;
+  Fl::add_idle(load_cb, this);
+  return 1;
 }
@@ -41,27 +41,10 @@
 #include "flstring.h"
 
 //
-// FL_BLINE definition from "Fl_Browser.cxx"...
+// FL_BLINE definition shared with Fl_Browser...
 //
 
-#define SELECTED 1
-#define NOTDISPLAYED 2
-
-// TODO -- Warning: The definition of FL_BLINE here is a hack.
-//    Fl_File_Browser should not do this. PLEASE FIX.
-//    FL_BLINE should be private to Fl_Browser, and not re-defined here.
-//    For now, make sure this struct is precisely consistent with Fl_Browser.cxx.
-//
-struct FL_BLINE                 // data is in a linked list of these
-{
-  FL_BLINE      *prev;          // Previous item in list
-  FL_BLINE      *next;          // Next item in list
-  void          *data;          // Pointer to data (function)
-  Fl_Image      *icon;          // Pointer to optional icon
-  short         length;         // sizeof(txt)-1, may be longer than string
-  char          flags;          // selected, displayed
-  char          txt[1];         // start of allocated array
-};
+#include "Fl_Browser_Index.h"
 
 
 //
@@ -71,14 +54,8 @@ struct FL_BLINE                 // data is in a linked list of these
 int                                     // O - Height in pixels
 Fl_File_Browser::full_height() const
 {
-  int   i,                              // Looping var
-        th;                             // Total height of list.
-
-
-  for (i = 0, th = 0; i < size(); i ++)
-    th += item_height(find_line(i)) + linespacing();
-
-  return (th);
+  // Fl_Browser keeps the sum of our item_height()s up to date...
+  return (Fl_Browser::full_height());
 }
 
 
@@ -25,6 +25,7 @@
 //   Fl_Help_View::compare_targets() - Compare two targets.
 //   Fl_Help_View::do_align()        - Compute the alignment for a line in a block.
 //   Fl_Help_View::draw()            - Draw the Fl_Help_View widget.
+//   Fl_Help_View::record_block()    - Record the display list of a block.
 //   Fl_Help_View::format()          - Format the help text.
 //   Fl_Help_View::format_table()    - Format a table...
 //   Fl_Help_View::free_data()       - Free memory used for the document.
@@ -50,6 +51,7 @@
 #include "../hdr/Fl_Shared_Image.h"
 #include "../hdr/Fl_Window.h"
 #include "../hdr/Fl_Pixmap.h"
+#include "../hdr/Fl_Graphics_Driver.h"   // fl_graphics_driver
 #include "Fl_Int_Vector.h"
 #include "Fl_String.h"
 
@@ -61,10 +63,14 @@
 #include "flstring.h"
 #include <ctype.h>
 #include <errno.h>
+#include <limits.h>
 #include "../hdr/math.h"
 
 #define MAX_COLUMNS     200
 
+// Seconds spent formatting per call of format() or idle callback
+#define FORMAT_SLICE    0.01
+
 //
 // Typedef the C API sort function type the only way I know how...
 //
@@ -75,6 +81,56 @@ extern "C"
 }
 
 
+//
+// Ids of the HTML elements handled by the formatter, so that an element
+// name is looked up once instead of being compared with each name in turn.
+//
+
+enum {
+  HV_TAG_END_A, HV_TAG_END_B, HV_TAG_END_CENTER, HV_TAG_END_CODE,
+  HV_TAG_END_DL, HV_TAG_END_EM, HV_TAG_END_FONT, HV_TAG_END_H1,
+  HV_TAG_END_H2, HV_TAG_END_H3, HV_TAG_END_H4, HV_TAG_END_H5,
+  HV_TAG_END_H6, HV_TAG_END_HEAD, HV_TAG_END_I, HV_TAG_END_KBD,
+  HV_TAG_END_OL, HV_TAG_END_P, HV_TAG_END_PRE, HV_TAG_END_STRONG,
+  HV_TAG_END_TABLE, HV_TAG_END_TD, HV_TAG_END_TH, HV_TAG_END_TR,
+  HV_TAG_END_TT, HV_TAG_END_U, HV_TAG_END_UL, HV_TAG_END_VAR,
+  HV_TAG_A, HV_TAG_B, HV_TAG_BODY, HV_TAG_BR,
+  HV_TAG_CENTER, HV_TAG_CODE, HV_TAG_DD, HV_TAG_DL,
+  HV_TAG_DT, HV_TAG_EM, HV_TAG_FONT, HV_TAG_H1,
+  HV_TAG_H2, HV_TAG_H3, HV_TAG_H4, HV_TAG_H5,
+  HV_TAG_H6, HV_TAG_HEAD, HV_TAG_HR, HV_TAG_I,
+  HV_TAG_IMG, HV_TAG_KBD, HV_TAG_LI, HV_TAG_OL,
+  HV_TAG_P, HV_TAG_PRE, HV_TAG_STRONG, HV_TAG_TABLE,
+  HV_TAG_TD, HV_TAG_TH, HV_TAG_TITLE, HV_TAG_TR,
+  HV_TAG_TT, HV_TAG_U, HV_TAG_UL, HV_TAG_VAR,
+  HV_TAG_UNKNOWN
+};
+
+// Element names in the order of the ids above, sorted case insensitively
+static const char * const hv_tags[] = {
+  "/A", "/B", "/CENTER", "/CODE", "/DL", "/EM", "/FONT", "/H1",
+  "/H2", "/H3", "/H4", "/H5", "/H6", "/HEAD", "/I", "/KBD",
+  "/OL", "/P", "/PRE", "/STRONG", "/TABLE", "/TD", "/TH", "/TR",
+  "/TT", "/U", "/UL", "/VAR", "A", "B", "BODY", "BR",
+  "CENTER", "CODE", "DD", "DL", "DT", "EM", "FONT", "H1",
+  "H2", "H3", "H4", "H5", "H6", "HEAD", "HR", "I",
+  "IMG", "KBD", "LI", "OL", "P", "PRE", "STRONG", "TABLE",
+  "TD", "TH", "TITLE", "TR", "TT", "U", "UL", "VAR",
+};
+
+/* Returns the id of the element name \p name (e.g. "TD" or "/TD"), or HV_TAG_UNKNOWN. */
+static int hv_tag(const char *name) {
+  int lo = 0, hi = HV_TAG_UNKNOWN;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    int c = strcasecmp(name, hv_tags[mid]);
+    if (c == 0) return mid;
+    if (c < 0) hi = mid;
+    else lo = mid + 1;
+  }
+  return HV_TAG_UNKNOWN;
+}
+
 //
 // Local functions...
 //
@@ -227,16 +283,17 @@ Fl_Color Fl_Help_View::hv_selection_text_color;
 
 /*
  * This function must be optimized for speed!
+ * The width w of the text t is measured when the display list is recorded.
  */
-void Fl_Help_View::hv_draw(const char *t, int x, int y, int entity_extra_length)
+void Fl_Help_View::hv_draw(const char *t, int x, int y, int w, int entity_extra_length)
 {
   if (selected && current_view==this && current_pos<selection_last && current_pos>=selection_first) {
     Fl_Color c = fl_color();
     fl_color(hv_selection_color);
-    int w = (int)fl_width(t);
+    int sw = w;
     if (current_pos+(int)strlen(t)<selection_last)
-      w += (int)fl_width(' ');
-    fl_rectf(x, y+fl_descent()-fl_height(), w, fl_height());
+      sw += (int)fl_width(' ');
+    fl_rectf(x, y+fl_descent()-fl_height(), sw, fl_height());
     fl_color(hv_selection_text_color);
     fl_draw(t, x, y);
     fl_color(c);
@@ -244,7 +301,6 @@ void Fl_Help_View::hv_draw(const char *t, int x, int y, int entity_extra_length)
     fl_draw(t, x, y);
   }
   if (draw_mode) {
-    int w = (int)fl_width(t);
     if (mouse_x>=x && mouse_x<x+w) {
       if (mouse_y>=y-fl_height()+fl_descent()&&mouse_y<=y+fl_descent()) {
         int f = (int) current_pos;
@@ -261,6 +317,118 @@ void Fl_Help_View::hv_draw(const char *t, int x, int y, int entity_extra_length)
   }
 }
 
+// [Internal class HV_Width_Cache]
+
+/* Note: Don't use Doxygen docs for this internal class.
+
+  Internal class to remember the widths of the words measured by format(),
+  format_table() and record_block(), by font, size and text.
+
+  Formatting measures every word of the document, and it does so again
+  for each width of the widget and when a table makes the document wider.
+  With the cache each distinct word is measured once. The cache is shared
+  by all Fl_Help_View widgets; it is emptied when it gets too large and
+  when another graphics driver (e.g. of a printer) measures the text.
+*/
+
+class HV_Width_Cache {
+  struct Entry {
+    unsigned    hash;           // Hash of font, size and text, 0 if unused
+    Fl_Font     font;
+    Fl_Fontsize size;
+    int         text,           // Offset of the text in text_
+                len,            // Length of the text
+                width;          // Its width
+  };
+  Entry         *table_;        // Hash table, alloc_ is a power of 2
+  int           size_,          // Number of entries used
+                alloc_;         // Number of entries
+  char          *text_;         // The text of all entries
+  int           ntext_,         // Bytes used in text_
+                atext_;         // Bytes allocated for text_
+  Fl_Graphics_Driver *driver_;  // Driver that measured the widths
+
+  void grow();
+
+public:
+  HV_Width_Cache() : table_(0), size_(0), alloc_(0), text_(0), ntext_(0), atext_(0), driver_(0) { }
+  ~HV_Width_Cache() {
+    if (table_) free(table_);
+    if (text_) free(text_);
+  }
+
+  void clear() {
+    if (table_) memset(table_, 0, alloc_ * sizeof(Entry));
+    size_  = 0;
+    ntext_ = 0;
+  }
+
+  int width(const char *t, int len);
+};
+
+// Limit of the number of words in the cache
+static const int HV_WIDTH_CACHE_MAX = 65536;
+
+static HV_Width_Cache hv_width_cache;
+
+// double the size of the hash table
+void HV_Width_Cache::grow() {
+  int i, n = alloc_;
+  Entry *old = table_;
+  alloc_ = alloc_ ? alloc_ * 2 : 1024;
+  table_ = (Entry *)calloc(alloc_, sizeof(Entry));
+  for (i = 0; i < n; i++) {
+    if (!old[i].hash) continue;
+    int k = old[i].hash & (alloc_ - 1);
+    while (table_[k].hash) k = (k + 1) & (alloc_ - 1);
+    table_[k] = old[i];
+  }
+  if (old) free(old);
+}
+
+// return the width of len bytes of t in the current font
+int HV_Width_Cache::width(const char *t, int len) {
+  Fl_Font f = fl_font();
+  Fl_Fontsize s = fl_size();
+  unsigned h = 2166136261U ^ (unsigned)f ^ ((unsigned)s << 16);
+  int i, k;
+
+  for (i = 0; i < len; i++)     // FNV-1a
+    h = (h ^ (unsigned char)t[i]) * 16777619U;
+  if (!h) h = 1;
+
+  if (driver_ != fl_graphics_driver || size_ >= HV_WIDTH_CACHE_MAX) {
+    clear();
+    driver_ = fl_graphics_driver;
+  }
+  if (2 * (size_ + 1) > alloc_) grow();
+
+  for (k = h & (alloc_ - 1); table_[k].hash; k = (k + 1) & (alloc_ - 1)) {
+    const Entry &e = table_[k];
+    if (e.hash == h && e.font == f && e.size == s && e.len == len &&
+        !memcmp(text_ + e.text, t, len))
+      return e.width;
+  }
+
+  if (ntext_ + len > atext_) {
+    while (ntext_ + len > atext_) atext_ = atext_ ? atext_ * 2 : 16384;
+    text_ = (char *)realloc(text_, atext_);
+  }
+  Entry &e = table_[k];
+  e.hash  = h;
+  e.font  = f;
+  e.size  = s;
+  e.text  = ntext_;
+  e.len   = len;
+  e.width = (int)fl_width(t, len);
+  memcpy(text_ + ntext_, t, len);
+  ntext_ += len;
+  size_ ++;
+  return e.width;
+}
+
+// [End of internal class HV_Width_Cache]
+
 // [Internal class HV_Edit_Buffer]
 
 // Debug: set to 1 for basic debugging, 2 for more, 0 for none
@@ -298,7 +466,7 @@ public:
 
   // string width of the entire buffer contents
   int width() {
-    return (int)fl_width(c_str());
+    return hv_width_cache.width(c_str(), size());
   }
 
 #if (DEBUG_EDIT_BUFFER)
@@ -336,6 +504,392 @@ void HV_Edit_Buffer::print(const char *text) {
 
 // [End of internal class HV_Edit_Buffer]
 
+// [Internal class HV_Display_List]
+
+/* Note: Don't use Doxygen docs for this internal class.
+
+  Internal class to keep what Fl_Help_View::draw() draws for each block.
+
+  The text of a block is parsed and measured once, the first time the block
+  is drawn after format(), and turned into a list of positioned text runs,
+  lines, rectangles and images in document coordinates (see record_block()).
+  Redrawing and scrolling just replay the entries of the visible blocks.
+*/
+
+enum {
+  HV_TEXT,      // text run of text_ at x, y, w wide
+  HV_LINE,      // horizontal line from x to w at y
+  HV_FILL,      // filled rectangle x, y, w, h
+  HV_RECT,      // rectangle outline x, y, w, h
+  HV_IMAGE      // image at x, y
+};
+
+struct HV_Draw_Op {
+  int           type;           // HV_TEXT, HV_LINE, ...
+  Fl_Font       font;           // Font and size of HV_TEXT
+  Fl_Fontsize   size;
+  Fl_Color      color;          // Drawing color
+  int           x, y, w, h;     // Position and size in the document
+  int           pos;            // Offset of HV_TEXT in value() for the selection
+  int           extra;          // Extra entity length of HV_TEXT, see hv_draw()
+  int           text;           // Offset of HV_TEXT in text_
+  Fl_Shared_Image *image;       // Image of HV_IMAGE
+};
+
+class HV_Display_List {
+  HV_Draw_Op    *ops_;          // The entries
+  int           nops_,          // Number of entries
+                aops_;          // Allocated entries
+  char          *text_;         // The nul terminated strings of all text runs
+  int           ntext_,         // Bytes used in text_
+                atext_;         // Bytes allocated for text_
+public:
+  HV_Display_List() : ops_(0), nops_(0), aops_(0), text_(0), ntext_(0), atext_(0) { }
+  ~HV_Display_List() {
+    if (ops_) free(ops_);
+    if (text_) free(text_);
+  }
+
+  // forget all entries, keeping the memory
+  void clear() {
+    nops_ = 0;
+    ntext_ = 0;
+  }
+
+  int size() const { return nops_; }
+  const HV_Draw_Op &op(int i) const { return ops_[i]; }
+  const char *text(const HV_Draw_Op &o) const { return text_ + o.text; }
+
+  // add an entry of the current color
+  HV_Draw_Op &add(int type, int x, int y, int w, int h) {
+    if (nops_ >= aops_) {
+      aops_ = aops_ ? aops_ * 2 : 256;
+      ops_ = (HV_Draw_Op *)realloc(ops_, sizeof(HV_Draw_Op) * aops_);
+    }
+    HV_Draw_Op &o = ops_[nops_++];
+    memset(&o, 0, sizeof(HV_Draw_Op));
+    o.type  = type;
+    o.color = fl_color();
+    o.x = x; o.y = y; o.w = w; o.h = h;
+    return o;
+  }
+
+  // add a text run in the current font and color
+  void add_text(const char *t, int x, int y, int pos, int extra = 0) {
+    int len = (int)strlen(t);
+    if (ntext_ + len + 1 > atext_) {
+      while (ntext_ + len + 1 > atext_) atext_ = atext_ ? atext_ * 2 : 4096;
+      text_ = (char *)realloc(text_, atext_);
+    }
+    HV_Draw_Op &o = add(HV_TEXT, x, y, hv_width_cache.width(t, len), 0);
+    o.font  = fl_font();
+    o.size  = fl_size();
+    o.pos   = pos;
+    o.extra = extra;
+    o.text  = ntext_;
+    memcpy(text_ + ntext_, t, len + 1);
+    ntext_ += len + 1;
+  }
+
+  void add_image(Fl_Shared_Image *img, int x, int y) {
+    add(HV_IMAGE, x, y, 0, 0).image = img;
+  }
+};
+
+// [End of internal class HV_Display_List]
+
+// [Internal class HV_Text_Index]
+
+/* Note: Don't use Doxygen docs for this internal class.
+
+  Internal class to search the text of the document, see Fl_Help_View::find().
+
+  The text of all blocks is projected once per document into plain text:
+  elements are dropped, entities are decoded to UTF-8, runs of whitespace
+  become a single space, ASCII letters are folded to lower case, and the
+  blocks are separated by a nul byte so that no match spans two blocks.
+  For each byte the offset of its source in value() is kept.
+
+  search() finds all matches of a string in one pass (Boyer-Moore-Horspool)
+  and keeps them sorted, so that the match at or after a position and the
+  match that overlaps a text run of draw() are found by binary search.
+*/
+
+class HV_Text_Index {
+  char  *text_;                 // The projected text
+  int   *src_;                  // Offset in value() of each byte of text_
+  int   ntext_, atext_;         // Used and allocated bytes
+  int   built_;                 // The text is projected
+  char  *query_;                // The string of the last search(), folded
+  int   qlen_;                  // Length of query_
+  int   *match_;                // Offsets in text_ of the matches
+  int   nmatch_, amatch_;       // Number of matches and allocated entries
+  int   current_;               // Current match, -1 if none
+  int   highlight_;             // draw() shows the matches
+
+  void put(char c, int src) {
+    if (ntext_ >= atext_) {
+      atext_ = atext_ ? atext_ * 2 : 4096;
+      text_ = (char *)realloc(text_, atext_);
+      src_  = (int *)realloc(src_, atext_ * sizeof(int));
+    }
+    text_[ntext_] = c;
+    src_[ntext_++] = src;
+  }
+
+  // fold ASCII letters to lower case, see the note above
+  static char fold(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+  }
+
+public:
+
+  HV_Text_Index()
+    : text_(0), src_(0), ntext_(0), atext_(0), built_(0), query_(0),
+      qlen_(0), match_(0), nmatch_(0), amatch_(0), current_(-1), highlight_(0) { }
+
+  ~HV_Text_Index() {
+    free(text_);
+    free(src_);
+    free(query_);
+    free(match_);
+  }
+
+  // forget the text and the matches of the document
+  void clear() {
+    ntext_ = 0;
+    built_ = 0;
+    free(query_);
+    query_ = 0;
+    nmatch_ = 0;
+    current_ = -1;
+  }
+
+  int built() const { return built_; }
+
+  // project the text of the blocks of value
+  void build(const char *value, const Fl_Help_Block *blocks, int nblocks) {
+    const Fl_Help_Block *b;
+    const char  *p;
+    char        u[8];
+    int         i, n, c, space;
+
+    ntext_ = 0;
+    for (b = blocks; b < blocks + nblocks; b ++) {
+      if (ntext_ > 0) put(0, -1);
+      for (p = b->start, space = 1; p < b->end && *p; ) {
+        if (*p == '<') {
+          if (strncmp(p + 1, "!--", 3) == 0) {
+            const char *e = strstr(p + 4, "-->");
+            p = e ? e + 3 : b->end;
+            continue;
+          }
+          // <BR> breaks the line like whitespace, other elements join the text
+          if ((p[1] == 'b' || p[1] == 'B') && (p[2] == 'r' || p[2] == 'R') &&
+              !isalnum(p[3] & 255) && !space) {
+            put(' ', (int)(p - value));
+            space = 1;
+          }
+          while (p < b->end && *p && *p != '>') p ++;
+          if (*p == '>') p ++;
+        } else if (isspace(*p & 255)) {
+          if (!space) put(' ', (int)(p - value));
+          space = 1;
+          p ++;
+        } else if (*p == '&' && (c = quote_char(p + 1)) >= 0) {
+          if (c == ' ') {                       // &nbsp;
+            if (!space) put(' ', (int)(p - value));
+            space = 1;
+          } else {
+            n = fl_utf8encode((unsigned int)c, u);
+            for (i = 0; i < n; i ++) put(fold(u[i]), (int)(p - value));
+            space = 0;
+          }
+          p = strchr(p + 1, ';') + 1;
+        } else {
+          put(fold(*p), (int)(p - value));
+          space = 0;
+          p ++;
+        }
+      }
+    }
+    built_ = 1;
+  }
+
+  // find all matches of s, return their number
+  int search(const char *s) {
+    int         skip[256];
+    int         i, m, space;
+    const unsigned char *t;
+
+    free(query_);
+    query_ = (char *)malloc(strlen(s) + 1);
+    for (m = 0, space = 1; *s; s ++) {  // fold s like the text
+      if (isspace(*s & 255)) {
+        if (!space) query_[m ++] = ' ';
+        space = 1;
+      } else {
+        query_[m ++] = fold(*s);
+        space = 0;
+      }
+    }
+    while (m > 0 && query_[m - 1] == ' ') m --;
+    query_[m] = 0;
+    qlen_ = m;
+
+    nmatch_  = 0;
+    current_ = -1;
+    if (m == 0 || m > ntext_) return 0;
+
+    for (i = 0; i < 256; i ++) skip[i] = m;
+    for (i = 0; i < m - 1; i ++) skip[query_[i] & 255] = m - 1 - i;
+
+    t = (const unsigned char *)text_;
+    for (i = 0; i <= ntext_ - m; ) {
+      if (t[i + m - 1] == (query_[m - 1] & 255) && !memcmp(t + i, query_, m - 1)) {
+        if (nmatch_ >= amatch_) {
+          amatch_ = amatch_ ? amatch_ * 2 : 64;
+          match_ = (int *)realloc(match_, amatch_ * sizeof(int));
+        }
+        match_[nmatch_ ++] = i;
+        i += m;
+      } else {
+        i += skip[t[i + m - 1]];
+      }
+    }
+    return nmatch_;
+  }
+
+  // check whether s is the string of the last search()
+  int searched(const char *s) const {
+    int m = 0, space = 1;
+    if (!query_) return 0;
+    for ( ; *s; s ++) {
+      if (isspace(*s & 255)) {
+        if (!space && query_[m] == ' ') m ++;
+        else if (!space) return 0;
+        space = 1;
+      } else {
+        if (query_[m] != fold(*s)) return 0;
+        m ++;
+        space = 0;
+      }
+    }
+    return query_[m] == 0;
+  }
+
+  int matches() const { return nmatch_; }
+  // offset in value() of the first and after the last byte of match i
+  int start(int i) const { return src_[match_[i]]; }
+  int end(int i) const { return src_[match_[i] + qlen_ - 1] + 1; }
+
+  int current() const { return current_; }
+  void current(int i) { current_ = i; }
+  int highlight() const { return highlight_ && nmatch_ > 0; }
+  void highlight(int h) { highlight_ = h; }
+
+  // index of the first match that starts at or after offset pos in value()
+  int first_after(int pos) const {
+    int lo = 0, hi = nmatch_;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (start(mid) < pos) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+  // index of a match that overlaps offsets from..to-1 of value(), or -1
+  int overlap(int from, int to) const {
+    int lo = 0, hi = nmatch_;
+    while (lo < hi) {                   // first match that ends after from
+      int mid = (lo + hi) / 2;
+      if (end(mid) <= from) lo = mid + 1;
+      else hi = mid;
+    }
+    return (lo < nmatch_ && start(lo) < to) ? lo : -1;
+  }
+};
+
+// [End of internal class HV_Text_Index]
+
+
+// [Internal struct HV_Image_Job]
+
+/* Note: Don't use Doxygen docs for this internal struct.
+
+  An image file of the document that is loaded with
+  Fl_Shared_Image::get_async(), see image_ready(). The jobs of a document
+  are kept until free_data(), which cancels those still loading and
+  releases the images of the others.
+*/
+
+struct HV_Image_Job {
+  Fl_Help_View  *view;          // View that wants the image
+  char          *file;          // Image file name
+  Fl_Shared_Image *shared;      // The loaded image, if any
+  int           done;           // Loading is finished
+  HV_Image_Job  *next;          // Next job of the document
+};
+
+// [End of internal struct HV_Image_Job]
+
+
+// [Internal struct HV_Format_State]
+
+/* Note: Don't use Doxygen docs for this internal struct.
+
+  The state of Fl_Help_View::format_step() between two steps.
+
+  format() lays out the part of the document in view and stops when its
+  time slice is used up; the remainder is formatted in idle callbacks
+  (see format_cb()). Until then the height of the document is estimated
+  from the bytes formatted so far, and draw() only draws the blocks that
+  are complete.
+*/
+
+struct HV_Format_State {
+  int           busy;           // Formatting is not finished
+  int           restart;        // Start over with the next step
+  int           formatted;      // Number of blocks that are complete
+  int           length;         // Length of the document
+  Fl_Help_Font_Stack fstack;    // Font stack of the formatter
+  Fl_Help_Block *block;         // Current block
+  int           cells[MAX_COLUMNS],
+                                // Cells in the current row...
+                row;            // Current table row (block number)
+  const char    *ptr;           // Pointer into block
+  HV_Edit_Buffer buf;           // Text buffer
+  char          linkdest[1024]; // Link destination
+  int           xx, yy, ww, hh; // Size of current text fragment
+  int           line;           // Current line in block
+  int           links;          // Links for current line
+  Fl_Font       font;
+  Fl_Fontsize   fsize;          // Current font and size
+  Fl_Color      fcolor;         // Current font color
+  unsigned char border;         // Draw border?
+  int           talign,         // Current alignment
+                newalign,       // New alignment
+                head,           // In the <HEAD> section?
+                pre,            // <PRE> text?
+                needspace;      // Do we need whitespace?
+  int           table_width,    // Width of table
+                table_offset;   // Offset of table
+  int           column,         // Current table column number
+                columns[MAX_COLUMNS];
+                                // Column widths
+  Fl_Color      tc, rc;         // Table/row background color
+  fl_margins    margins;        // Left margin stack...
+  Fl_Int_Vector OL_num;         // if nonnegative, in OL mode and this is the item number
+  Fl_Int_Vector images;         // Sorted offsets of the <IMG> elements whose image was loaded
+  HV_Image_Job  *jobs;          // Image files decoded on worker threads
+  int           async_images;   // Decode images on worker threads? (see async_images())
+
+  HV_Format_State() : busy(0), restart(1), formatted(0), length(0), jobs(0), async_images(0) { }
+};
+
+// [End of internal struct HV_Format_State]
+
 
 /** Adds a text block to the list. */
 Fl_Help_Block *                                 // O - Pointer to new block
@@ -372,6 +926,7 @@ Fl_Help_View::add_block(const char   *s,        // I - Pointer to start of block
   temp->h       = hh;
   temp->border  = border;
   temp->bgcolor = bgcolor_;
+  temp->dl_first = -1;
   nblocks_ ++;
 
   return (temp);
@@ -496,23 +1051,12 @@ Fl_Help_View::do_align(Fl_Help_Block *block,    // I - Block to add to
 void
 Fl_Help_View::draw()
 {
-  int                   i;              // Looping var
-  const Fl_Help_Block   *block;         // Pointer to current block
-  const char            *ptr,           // Pointer to text in block
-                        *attrs;         // Pointer to start of element attributes
-  HV_Edit_Buffer        buf;            // Text buffer
-  char                  attr[1024];     // Attribute buffer
-  int                   xx, yy, ww, hh; // Current positions and sizes
-  int                   line;           // Current line
-  Fl_Font               font;
-  Fl_Fontsize           fsize;          // Current font and size
-  Fl_Color              fcolor;         // current font color
-  int                   head, pre,      // Flags for text
-                        needspace;      // Do we need whitespace?
+  int                   i, j, k;        // Looping vars
+  Fl_Help_Block         *block;         // Pointer to current block
+  int                   ww, hh;         // Current sizes
+  int                   dx, dy;         // Offset of the document in the window
   Fl_Boxtype            b = box() ? box() : FL_DOWN_BOX;
                                         // Box to draw...
-  int                   underline,      // Underline text?
-                        xtra_ww;        // Extra width for underlined space between words
 
   DEBUG_FUNCTION(__LINE__,__FUNCTION__);
 
@@ -567,456 +1111,454 @@ Fl_Help_View::draw()
                ww - Fl::box_dw(b), hh - Fl::box_dh(b));
   fl_color(textcolor_);
 
-  // Draw all visible blocks...
-  for (i = 0, block = blocks_; i < nblocks_; i ++, block ++)
+  // Draw all visible blocks, recording the ones not drawn since format()...
+  dx = x() - leftline_;
+  dy = y() - topline_;
+
+  for (i = 0, block = blocks_; i < fstate_->formatted; i ++, block ++)
     if ((block->y + block->h) >= topline_ && block->y < (topline_ + h()))
     {
-      line      = 0;
-      xx        = block->line[line];
-      yy        = block->y - topline_;
-      hh        = 0;
-      pre       = 0;
-      head      = 0;
-      needspace = 0;
-      underline = 0;
+      if (block->dl_first < 0)
+        record_block(block);
 
-      initfont(font, fsize, fcolor);
-      // byte length difference between html entity (encoded by &...;) and
-      // UTF-8 encoding of same character
-      int entity_extra_length = 0;
-      for (ptr = block->start, buf.clear(); ptr < block->end;)
+      for (j = block->dl_first; j < block->dl_last; j ++)
       {
-        if ((*ptr == '<' || isspace((*ptr)&255)) && buf.size() > 0)
-        {
-          if (!head && !pre)
-          {
-            // Check width...
-            ww = buf.width();
+        const HV_Draw_Op &op = dlist_->op(j);
 
-            if (needspace && xx > block->x)
-              xx += (int)fl_width(' ');
+        fl_color(op.color);
 
-            if ((xx + ww) > block->w)
+        switch (op.type)
+        {
+          case HV_TEXT :
+              if (op.font != fl_font() || op.size != fl_size())
+                fl_font(op.font, op.size);
+              if (tindex_->highlight())
+              {
+                // Highlight the text runs that overlap a match, see find_all();
+                // a run ends where the next one starts...
+                int to = (int) (block->end - value_), m;
+
+                for (k = j + 1; k < block->dl_last; k ++)
+                  if (dlist_->op(k).type == HV_TEXT)
+                  {
+                    to = dlist_->op(k).pos;
+                    break;
+                  }
+
+                if ((m = tindex_->overlap(op.pos, to)) >= 0)
+                {
+                  fl_color(m == tindex_->current() ? fl_color_average(FL_YELLOW, FL_RED, 0.6f) : FL_YELLOW);
+                  fl_rectf(op.x + dx, op.y + dy + fl_descent() - fl_height(), op.w, fl_height());
+                  fl_color(op.color);
+                }
+              }
+              current_pos = op.pos;
+              hv_draw(dlist_->text(op), op.x + dx, op.y + dy, op.w, op.extra);
+              break;
+          case HV_LINE :
+              fl_xyline(op.x + dx, op.y + dy, op.w + dx);
+              break;
+          case HV_FILL :
+          case HV_RECT :
             {
-              if (line < 31)
-                line ++;
-              xx = block->line[line];
-              yy += hh;
-              hh = 0;
-            }
-
-            hv_draw(buf.c_str(), xx + x() - leftline_, yy + y(), entity_extra_length);
-            buf.clear();
-            entity_extra_length = 0;
-            if (underline) {
-              xtra_ww = isspace((*ptr)&255)?(int)fl_width(' '):0;
-              fl_xyline(xx + x() - leftline_, yy + y() + 1,
-                        xx + x() - leftline_ + ww + xtra_ww);
-            }
-            current_pos = (int) (ptr-value_);
-
-            xx += ww;
-            if ((fsize + 2) > hh)
-              hh = fsize + 2;
+              int tx = op.x - leftline_, ty = op.y - topline_;
+              int tw = op.w, th = op.h;
 
-            needspace = 0;
-          }
-          else if (pre)
-          {
-            while (isspace((*ptr)&255))
-            {
-              if (*ptr == '\n')
+              if (tx < 0)
               {
-                hv_draw(buf.c_str(), xx + x() - leftline_, yy + y());
-                if (underline) fl_xyline(xx + x() - leftline_, yy + y() + 1,
-                                         xx + x() - leftline_ + buf.width());
-                buf.clear();
-                current_pos = (int) (ptr-value_);
-                if (line < 31)
-                  line ++;
-                xx = block->line[line];
-                yy += hh;
-                hh = fsize + 2;
+                tw += tx;
+                tx  = 0;
               }
-              else if (*ptr == '\t')
+
+              if (ty < 0)
               {
-                // Do tabs every 8 columns...
-                buf += ' '; // add at least one space
-                while (buf.size() & 7)
-                  buf += ' ';
-              }
-              else {
-                buf += ' ';
+                th += ty;
+                ty  = 0;
               }
-              if ((fsize + 2) > hh)
-                hh = fsize + 2;
 
-              ptr ++;
+              if (op.type == HV_FILL)
+                fl_rectf(tx + x(), ty + y(), tw, th);
+              else
+                fl_rect(tx + x(), ty + y(), tw, th);
+              break;
             }
+          case HV_IMAGE :
+              op.image->draw(op.x + dx, op.y + dy);
+              break;
+        }
+      }
+    }
 
-            if (buf.size() > 0)
-            {
-              hv_draw(buf.c_str(), xx + x() - leftline_, yy + y());
-              ww = buf.width();
-              buf.clear();
-              if (underline) fl_xyline(xx + x() - leftline_, yy + y() + 1,
-                                       xx + x() - leftline_ + ww);
-              xx += ww;
-              current_pos = (int) (ptr-value_);
-            }
+  fl_pop_clip();
+} // draw()
 
-            needspace = 0;
-          }
-          else
-          {
-            buf.clear();
 
-            while (isspace((*ptr)&255))
-              ptr ++;
-            current_pos = (int) (ptr-value_);
-          }
-        }
+/**
+  Records what draw() draws for the block \p block in the display list.
 
-        if (*ptr == '<')
-        {
-          ptr ++;
+  This parses the text of the block like format() and measures it again
+  with the fonts of the block, but only once after each format().
+*/
+void
+Fl_Help_View::record_block(Fl_Help_Block *block)
+{
+  const char            *ptr,           // Pointer to text in block
+                        *attrs;         // Pointer to start of element attributes
+  HV_Edit_Buffer        buf;            // Text buffer
+  char                  attr[1024];     // Attribute buffer
+  int                   xx, yy, ww, hh; // Current positions and sizes
+  int                   line;           // Current line
+  Fl_Font               font;
+  Fl_Fontsize           fsize;          // Current font and size
+  Fl_Color              fcolor;         // current font color
+  int                   head, pre,      // Flags for text
+                        needspace;      // Do we need whitespace?
+  int                   underline,      // Underline text?
+                        xtra_ww;        // Extra width for underlined space between words
+  int                   pos;            // Position in value() for the selection
+  int                   tag;            // Element id, see hv_tag()
+
+  pos = (int) (block->start - value_);
+  ww  = 0;
+
+  block->dl_first = dlist_->size();
+
+  line      = 0;
+  xx        = block->line[line];
+  yy        = block->y;
+  hh        = 0;
+  pre       = 0;
+  head      = 0;
+  needspace = 0;
+  underline = 0;
+
+  initfont(font, fsize, fcolor);
+  // byte length difference between html entity (encoded by &...;) and
+  // UTF-8 encoding of same character
+  int entity_extra_length = 0;
+  for (ptr = block->start, buf.clear(); ptr < block->end;)
+  {
+    if ((*ptr == '<' || isspace((*ptr)&255)) && buf.size() > 0)
+    {
+      if (!head && !pre)
+      {
+        // Check width...
+        ww = buf.width();
 
-          if (strncmp(ptr, "!--", 3) == 0)
-          {
-            // Comment...
-            ptr += 3;
-            if ((ptr = strstr(ptr, "-->")) != NULL)
-            {
-              ptr += 3;
-              continue;
-            }
-            else
-              break;
-          }
+        if (needspace && xx > block->x)
+          xx += (int)fl_width(' ');
 
-          while (*ptr && *ptr != '>' && !isspace((*ptr)&255))
-            buf += *ptr++;
+        if ((xx + ww) > block->w)
+        {
+          if (line < 31)
+            line ++;
+          xx = block->line[line];
+          yy += hh;
+          hh = 0;
+        }
 
-          attrs = ptr;
-          while (*ptr && *ptr != '>')
-            ptr ++;
+        dlist_->add_text(buf.c_str(), xx, yy, pos, entity_extra_length);
+        buf.clear();
+        entity_extra_length = 0;
+        if (underline) {
+          xtra_ww = isspace((*ptr)&255)?(int)fl_width(' '):0;
+          dlist_->add(HV_LINE, xx, yy + 1, xx + ww + xtra_ww, 0);
+        }
+        pos = (int) (ptr-value_);
 
-          if (*ptr == '>')
-            ptr ++;
+        xx += ww;
+        if ((fsize + 2) > hh)
+          hh = fsize + 2;
 
-          // end of command reached, set the supposed start of printed eord here
-          current_pos = (int) (ptr-value_);
-          if (buf.cmp("HEAD"))
-            head = 1;
-          else if (buf.cmp("BR"))
+        needspace = 0;
+      }
+      else if (pre)
+      {
+        while (isspace((*ptr)&255))
+        {
+          if (*ptr == '\n')
           {
+            dlist_->add_text(buf.c_str(), xx, yy, pos);
+            if (underline) dlist_->add(HV_LINE, xx, yy + 1, xx + buf.width(), 0);
+            buf.clear();
+            pos = (int) (ptr-value_);
             if (line < 31)
               line ++;
             xx = block->line[line];
             yy += hh;
-            hh = 0;
+            hh = fsize + 2;
           }
-          else if (buf.cmp("HR"))
+          else if (*ptr == '\t')
           {
-            fl_line(block->x + x(), yy + y(), block->w + x(),
-                    yy + y());
-
-            if (line < 31)
-              line ++;
-            xx = block->line[line];
-            yy += 2 * fsize;//hh;
-            hh = 0;
+            // Do tabs every 8 columns...
+            buf += ' '; // add at least one space
+            while (buf.size() & 7)
+              buf += ' ';
           }
-          else if (buf.cmp("CENTER") ||
-                   buf.cmp("P") ||
-                   buf.cmp("H1") ||
-                   buf.cmp("H2") ||
-                   buf.cmp("H3") ||
-                   buf.cmp("H4") ||
-                   buf.cmp("H5") ||
-                   buf.cmp("H6") ||
-                   buf.cmp("UL") ||
-                   buf.cmp("OL") ||
-                   buf.cmp("DL") ||
-                   buf.cmp("LI") ||
-                   buf.cmp("DD") ||
-                   buf.cmp("DT") ||
-                   buf.cmp("PRE"))
-          {
-            if (tolower(buf[0]) == 'h')
-            {
-              font  = FL_HELVETICA_BOLD;
-              fsize = textsize_ + '7' - buf[1];
-            }
-            else if (buf.cmp("DT"))
-            {
-              font  = textfont_ | FL_ITALIC;
-              fsize = textsize_;
-            }
-            else if (buf.cmp("PRE"))
-            {
-              font  = FL_COURIER;
-              fsize = textsize_;
-              pre   = 1;
-            }
+          else {
+            buf += ' ';
+          }
+          if ((fsize + 2) > hh)
+            hh = fsize + 2;
 
-            if (buf.cmp("LI"))
-            {
-              if (block->ol) {
-                char buf[10];
-                snprintf(buf, sizeof(buf), "%d. ", block->ol_num);
-                hv_draw(buf, xx - (int)fl_width(buf) + x() - leftline_, yy + y());
-              }
-              else {
-                // draw bullet (&bull;) Unicode: U+2022, UTF-8 (hex): e2 80 a2
-                unsigned char bullet[4] = { 0xe2, 0x80, 0xa2, 0x00 };
-                hv_draw((char *)bullet, xx - fsize + x() - leftline_, yy + y());
-              }
-            }
+          ptr ++;
+        }
 
-            pushfont(font, fsize);
-            buf.clear();
-          }
-          else if (buf.cmp("A") &&
-                   get_attr(attrs, "HREF", attr, sizeof(attr)) != NULL)
-          {
-            fl_color(linkcolor_);
-            underline = 1;
-          }
-          else if (buf.cmp("/A"))
-          {
-            fl_color(textcolor_);
-            underline = 0;
-          }
-          else if (buf.cmp("FONT"))
-          {
-            if (get_attr(attrs, "COLOR", attr, sizeof(attr)) != NULL) {
-              textcolor_ = get_color(attr, textcolor_);
-            }
+        if (buf.size() > 0)
+        {
+          dlist_->add_text(buf.c_str(), xx, yy, pos);
+          ww = buf.width();
+          buf.clear();
+          if (underline) dlist_->add(HV_LINE, xx, yy + 1, xx + ww, 0);
+          xx += ww;
+          pos = (int) (ptr-value_);
+        }
 
-            if (get_attr(attrs, "FACE", attr, sizeof(attr)) != NULL) {
-              if (!strncasecmp(attr, "helvetica", 9) ||
-                  !strncasecmp(attr, "arial", 5) ||
-                  !strncasecmp(attr, "sans", 4)) font = FL_HELVETICA;
-              else if (!strncasecmp(attr, "times", 5) ||
-                       !strncasecmp(attr, "serif", 5)) font = FL_TIMES;
-              else if (!strncasecmp(attr, "symbol", 6)) font = FL_SYMBOL;
-              else font = FL_COURIER;
-            }
+        needspace = 0;
+      }
+      else
+      {
+        buf.clear();
 
-            if (get_attr(attrs, "SIZE", attr, sizeof(attr)) != NULL) {
-              if (isdigit(attr[0] & 255)) {
-                // Absolute size
-                fsize = (int)(textsize_ * pow(1.2, atof(attr) - 3.0));
-              } else {
-                // Relative size
-                fsize = (int)(fsize * pow(1.2, atof(attr) - 3.0));
-              }
-            }
+        while (isspace((*ptr)&255))
+          ptr ++;
+        pos = (int) (ptr-value_);
+      }
+    }
 
-            pushfont(font, fsize);
-          }
-          else if (buf.cmp("/FONT"))
-          {
-            popfont(font, fsize, textcolor_);
-          }
-          else if (buf.cmp("U"))
-            underline = 1;
-          else if (buf.cmp("/U"))
-            underline = 0;
-          else if (buf.cmp("B") ||
-                   buf.cmp("STRONG"))
-            pushfont(font |= FL_BOLD, fsize);
-          else if (buf.cmp("TD") ||
-                   buf.cmp("TH"))
-          {
-            int tx, ty, tw, th;
+    if (*ptr == '<')
+    {
+      ptr ++;
 
-            if (tolower(buf[1]) == 'h')
-              pushfont(font |= FL_BOLD, fsize);
-            else
-              pushfont(font = textfont_, fsize);
+      if (strncmp(ptr, "!--", 3) == 0)
+      {
+        // Comment...
+        ptr += 3;
+        if ((ptr = strstr(ptr, "-->")) != NULL)
+        {
+          ptr += 3;
+          continue;
+        }
+        else
+          break;
+      }
 
-            tx = block->x - 4 - leftline_;
-            ty = block->y - topline_ - fsize - 3;
-            tw = block->w - block->x + 7;
-            th = block->h + fsize - 5;
+      while (*ptr && *ptr != '>' && !isspace((*ptr)&255))
+        buf += *ptr++;
 
-            if (tx < 0)
-            {
-              tw += tx;
-              tx  = 0;
-            }
+      attrs = ptr;
+      while (*ptr && *ptr != '>')
+        ptr ++;
 
-            if (ty < 0)
-            {
-              th += ty;
-              ty  = 0;
-            }
+      if (*ptr == '>')
+        ptr ++;
 
-            tx += x();
-            ty += y();
+      // end of command reached, set the supposed start of printed eord here
+      pos = (int) (ptr-value_);
+      tag = hv_tag(buf.c_str());
+      if (tag == HV_TAG_HEAD)
+        head = 1;
+      else if (tag == HV_TAG_BR)
+      {
+        if (line < 31)
+          line ++;
+        xx = block->line[line];
+        yy += hh;
+        hh = 0;
+      }
+      else if (tag == HV_TAG_HR)
+      {
+        dlist_->add(HV_LINE, block->x, yy, block->w, 0);
 
-            if (block->bgcolor != bgcolor_)
-            {
-              fl_color(block->bgcolor);
-              fl_rectf(tx, ty, tw, th);
-              fl_color(textcolor_);
-            }
+        if (line < 31)
+          line ++;
+        xx = block->line[line];
+        yy += 2 * fsize;//hh;
+        hh = 0;
+      }
+      else if (tag == HV_TAG_CENTER ||
+               tag == HV_TAG_P ||
+               tag == HV_TAG_H1 ||
+               tag == HV_TAG_H2 ||
+               tag == HV_TAG_H3 ||
+               tag == HV_TAG_H4 ||
+               tag == HV_TAG_H5 ||
+               tag == HV_TAG_H6 ||
+               tag == HV_TAG_UL ||
+               tag == HV_TAG_OL ||
+               tag == HV_TAG_DL ||
+               tag == HV_TAG_LI ||
+               tag == HV_TAG_DD ||
+               tag == HV_TAG_DT ||
+               tag == HV_TAG_PRE)
+      {
+        if (tolower(buf[0]) == 'h')
+        {
+          font  = FL_HELVETICA_BOLD;
+          fsize = textsize_ + '7' - buf[1];
+        }
+        else if (tag == HV_TAG_DT)
+        {
+          font  = textfont_ | FL_ITALIC;
+          fsize = textsize_;
+        }
+        else if (tag == HV_TAG_PRE)
+        {
+          font  = FL_COURIER;
+          fsize = textsize_;
+          pre   = 1;
+        }
 
-            if (block->border)
-              fl_rect(tx, ty, tw, th);
+        if (tag == HV_TAG_LI)
+        {
+          if (block->ol) {
+            char buf[10];
+            snprintf(buf, sizeof(buf), "%d. ", block->ol_num);
+            dlist_->add_text(buf, xx - (int)fl_width(buf), yy, pos);
           }
-          else if (buf.cmp("I") ||
-                   buf.cmp("EM"))
-            pushfont(font |= FL_ITALIC, fsize);
-          else if (buf.cmp("CODE") ||
-                   buf.cmp("TT"))
-            pushfont(font = FL_COURIER, fsize);
-          else if (buf.cmp("KBD"))
-            pushfont(font = FL_COURIER_BOLD, fsize);
-          else if (buf.cmp("VAR"))
-            pushfont(font = FL_COURIER_ITALIC, fsize);
-          else if (buf.cmp("/HEAD"))
-            head = 0;
-          else if (buf.cmp("/H1") ||
-                   buf.cmp("/H2") ||
-                   buf.cmp("/H3") ||
-                   buf.cmp("/H4") ||
-                   buf.cmp("/H5") ||
-                   buf.cmp("/H6") ||
-                   buf.cmp("/B") ||
-                   buf.cmp("/STRONG") ||
-                   buf.cmp("/I") ||
-                   buf.cmp("/EM") ||
-                   buf.cmp("/CODE") ||
-                   buf.cmp("/TT") ||
-                   buf.cmp("/KBD") ||
-                   buf.cmp("/VAR"))
-            popfont(font, fsize, fcolor);
-          else if (buf.cmp("/PRE"))
-          {
-            popfont(font, fsize, fcolor);
-            pre = 0;
+          else {
+            // draw bullet (&bull;) Unicode: U+2022, UTF-8 (hex): e2 80 a2
+            unsigned char bullet[4] = { 0xe2, 0x80, 0xa2, 0x00 };
+            dlist_->add_text((char *)bullet, xx - fsize, yy, pos);
           }
-          else if (buf.cmp("IMG"))
-          {
-            Fl_Shared_Image *img = 0;
-            int         width, height;
-            char        wattr[8], hattr[8];
-
-
-            get_attr(attrs, "WIDTH", wattr, sizeof(wattr));
-            get_attr(attrs, "HEIGHT", hattr, sizeof(hattr));
-            width  = get_length(wattr);
-            height = get_length(hattr);
-
-            if (get_attr(attrs, "SRC", attr, sizeof(attr))) {
-              img = get_image(attr, width, height);
-              if (!width) width = img->w();
-              if (!height) height = img->h();
-            }
-
-            if (!width || !height) {
-              if (get_attr(attrs, "ALT", attr, sizeof(attr)) == NULL) {
-                strcpy(attr, "IMG");
-              }
-            }
+        }
 
-            ww = width;
+        pushfont(font, fsize);
+        buf.clear();
+      }
+      else if (tag == HV_TAG_A &&
+               get_attr(attrs, "HREF", attr, sizeof(attr)) != NULL)
+      {
+        fl_color(linkcolor_);
+        underline = 1;
+      }
+      else if (tag == HV_TAG_END_A)
+      {
+        fl_color(textcolor_);
+        underline = 0;
+      }
+      else if (tag == HV_TAG_FONT)
+      {
+        if (get_attr(attrs, "COLOR", attr, sizeof(attr)) != NULL) {
+          textcolor_ = get_color(attr, textcolor_);
+        }
 
-            if (needspace && xx > block->x)
-              xx += (int)fl_width(' ');
+        if (get_attr(attrs, "FACE", attr, sizeof(attr)) != NULL) {
+          if (!strncasecmp(attr, "helvetica", 9) ||
+              !strncasecmp(attr, "arial", 5) ||
+              !strncasecmp(attr, "sans", 4)) font = FL_HELVETICA;
+          else if (!strncasecmp(attr, "times", 5) ||
+                   !strncasecmp(attr, "serif", 5)) font = FL_TIMES;
+          else if (!strncasecmp(attr, "symbol", 6)) font = FL_SYMBOL;
+          else font = FL_COURIER;
+        }
 
-            if ((xx + ww) > block->w)
-            {
-              if (line < 31)
-                line ++;
+        if (get_attr(attrs, "SIZE", attr, sizeof(attr)) != NULL) {
+          if (isdigit(attr[0] & 255)) {
+            // Absolute size
+            fsize = (int)(textsize_ * pow(1.2, atof(attr) - 3.0));
+          } else {
+            // Relative size
+            fsize = (int)(fsize * pow(1.2, atof(attr) - 3.0));
+          }
+        }
 
-              xx = block->line[line];
-              yy += hh;
-              hh = 0;
-            }
+        pushfont(font, fsize);
+      }
+      else if (tag == HV_TAG_END_FONT)
+      {
+        popfont(font, fsize, textcolor_);
+      }
+      else if (tag == HV_TAG_U)
+        underline = 1;
+      else if (tag == HV_TAG_END_U)
+        underline = 0;
+      else if (tag == HV_TAG_B ||
+               tag == HV_TAG_STRONG)
+        pushfont(font |= FL_BOLD, fsize);
+      else if (tag == HV_TAG_TD ||
+               tag == HV_TAG_TH)
+      {
+        int tx, ty, tw, th;
 
-            if (img) {
-              img->draw(xx + x() - leftline_,
-                        yy + y() - fl_height() + fl_descent() + 2);
-            }
+        if (tolower(buf[1]) == 'h')
+          pushfont(font |= FL_BOLD, fsize);
+        else
+          pushfont(font = textfont_, fsize);
 
-            xx += ww;
-            if ((height + 2) > hh)
-              hh = height + 2;
+        // Cell background and border, clipped to the view when drawn...
+        tx = block->x - 4;
+        ty = block->y - fsize - 3;
+        tw = block->w - block->x + 7;
+        th = block->h + fsize - 5;
 
-            needspace = 0;
-          }
-          buf.clear();
-        }
-        else if (*ptr == '\n' && pre)
+        if (block->bgcolor != bgcolor_)
         {
-          hv_draw(buf.c_str(), xx + x() - leftline_, yy + y());
-          buf.clear();
-
-          if (line < 31)
-            line ++;
-          xx = block->line[line];
-          yy += hh;
-          hh = fsize + 2;
-          needspace = 0;
-
-          ptr ++;
-          current_pos = (int) (ptr-value_);
+          fl_color(block->bgcolor);
+          dlist_->add(HV_FILL, tx, ty, tw, th);
+          fl_color(textcolor_);
         }
-        else if (isspace((*ptr)&255))
-        {
-          if (pre)
-          {
-            if (*ptr == ' ')
-              buf += ' ';
-            else
-            {
-              // Do tabs every 8 columns...
-              buf += ' '; // at least one space
-              while (buf.size() & 7)
-                buf += ' ';
-            }
-          }
 
-          ptr ++;
-          if (!pre) current_pos = (int) (ptr-value_);
-          needspace = 1;
-        }
-        else if (*ptr == '&') // process html entity
-        {
-          ptr ++;
+        if (block->border)
+          dlist_->add(HV_RECT, tx, ty, tw, th);
+      }
+      else if (tag == HV_TAG_I ||
+               tag == HV_TAG_EM)
+        pushfont(font |= FL_ITALIC, fsize);
+      else if (tag == HV_TAG_CODE ||
+               tag == HV_TAG_TT)
+        pushfont(font = FL_COURIER, fsize);
+      else if (tag == HV_TAG_KBD)
+        pushfont(font = FL_COURIER_BOLD, fsize);
+      else if (tag == HV_TAG_VAR)
+        pushfont(font = FL_COURIER_ITALIC, fsize);
+      else if (tag == HV_TAG_END_HEAD)
+        head = 0;
+      else if (tag == HV_TAG_END_H1 ||
+               tag == HV_TAG_END_H2 ||
+               tag == HV_TAG_END_H3 ||
+               tag == HV_TAG_END_H4 ||
+               tag == HV_TAG_END_H5 ||
+               tag == HV_TAG_END_H6 ||
+               tag == HV_TAG_END_B ||
+               tag == HV_TAG_END_STRONG ||
+               tag == HV_TAG_END_I ||
+               tag == HV_TAG_END_EM ||
+               tag == HV_TAG_END_CODE ||
+               tag == HV_TAG_END_TT ||
+               tag == HV_TAG_END_KBD ||
+               tag == HV_TAG_END_VAR)
+        popfont(font, fsize, fcolor);
+      else if (tag == HV_TAG_END_PRE)
+      {
+        popfont(font, fsize, fcolor);
+        pre = 0;
+      }
+      else if (tag == HV_TAG_IMG)
+      {
+        Fl_Shared_Image *img = 0;
+        int         width, height;
+        char        wattr[8], hattr[8];
 
-          int qch = quote_char(ptr);
 
-          if (qch < 0)
-            buf += '&';
-          else {
-            int utf8l = buf.size();
-            buf.add(qch);
-            utf8l = buf.size() - utf8l; // length of added UTF-8 text
-            const char *oldptr = ptr;
-            ptr = strchr(ptr, ';') + 1;
-            entity_extra_length += int(ptr - (oldptr-1)) - utf8l; // extra length between html entity and UTF-8
-          }
+        get_attr(attrs, "WIDTH", wattr, sizeof(wattr));
+        get_attr(attrs, "HEIGHT", hattr, sizeof(hattr));
+        width  = get_length(wattr);
+        height = get_length(hattr);
 
-          if ((fsize + 2) > hh)
-            hh = fsize + 2;
+        if (get_attr(attrs, "SRC", attr, sizeof(attr))) {
+          img = get_image(attr, width, height);
+          if (!width) width = img->w();
+          if (!height) height = img->h();
         }
-        else
-        {
-          buf += *ptr++;
 
-          if ((fsize + 2) > hh)
-            hh = fsize + 2;
+        if (!width || !height) {
+          if (get_attr(attrs, "ALT", attr, sizeof(attr)) == NULL) {
+            strcpy(attr, "IMG");
+          }
         }
-      }
 
-      if (buf.size() > 0 && !pre && !head)
-      {
-        ww = buf.width();
+        ww = width;
 
         if (needspace && xx > block->x)
           xx += (int)fl_width(' ');
@@ -1025,208 +1567,521 @@ Fl_Help_View::draw()
         {
           if (line < 31)
             line ++;
+
           xx = block->line[line];
           yy += hh;
           hh = 0;
         }
+
+        if (img) {
+          dlist_->add_image(img, xx, yy - fl_height() + fl_descent() + 2);
+        }
+
+        xx += ww;
+        if ((height + 2) > hh)
+          hh = height + 2;
+
+        needspace = 0;
       }
+      buf.clear();
+    }
+    else if (*ptr == '\n' && pre)
+    {
+      dlist_->add_text(buf.c_str(), xx, yy, pos);
+      buf.clear();
 
-      if (buf.size() > 0 && !head)
+      if (line < 31)
+        line ++;
+      xx = block->line[line];
+      yy += hh;
+      hh = fsize + 2;
+      needspace = 0;
+
+      ptr ++;
+      pos = (int) (ptr-value_);
+    }
+    else if (isspace((*ptr)&255))
+    {
+      if (pre)
       {
-        hv_draw(buf.c_str(), xx + x() - leftline_, yy + y());
-        if (underline) fl_xyline(xx + x() - leftline_, yy + y() + 1,
-                                 xx + x() - leftline_ + ww);
-        current_pos = (int) (ptr-value_);
+        if (*ptr == ' ')
+          buf += ' ';
+        else
+        {
+          // Do tabs every 8 columns...
+          buf += ' '; // at least one space
+          while (buf.size() & 7)
+            buf += ' ';
+        }
       }
+
+      ptr ++;
+      if (!pre) pos = (int) (ptr-value_);
+      needspace = 1;
     }
+    else if (*ptr == '&') // process html entity
+    {
+      ptr ++;
 
-  fl_pop_clip();
-} // draw()
+      int qch = quote_char(ptr);
+
+      if (qch < 0)
+        buf += '&';
+      else {
+        int utf8l = buf.size();
+        buf.add(qch);
+        utf8l = buf.size() - utf8l; // length of added UTF-8 text
+        const char *oldptr = ptr;
+        ptr = strchr(ptr, ';') + 1;
+        entity_extra_length += int(ptr - (oldptr-1)) - utf8l; // extra length between html entity and UTF-8
+      }
+
+      if ((fsize + 2) > hh)
+        hh = fsize + 2;
+    }
+    else
+    {
+      buf += *ptr++;
+
+      if ((fsize + 2) > hh)
+        hh = fsize + 2;
+    }
+  }
+
+  if (buf.size() > 0 && !pre && !head)
+  {
+    ww = buf.width();
+
+    if (needspace && xx > block->x)
+      xx += (int)fl_width(' ');
+
+    if ((xx + ww) > block->w)
+    {
+      if (line < 31)
+        line ++;
+      xx = block->line[line];
+      yy += hh;
+      hh = 0;
+    }
+  }
+
+  if (buf.size() > 0 && !head)
+  {
+    dlist_->add_text(buf.c_str(), xx, yy, pos);
+    if (underline) dlist_->add(HV_LINE, xx, yy + 1, xx + ww, 0);
+  }
+
+  block->dl_last = dlist_->size();
+} // record_block()
+
+
+/**
+  Forgets the display list, so that draw() records the blocks again.
+
+  This must be called when the blocks are drawn differently without
+  calling format(), e.g. in another text color.
+*/
+void
+Fl_Help_View::free_display_list()
+{
+  int i;
+
+  dlist_->clear();
+  for (i = 0; i < nblocks_; i ++)
+    blocks_[i].dl_first = -1;
+}
+
+
+/** Sets the default text color. */
+void
+Fl_Help_View::textcolor(Fl_Color c)
+{
+  if (textcolor_ == defcolor_) textcolor_ = c;
+  defcolor_ = c;
+  free_display_list();
+}
+
+
+/** Finds the specified string \p s at starting position \p p.
+
+  The argument \p p and the return value are offsets in Fl_Help_View::value(),
+  counting from 0. If \p p is out of range, 0 is used.
+
+  The string comparison is simple but honors some special cases:
+  - the specified string \p s must be in UTF-8 encoding
+  - HTML tags in value() are filtered (not compared as such, they never match)
+  - HTML entities like '\&lt;' or '\&x#20ac;' are converted to Unicode (UTF-8)
+  - ASCII characters (7-bit, \< 0x80) are compared case insensitive
+  - every run of whitespace in value() and in \p s is treated like a single space
+  - all other strings are compared as-is (byte by byte)
+
+  The first search after the document was loaded indexes its text once;
+  this and later searches find all matches in the index in one pass (see
+  find_all()), and searching for the same string again just looks them up.
+
+  \param[in]  s   search string in UTF-8 encoding
+  \param[in]  p   starting position for search (0,...), Default = 0
+
+  \return the matching position or -1 if not found
+  \see find_all(), find_next(), find_prev()
+*/
+int                                             // O - Matching position or -1 if not found
+Fl_Help_View::find(const char *s,               // I - String to find
+                   int        p)                // I - Starting position
+{
+  HV_Text_Index *ti;                            // Index of the text
+  int           i;                              // Match index
+
+  DEBUG_FUNCTION(__LINE__,__FUNCTION__);
+
+  // Range check input and value...
+  if (!s || (ti = text_index()) == NULL) return -1;
+
+  if (p < 0 || p >= fstate_->length) p = 0;
+
+  // Look for the string...
+  if (!ti->searched(s))
+    ti->search(s);
+
+  i = ti->first_after(p);
+  if (i >= ti->matches())
+    return (-1);                                // No match!
+
+  show_match(i);
+  return ti->start(i);
+}
+
+
+/**
+  Finds all occurrences of the string \p s and highlights them.
+
+  The matches are found like find() does. find_next() and find_prev()
+  go through them, clear_matches() stops highlighting them, and so does
+  loading another document.
+
+  \return the number of matches
+  \see matches(), match()
+*/
+int Fl_Help_View::find_all(const char *s) {
+  HV_Text_Index *ti = text_index();
+
+  if (!s || !ti) return 0;
+
+  ti->search(s);
+  ti->highlight(1);
+  redraw();
+  return ti->matches();
+}
+
+
+/**
+  Scrolls to the match of find_all() or find() after the current one,
+  or to the first match after the last one.
+
+  \return the position of the match or -1 if there is none
+*/
+int Fl_Help_View::find_next() {
+  int n = tindex_->matches(), i = tindex_->current() + 1;
+
+  if (!n) return -1;
+  if (i >= n) i = 0;
+  show_match(i);
+  return tindex_->start(i);
+}
+
+
+/**
+  Scrolls to the match of find_all() or find() before the current one,
+  or to the last match before the first one.
+
+  \return the position of the match or -1 if there is none
+*/
+int Fl_Help_View::find_prev() {
+  int n = tindex_->matches(), i = tindex_->current() - 1;
+
+  if (!n) return -1;
+  if (i < 0) i = n - 1;
+  show_match(i);
+  return tindex_->start(i);
+}
+
+
+/** Stops highlighting the matches of find_all(). */
+void Fl_Help_View::clear_matches() {
+  if (!tindex_->highlight()) return;
+  tindex_->highlight(0);
+  redraw();
+}
+
+
+/** Returns the number of matches of the last find_all() or find(). */
+int Fl_Help_View::matches() const {
+  return tindex_->matches();
+}
+
+
+/**
+  Returns the position of match \p i (0 based) of the last find_all() or
+  find() in value(), or -1 if \p i is out of range.
+*/
+int Fl_Help_View::match(int i) const {
+  if (i < 0 || i >= tindex_->matches()) return -1;
+  return tindex_->start(i);
+}
+
+
+/**
+  Returns the index of the match find(), find_next() or find_prev()
+  scrolled to, or -1 if none.
+*/
+int Fl_Help_View::current_match() const {
+  return tindex_->current();
+}
+
+
+/**
+  Returns the index of the text for the searches, indexing the text of
+  the whole document first if needed, or NULL if there is no document.
+*/
+HV_Text_Index *Fl_Help_View::text_index() {
+  if (!value_) return 0;
+
+  if (!tindex_->built()) {
+    format_finish();
+    tindex_->build(value_, blocks_, nblocks_);
+  }
+  return tindex_;
+}
+
+
+/**
+  Makes match \p i the current match, and scrolls to its block unless
+  that is in view.
+*/
+void Fl_Help_View::show_match(int i) {
+  int pos = tindex_->start(i), lo = 0, hi = nblocks_;
 
+  tindex_->current(i);
 
-/** Finds the specified string \p s at starting position \p p.
+  // Find the last block that starts at or before the match...
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (blocks_[mid].start - value_ <= pos) lo = mid + 1;
+    else hi = mid;
+  }
 
-  The argument \p p and the return value are offsets in Fl_Help_View::value(),
-  counting from 0. If \p p is out of range, 0 is used.
+  if (lo > 0) {
+    Fl_Help_Block *b = blocks_ + lo - 1;
+    if (b->y < topline_ || b->y + b->h > topline_ + h())
+      topline(b->y - b->h);
+  }
 
-  The string comparison is simple but honors some special cases:
-  - the specified string \p s must be in UTF-8 encoding
-  - HTML tags in value() are filtered (not compared as such, they never match)
-  - HTML entities like '\&lt;' or '\&x#20ac;' are converted to Unicode (UTF-8)
-  - ASCII characters (7-bit, \< 0x80) are compared case insensitive
-  - every newline (LF, '\\n') in value() is treated like a single space
-  - all other strings are compared as-is (byte by byte)
+  if (tindex_->highlight())
+    redraw();
+}
 
-  \todo complex HTML entities for Unicode code points \> 0x80 are currently treated
-    like one byte (not character!) and do not (yet) match correctly ("<" matches "&lt;"
-    but "€" doesn't match "&euro;", and "ü" doesn't match "&uuml;")
 
-  \param[in]  s   search string in UTF-8 encoding
-  \param[in]  p   starting position for search (0,...), Default = 0
+/**
+  Formats the help text.
 
-  \return the matching position or -1 if not found
+  The text in view is formatted right away, the rest of it when the
+  program is idle. format_finish() formats all of it.
 */
-int                                             // O - Matching position or -1 if not found
-Fl_Help_View::find(const char *s,               // I - String to find
-                   int        p)                // I - Starting position
-{
-  int           i,                              // Looping var
-                c;                              // Current character
-  Fl_Help_Block *b;                             // Current block
-  const char    *bp,                            // Block matching pointer
-                *bs,                            // Start of current comparison
-                *sp;                            // Search string pointer
+void Fl_Help_View::format() {
+  Fl_Boxtype    b = box() ? box() : FL_DOWN_BOX;
+                                // Box to draw...
 
   DEBUG_FUNCTION(__LINE__,__FUNCTION__);
 
-  // Range check input and value...
-  if (!s || !value_) return -1;
+  Fl::remove_idle(format_cb, this);
 
-  if (p < 0 || p >= (int)strlen(value_)) p = 0;
+  // Reset document width...
+  int scrollsize = scrollbar_size_ ? scrollbar_size_ : Fl::scrollbar_size();
+  hsize_ = w() - scrollsize - Fl::box_dw(b);
 
-  // Look for the string...
-  for (i = nblocks_, b = blocks_; i > 0; i--, b++) {
-    if (b->end < (value_ + p))
-      continue;
+  fstate_->busy    = 1;
+  fstate_->restart = 1;
+  fstate_->OL_num.size(0);
+  fstate_->OL_num.push_back(-1);
 
-    if (b->start < (value_ + p)) bp = value_ + p;
-    else bp = b->start;
-
-    for (sp = s, bs = bp; *sp && *bp && bp < b->end; bp++) {
-      if (*bp == '<') {
-        // skip to end of element...
-        while (*bp && bp < b->end && *bp != '>') bp++;
-        // no match, so reset to start of search...
-        sp = s;
-        bs = bp + 1;
-        continue;
-      } else if (*bp == '&') {
-        // decode HTML entity...
-        if ((c = quote_char(bp + 1)) < 0) c = '&';      // *FIXME* UTF-8, see below
-        else bp = strchr(bp + 1, ';') + 1;
-      } else c = *bp;
-
-      if (c == '\n') c = ' '; // treat newline as a single space
-
-      // *FIXME* *UTF-8* (A.S. 02/14/2016)
-      // At this point c may be an arbitrary Unicode Code Point corresponding
-      // to a quoted character (see above), i.e. it _can_ be a multi byte
-      // UTF-8 sequence and must be compared with the corresponding
-      // multi byte string in (*sp)...
-      // For instance: "&euro;" == 0x20ac -> 0xe2 0x82 0xac (UTF-8: 3 bytes).
-      // Hint: use fl_utf8encode() [see below]
-
-      if (c > 0x20 && c < 0x80 && tolower(*sp) == tolower(c)) sp++;
-      else if (*sp == c) sp++;
-      else { // No match, so reset to start of search...
-        sp = s;
-        bp = bs;
-        bs++;
-      }
-    }
+  if (!format_step(topline_ + h(), FORMAT_SLICE))
+    Fl::add_idle(format_cb, this);
 
-    if (!*sp) { // Found a match!
-      topline(b->y - b->h);
-      return int(bs - value_);
-    }
+  if (!value_)
+    return;
+
+  update_scrollbars();
+}
+
+
+/** Formats all of the help text that format() did not format yet. */
+void Fl_Help_View::format_finish() {
+  if (!fstate_->busy)
+    return;
+
+  Fl::remove_idle(format_cb, this);
+  format_step(INT_MAX, 0.0);
+  update_scrollbars();
+}
+
+
+/** Formats more of the help text while the program is idle. */
+void Fl_Help_View::format_cb(void *v) {
+  Fl_Help_View *hv = (Fl_Help_View *)v;
+  int top = hv->topline_ + hv->h();
+  int drawn = hv->fstate_->formatted;
+
+  if (hv->format_step(-1, FORMAT_SLICE)) {
+    Fl::remove_idle(format_cb, v);
+    hv->update_scrollbars();
+    hv->redraw();
+    return;
   }
 
-  // No match!
-  return (-1);
+  // Adjust the scrollbar to the estimated document size...
+  if (hv->scrollbar_.visible()) {
+    int scrollsize = hv->scrollbar_size_ ? hv->scrollbar_size_ : Fl::scrollbar_size();
+    hv->scrollbar_.value(hv->topline_, hv->h() - scrollsize, 0, hv->size_);
+  }
+
+  // ... and show the blocks that were completed in view
+  if (drawn < hv->nblocks_ && hv->blocks_[drawn].y < top)
+    hv->redraw();
 }
 
-/** Formats the help text. */
-void Fl_Help_View::format() {
+
+/**
+  Formats the help text from where the last step stopped, or from the
+  start if fstate_->restart is set.
+
+  Once the text is formatted up to \p ylimit, this stops as soon as it
+  ran for \p seconds, and estimates the document size from the part
+  that is formatted.
+
+  \returns 1 when all of the text is formatted, 0 if it stopped
+*/
+int Fl_Help_View::format_step(int ylimit, double seconds) {
+  HV_Format_State &st = *fstate_;
   int           i;              // Looping var
   int           done;           // Are we done yet?
-  Fl_Help_Block *block,         // Current block
+  Fl_Help_Block *&block = st.block,
+                                // Current block
                 *cell;          // Current table cell
-  int           cells[MAX_COLUMNS],
+  int           (&cells)[MAX_COLUMNS] = st.cells,
                                 // Cells in the current row...
-                row;            // Current table row (block number)
-  const char    *ptr,           // Pointer into block
+                &row = st.row;  // Current table row (block number)
+  const char    *&ptr = st.ptr, // Pointer into block
                 *start,         // Pointer to start of element
                 *attrs;         // Pointer to start of element attributes
-  HV_Edit_Buffer buf;           // Text buffer
+  int           tag;            // Element id, see hv_tag()
+  HV_Edit_Buffer &buf = st.buf; // Text buffer
   char          attr[1024],     // Attribute buffer
                 wattr[1024],    // Width attribute buffer
                 hattr[1024],    // Height attribute buffer
-                linkdest[1024]; // Link destination
-  int           xx, yy, ww, hh; // Size of current text fragment
-  int           line;           // Current line in block
-  int           links;          // Links for current line
-  Fl_Font       font;
-  Fl_Fontsize   fsize;          // Current font and size
-  Fl_Color      fcolor;         // Current font color
-  unsigned char border;         // Draw border?
-  int           talign,         // Current alignment
-                newalign,       // New alignment
-                head,           // In the <HEAD> section?
-                pre,            // <PRE> text?
-                needspace;      // Do we need whitespace?
-  int           table_width,    // Width of table
-                table_offset;   // Offset of table
-  int           column,         // Current table column number
-                columns[MAX_COLUMNS];
-                                // Column widths
-  Fl_Color      tc, rc;         // Table/row background color
-  Fl_Boxtype    b = box() ? box() : FL_DOWN_BOX;
-                                // Box to draw...
-  fl_margins    margins;        // Left margin stack...
-  Fl_Int_Vector OL_num;         // if nonnegative, in OL mode and this is the item number
-
-  OL_num.push_back(-1);
+                (&linkdest)[1024] = st.linkdest;
+                                // Link destination
+  int           &xx = st.xx, &yy = st.yy, &ww = st.ww, &hh = st.hh;
+                                // Size of current text fragment
+  int           &line = st.line;        // Current line in block
+  int           &links = st.links;      // Links for current line
+  Fl_Font       &font = st.font;
+  Fl_Fontsize   &fsize = st.fsize;      // Current font and size
+  Fl_Color      &fcolor = st.fcolor;    // Current font color
+  unsigned char &border = st.border;    // Draw border?
+  int           &talign = st.talign,    // Current alignment
+                &newalign = st.newalign,// New alignment
+                &head = st.head,        // In the <HEAD> section?
+                &pre = st.pre,          // <PRE> text?
+                &needspace = st.needspace;
+                                        // Do we need whitespace?
+  int           &table_width = st.table_width,
+                                        // Width of table
+                &table_offset = st.table_offset;
+                                        // Offset of table
+  int           &column = st.column,    // Current table column number
+                (&columns)[MAX_COLUMNS] = st.columns;
+                                        // Column widths
+  Fl_Color      &tc = st.tc, &rc = st.rc;
+                                        // Table/row background color
+  fl_margins    &margins = st.margins;  // Left margin stack...
+  Fl_Int_Vector &OL_num = st.OL_num;    // if nonnegative, in OL mode and this is the item number
+  Fl_Timestamp  begin = Fl::now();      // Start of this step
+  int           count = 0;              // Characters since the time was checked
 
   DEBUG_FUNCTION(__LINE__,__FUNCTION__);
 
-  // Reset document width...
-  int scrollsize = scrollbar_size_ ? scrollbar_size_ : Fl::scrollbar_size();
-  hsize_ = w() - scrollsize - Fl::box_dw(b);
-
   done = 0;
   while (!done)
   {
-    // Reset state variables...
-    done       = 1;
-    nblocks_   = 0;
-    nlinks_    = 0;
-    ntargets_  = 0;
-    size_      = 0;
-    bgcolor_   = color();
-    textcolor_ = textcolor();
-    linkcolor_ = fl_contrast(FL_BLUE, color());
+    done = 1;
 
-    tc = rc = bgcolor_;
-
-    strcpy(title_, "Untitled");
+    if (st.restart)
+    {
+      // Reset state variables...
+      st.restart = 0;
+      nblocks_   = 0;
+      dlist_->clear();
+      nlinks_    = 0;
+      ntargets_  = 0;
+      size_      = 0;
+      bgcolor_   = color();
+      textcolor_ = textcolor();
+      linkcolor_ = fl_contrast(FL_BLUE, color());
+
+      tc = rc = bgcolor_;
+
+      strcpy(title_, "Untitled");
+
+      if (!value_)
+      {
+        st.busy      = 0;
+        st.formatted = 0;
+        return 1;
+      }
 
-    if (!value_)
-      return;
+      // Setup for formatting...
+      initfont(font, fsize, fcolor);
 
-    // Setup for formatting...
-    initfont(font, fsize, fcolor);
-
-    line         = 0;
-    links        = 0;
-    xx           = margins.clear();
-    yy           = fsize + 2;
-    ww           = 0;
-    column       = 0;
-    border       = 0;
-    hh           = 0;
-    block        = add_block(value_, xx, yy, hsize_, 0);
-    row          = 0;
-    head         = 0;
-    pre          = 0;
-    talign       = LEFT;
-    newalign     = LEFT;
-    needspace    = 0;
-    linkdest[0]  = '\0';
-    table_offset = 0;
+      line         = 0;
+      links        = 0;
+      xx           = margins.clear();
+      yy           = fsize + 2;
+      ww           = 0;
+      column       = 0;
+      border       = 0;
+      hh           = 0;
+      block        = add_block(value_, xx, yy, hsize_, 0);
+      row          = 0;
+      head         = 0;
+      pre          = 0;
+      talign       = LEFT;
+      newalign     = LEFT;
+      needspace    = 0;
+      linkdest[0]  = '\0';
+      table_offset = 0;
+      ptr          = value_;
+      buf.clear();
+      st.length    = (int) strlen(value_);
+    }
+    else
+    {
+      // Continue where the last step stopped...
+      fstack_ = st.fstack;
+      fl_font(font, fsize);
+    }
 
     // Html text character loop
-    for (ptr = value_, buf.clear(); *ptr;)
+    for (; *ptr;)
     {
+      // Stop if the view is filled and the time is up...
+      if (yy > ylimit && !(++count & 255) && Fl::seconds_since(begin) >= seconds)
+      {
+        st.fstack    = fstack_;
+        st.formatted = row ? row : (int) (block - blocks_);
+        size_        = (int) ((double) (yy + hh) * st.length / (ptr - value_));
+        return 0;
+      }
+
       // End of word?
       if ((*ptr == '<' || isspace((*ptr)&255)) && buf.size() > 0)
       {
@@ -1345,11 +2200,12 @@ void Fl_Help_View::format() {
         if (*ptr == '>')
           ptr ++;
 
-        if (buf.cmp("HEAD"))
+        tag = hv_tag(buf.c_str());
+        if (tag == HV_TAG_HEAD)
           head = 1;
-        else if (buf.cmp("/HEAD"))
+        else if (tag == HV_TAG_END_HEAD)
           head = 0;
-        else if (buf.cmp("TITLE"))
+        else if (tag == HV_TAG_TITLE)
         {
           // Copy the title in the document...
           char *st;
@@ -1360,7 +2216,7 @@ void Fl_Help_View::format() {
           *st = '\0';
           buf.clear();
         }
-        else if (buf.cmp("A"))
+        else if (tag == HV_TAG_A)
         {
           if (get_attr(attrs, "NAME", attr, sizeof(attr)) != NULL)
             add_target(attr, yy - fsize - 2);
@@ -1368,9 +2224,9 @@ void Fl_Help_View::format() {
           if (get_attr(attrs, "HREF", attr, sizeof(attr)) != NULL)
             strlcpy(linkdest, attr, sizeof(linkdest));
         }
-        else if (buf.cmp("/A"))
+        else if (tag == HV_TAG_END_A)
           linkdest[0] = '\0';
-        else if (buf.cmp("BODY"))
+        else if (tag == HV_TAG_BODY)
         {
           bgcolor_   = get_color(get_attr(attrs, "BGCOLOR", attr, sizeof(attr)),
                                  color());
@@ -1379,7 +2235,7 @@ void Fl_Help_View::format() {
           linkcolor_ = get_color(get_attr(attrs, "LINK", attr, sizeof(attr)),
                                  fl_contrast(FL_BLUE, color()));
         }
-        else if (buf.cmp("BR"))
+        else if (tag == HV_TAG_BR)
         {
           line     = do_align(block, line, xx, newalign, links);
           xx       = block->x;
@@ -1387,31 +2243,31 @@ void Fl_Help_View::format() {
           yy       += hh;
           hh       = 0;
         }
-        else if (buf.cmp("CENTER") ||
-                 buf.cmp("P") ||
-                 buf.cmp("H1") ||
-                 buf.cmp("H2") ||
-                 buf.cmp("H3") ||
-                 buf.cmp("H4") ||
-                 buf.cmp("H5") ||
-                 buf.cmp("H6") ||
-                 buf.cmp("UL") ||
-                 buf.cmp("OL") ||
-                 buf.cmp("DL") ||
-                 buf.cmp("LI") ||
-                 buf.cmp("DD") ||
-                 buf.cmp("DT") ||
-                 buf.cmp("HR") ||
-                 buf.cmp("PRE") ||
-                 buf.cmp("TABLE"))
+        else if (tag == HV_TAG_CENTER ||
+                 tag == HV_TAG_P ||
+                 tag == HV_TAG_H1 ||
+                 tag == HV_TAG_H2 ||
+                 tag == HV_TAG_H3 ||
+                 tag == HV_TAG_H4 ||
+                 tag == HV_TAG_H5 ||
+                 tag == HV_TAG_H6 ||
+                 tag == HV_TAG_UL ||
+                 tag == HV_TAG_OL ||
+                 tag == HV_TAG_DL ||
+                 tag == HV_TAG_LI ||
+                 tag == HV_TAG_DD ||
+                 tag == HV_TAG_DT ||
+                 tag == HV_TAG_HR ||
+                 tag == HV_TAG_PRE ||
+                 tag == HV_TAG_TABLE)
         {
           block->end = start;
           line       = do_align(block, line, xx, newalign, links);
-          newalign   = buf.cmp("CENTER") ? CENTER : LEFT;
+          newalign   = tag == HV_TAG_CENTER ? CENTER : LEFT;
           xx         = block->x;
           block->h   += hh;
 
-          if (buf.cmp("OL")) {
+          if (tag == HV_TAG_OL) {
             int ol_num = 1;
             if (get_attr(attrs, "START", attr, sizeof(attr)) != NULL) {
               errno = 0;
@@ -1422,17 +2278,17 @@ void Fl_Help_View::format() {
             }
             OL_num.push_back(ol_num);
           }
-          else if (buf.cmp("UL"))
+          else if (tag == HV_TAG_UL)
             OL_num.push_back(-1);
 
-          if (buf.cmp("UL") ||
-              buf.cmp("OL") ||
-              buf.cmp("DL"))
+          if (tag == HV_TAG_UL ||
+              tag == HV_TAG_OL ||
+              tag == HV_TAG_DL)
           {
             block->h += fsize + 2;
             xx       = margins.push(4 * fsize);
           }
-          else if (buf.cmp("TABLE"))
+          else if (tag == HV_TAG_TABLE)
           {
             if (get_attr(attrs, "BORDER", attr, sizeof(attr)))
               border = (uchar)atoi(attr);
@@ -1478,12 +2334,12 @@ void Fl_Help_View::format() {
             font  = FL_HELVETICA_BOLD;
             fsize = textsize_ + '7' - buf[1];
           }
-          else if (buf.cmp("DT"))
+          else if (tag == HV_TAG_DT)
           {
             font  = textfont_ | FL_ITALIC;
             fsize = textsize_;
           }
-          else if (buf.cmp("PRE"))
+          else if (tag == HV_TAG_PRE)
           {
             font  = FL_COURIER;
             fsize = textsize_;
@@ -1501,11 +2357,11 @@ void Fl_Help_View::format() {
           hh = 0;
 
           if ((tolower(buf[0]) == 'h' && isdigit(buf[1])) ||
-              buf.cmp("DD") ||
-              buf.cmp("DT") ||
-              buf.cmp("P"))
+              tag == HV_TAG_DD ||
+              tag == HV_TAG_DT ||
+              tag == HV_TAG_P)
             yy += fsize + 2;
-          else if (buf.cmp("HR"))
+          else if (tag == HV_TAG_HR)
           {
             hh += 2 * fsize;
             yy += fsize;
@@ -1516,7 +2372,7 @@ void Fl_Help_View::format() {
           else
             block = add_block(start, xx, yy, hsize_, 0);
 
-          if (buf.cmp("LI")) {
+          if (tag == HV_TAG_LI) {
             block->ol = 0;
             if (OL_num.size() && OL_num.back()>=0) {
               block->ol = 1;
@@ -1529,52 +2385,52 @@ void Fl_Help_View::format() {
           needspace = 0;
           line      = 0;
 
-          if (buf.cmp("CENTER"))
+          if (tag == HV_TAG_CENTER)
             newalign = talign = CENTER;
           else
             newalign = get_align(attrs, talign);
         }
-        else if (buf.cmp("/CENTER") ||
-                 buf.cmp("/P") ||
-                 buf.cmp("/H1") ||
-                 buf.cmp("/H2") ||
-                 buf.cmp("/H3") ||
-                 buf.cmp("/H4") ||
-                 buf.cmp("/H5") ||
-                 buf.cmp("/H6") ||
-                 buf.cmp("/PRE") ||
-                 buf.cmp("/UL") ||
-                 buf.cmp("/OL") ||
-                 buf.cmp("/DL") ||
-                 buf.cmp("/TABLE"))
+        else if (tag == HV_TAG_END_CENTER ||
+                 tag == HV_TAG_END_P ||
+                 tag == HV_TAG_END_H1 ||
+                 tag == HV_TAG_END_H2 ||
+                 tag == HV_TAG_END_H3 ||
+                 tag == HV_TAG_END_H4 ||
+                 tag == HV_TAG_END_H5 ||
+                 tag == HV_TAG_END_H6 ||
+                 tag == HV_TAG_END_PRE ||
+                 tag == HV_TAG_END_UL ||
+                 tag == HV_TAG_END_OL ||
+                 tag == HV_TAG_END_DL ||
+                 tag == HV_TAG_END_TABLE)
         {
           line       = do_align(block, line, xx, newalign, links);
           xx         = block->x;
           block->end = ptr;
 
-          if (buf.cmp("/OL") ||
-              buf.cmp("/UL")) {
+          if (tag == HV_TAG_END_OL ||
+              tag == HV_TAG_END_UL) {
             if (OL_num.size()) OL_num.pop_back();
           }
 
-          if (buf.cmp("/UL") ||
-              buf.cmp("/OL") ||
-              buf.cmp("/DL"))
+          if (tag == HV_TAG_END_UL ||
+              tag == HV_TAG_END_OL ||
+              tag == HV_TAG_END_DL)
           {
             xx       = margins.pop();
             block->h += fsize + 2;
           }
-          else if (buf.cmp("/TABLE"))
+          else if (tag == HV_TAG_END_TABLE)
           {
             block->h += fsize + 2;
             xx       = margins.current();
           }
-          else if (buf.cmp("/PRE"))
+          else if (tag == HV_TAG_END_PRE)
           {
             pre = 0;
             hh  = 0;
           }
-          else if (buf.cmp("/CENTER"))
+          else if (tag == HV_TAG_END_CENTER)
             talign = LEFT;
 
           popfont(font, fsize, fcolor);
@@ -1601,7 +2457,7 @@ void Fl_Help_View::format() {
           line      = 0;
           newalign  = talign;
         }
-        else if (buf.cmp("TR"))
+        else if (tag == HV_TAG_TR)
         {
           block->end = start;
           line       = do_align(block, line, xx, newalign, links);
@@ -1640,7 +2496,7 @@ void Fl_Help_View::format() {
 
           rc = get_color(get_attr(attrs, "BGCOLOR", attr, sizeof(attr)), tc);
         }
-        else if (buf.cmp("/TR") && row)
+        else if (tag == HV_TAG_END_TR && row)
         {
           line       = do_align(block, line, xx, newalign, links);
           block->end = start;
@@ -1671,8 +2527,8 @@ void Fl_Help_View::format() {
           row       = 0;
           line      = 0;
         }
-        else if ((buf.cmp("TD") ||
-                  buf.cmp("TH")) && row)
+        else if ((tag == HV_TAG_TD ||
+                  tag == HV_TAG_TH) && row)
         {
           int   colspan;                // COLSPAN attribute
 
@@ -1681,7 +2537,7 @@ void Fl_Help_View::format() {
           block->end = start;
           block->h   += hh;
 
-          if (buf.cmp("TH"))
+          if (tag == HV_TAG_TH)
             font = textfont_ | FL_BOLD;
           else
             font = textfont_;
@@ -1725,15 +2581,15 @@ void Fl_Help_View::format() {
           block->bgcolor = get_color(get_attr(attrs, "BGCOLOR", attr,
                                               sizeof(attr)), rc);
         }
-        else if ((buf.cmp("/TD") ||
-                  buf.cmp("/TH")) && row)
+        else if ((tag == HV_TAG_END_TD ||
+                  tag == HV_TAG_END_TH) && row)
         {
           line = do_align(block, line, xx, newalign, links);
           popfont(font, fsize, fcolor);
           xx = margins.pop();
           talign = LEFT;
         }
-        else if (buf.cmp("FONT"))
+        else if (tag == HV_TAG_FONT)
         {
           if (get_attr(attrs, "FACE", attr, sizeof(attr)) != NULL) {
             if (!strncasecmp(attr, "helvetica", 9) ||
@@ -1757,33 +2613,32 @@ void Fl_Help_View::format() {
 
           pushfont(font, fsize);
         }
-        else if (buf.cmp("/FONT"))
+        else if (tag == HV_TAG_END_FONT)
           popfont(font, fsize, fcolor);
-        else if (buf.cmp("B") ||
-                 buf.cmp("STRONG"))
+        else if (tag == HV_TAG_B ||
+                 tag == HV_TAG_STRONG)
           pushfont(font |= FL_BOLD, fsize);
-        else if (buf.cmp("I") ||
-                 buf.cmp("EM"))
+        else if (tag == HV_TAG_I ||
+                 tag == HV_TAG_EM)
           pushfont(font |= FL_ITALIC, fsize);
-        else if (buf.cmp("CODE") ||
-                 buf.cmp("TT"))
+        else if (tag == HV_TAG_CODE ||
+                 tag == HV_TAG_TT)
           pushfont(font = FL_COURIER, fsize);
-        else if (buf.cmp("KBD"))
+        else if (tag == HV_TAG_KBD)
           pushfont(font = FL_COURIER_BOLD, fsize);
-        else if (buf.cmp("VAR"))
+        else if (tag == HV_TAG_VAR)
           pushfont(font = FL_COURIER_ITALIC, fsize);
-        else if (buf.cmp("/B") ||
-                 buf.cmp("/STRONG") ||
-                 buf.cmp("/I") ||
-                 buf.cmp("/EM") ||
-                 buf.cmp("/CODE") ||
-                 buf.cmp("/TT") ||
-                 buf.cmp("/KBD") ||
-                 buf.cmp("/VAR"))
+        else if (tag == HV_TAG_END_B ||
+                 tag == HV_TAG_END_STRONG ||
+                 tag == HV_TAG_END_I ||
+                 tag == HV_TAG_END_EM ||
+                 tag == HV_TAG_END_CODE ||
+                 tag == HV_TAG_END_TT ||
+                 tag == HV_TAG_END_KBD ||
+                 tag == HV_TAG_END_VAR)
           popfont(font, fsize, fcolor);
-        else if (buf.cmp("IMG"))
+        else if (tag == HV_TAG_IMG)
         {
-          Fl_Shared_Image       *img = 0;
           int           width;
           int           height;
 
@@ -1793,11 +2648,8 @@ void Fl_Help_View::format() {
           width  = get_length(wattr);
           height = get_length(hattr);
 
-          if (get_attr(attrs, "SRC", attr, sizeof(attr))) {
-            img    = get_image(attr, width, height);
-            width  = img->w();
-            height = img->h();
-          }
+          if (get_attr(attrs, "SRC", attr, sizeof(attr)))
+            format_image(start, attr, width, height);
 
           ww = width;
 
@@ -1917,6 +2769,9 @@ void Fl_Help_View::format() {
 
     block->end = ptr;
     size_      = yy + hh;
+
+    // Start over if the document got wider...
+    st.restart = 1;
   }
 
 //  printf("margins.depth_=%d\n", margins.depth_);
@@ -1925,6 +2780,15 @@ void Fl_Help_View::format() {
     qsort(targets_, ntargets_, sizeof(Fl_Help_Target),
           (compare_func_t)compare_targets);
 
+  st.busy      = 0;
+  st.formatted = nblocks_;
+  return 1;
+}
+
+
+/** Shows or hides the scrollbars for the document size and scrolls into it. */
+void Fl_Help_View::update_scrollbars() {
+  Fl_Boxtype b = box() ? box() : FL_DOWN_BOX;
   int dx = Fl::box_dw(b) - Fl::box_dx(b);
   int dy = Fl::box_dh(b) - Fl::box_dy(b);
   int ss = scrollbar_size_ ? scrollbar_size_ : Fl::scrollbar_size();
@@ -1996,6 +2860,7 @@ Fl_Help_View::format_table(int        *table_width,     // O - Total table width
   const char    *ptr,                                   // Pointer into table
                 *attrs,                                 // Pointer to attributes
                 *start;                                 // Start of element
+  int           tag;                                    // Element id, see hv_tag()
   int           minwidths[MAX_COLUMNS];                 // Minimum widths for each column
   Fl_Font       font;
   Fl_Fontsize   fsize;                                  // Current font and size
@@ -2056,29 +2921,30 @@ Fl_Help_View::format_table(int        *table_width,     // O - Total table width
       if (*ptr == '>')
         ptr ++;
 
-      if (buf.cmp("BR") ||
-          buf.cmp("HR"))
+      tag = hv_tag(buf.c_str());
+      if (tag == HV_TAG_BR ||
+          tag == HV_TAG_HR)
       {
         width     = 0;
         needspace = 0;
       }
-      else if (buf.cmp("TABLE") && start > table)
+      else if (tag == HV_TAG_TABLE && start > table)
         break;
-      else if (buf.cmp("CENTER") ||
-               buf.cmp("P") ||
-               buf.cmp("H1") ||
-               buf.cmp("H2") ||
-               buf.cmp("H3") ||
-               buf.cmp("H4") ||
-               buf.cmp("H5") ||
-               buf.cmp("H6") ||
-               buf.cmp("UL") ||
-               buf.cmp("OL") ||
-               buf.cmp("DL") ||
-               buf.cmp("LI") ||
-               buf.cmp("DD") ||
-               buf.cmp("DT") ||
-               buf.cmp("PRE"))
+      else if (tag == HV_TAG_CENTER ||
+               tag == HV_TAG_P ||
+               tag == HV_TAG_H1 ||
+               tag == HV_TAG_H2 ||
+               tag == HV_TAG_H3 ||
+               tag == HV_TAG_H4 ||
+               tag == HV_TAG_H5 ||
+               tag == HV_TAG_H6 ||
+               tag == HV_TAG_UL ||
+               tag == HV_TAG_OL ||
+               tag == HV_TAG_DL ||
+               tag == HV_TAG_LI ||
+               tag == HV_TAG_DD ||
+               tag == HV_TAG_DT ||
+               tag == HV_TAG_PRE)
       {
         width     = 0;
         needspace = 0;
@@ -2088,18 +2954,18 @@ Fl_Help_View::format_table(int        *table_width,     // O - Total table width
           font  = FL_HELVETICA_BOLD;
           fsize = textsize_ + '7' - buf[1];
         }
-        else if (buf.cmp("DT"))
+        else if (tag == HV_TAG_DT)
         {
           font  = textfont_ | FL_ITALIC;
           fsize = textsize_;
         }
-        else if (buf.cmp("PRE"))
+        else if (tag == HV_TAG_PRE)
         {
           font  = FL_COURIER;
           fsize = textsize_;
           pre   = 1;
         }
-        else if (buf.cmp("LI"))
+        else if (tag == HV_TAG_LI)
         {
           width  += 4 * fsize;
           font   = textfont_;
@@ -2113,26 +2979,26 @@ Fl_Help_View::format_table(int        *table_width,     // O - Total table width
 
         pushfont(font, fsize);
       }
-      else if (buf.cmp("/CENTER") ||
-               buf.cmp("/P") ||
-               buf.cmp("/H1") ||
-               buf.cmp("/H2") ||
-               buf.cmp("/H3") ||
-               buf.cmp("/H4") ||
-               buf.cmp("/H5") ||
-               buf.cmp("/H6") ||
-               buf.cmp("/PRE") ||
-               buf.cmp("/UL") ||
-               buf.cmp("/OL") ||
-               buf.cmp("/DL"))
+      else if (tag == HV_TAG_END_CENTER ||
+               tag == HV_TAG_END_P ||
+               tag == HV_TAG_END_H1 ||
+               tag == HV_TAG_END_H2 ||
+               tag == HV_TAG_END_H3 ||
+               tag == HV_TAG_END_H4 ||
+               tag == HV_TAG_END_H5 ||
+               tag == HV_TAG_END_H6 ||
+               tag == HV_TAG_END_PRE ||
+               tag == HV_TAG_END_UL ||
+               tag == HV_TAG_END_OL ||
+               tag == HV_TAG_END_DL)
       {
         width     = 0;
         needspace = 0;
 
         popfont(font, fsize, fcolor);
       }
-      else if (buf.cmp("TR") || buf.cmp("/TR") ||
-               buf.cmp("/TABLE"))
+      else if (tag == HV_TAG_TR || tag == HV_TAG_END_TR ||
+               tag == HV_TAG_END_TABLE)
       {
 //        printf("%s column = %d, colspan = %d, num_columns = %d\n",
 //             buf.c_str(), column, colspan, num_columns);
@@ -2152,7 +3018,7 @@ Fl_Help_View::format_table(int        *table_width,     // O - Total table width
           }
         }
 
-        if (buf.cmp("/TABLE"))
+        if (tag == HV_TAG_END_TABLE)
           break;
 
         needspace = 0;
@@ -2161,8 +3027,8 @@ Fl_Help_View::format_table(int        *table_width,     // O - Total table width
         max_width = 0;
         incell    = 0;
       }
-      else if (buf.cmp("TD") ||
-               buf.cmp("TH"))
+      else if (tag == HV_TAG_TD ||
+               tag == HV_TAG_TH)
       {
 //        printf("BEFORE column = %d, colspan = %d, num_columns = %d\n",
 //             column, colspan, num_columns);
@@ -2199,7 +3065,7 @@ Fl_Help_View::format_table(int        *table_width,     // O - Total table width
         width     = 0;
         incell    = 1;
 
-        if (buf.cmp("TH"))
+        if (tag == HV_TAG_TH)
           font = textfont_ | FL_BOLD;
         else
           font = textfont_;
@@ -2215,37 +3081,36 @@ Fl_Help_View::format_table(int        *table_width,     // O - Total table width
 
 //        printf("max_width = %d\n", max_width);
       }
-      else if (buf.cmp("/TD") ||
-               buf.cmp("/TH"))
+      else if (tag == HV_TAG_END_TD ||
+               tag == HV_TAG_END_TH)
       {
         incell = 0;
         popfont(font, fsize, fcolor);
       }
-      else if (buf.cmp("B") ||
-               buf.cmp("STRONG"))
+      else if (tag == HV_TAG_B ||
+               tag == HV_TAG_STRONG)
         pushfont(font |= FL_BOLD, fsize);
-      else if (buf.cmp("I") ||
-               buf.cmp("EM"))
+      else if (tag == HV_TAG_I ||
+               tag == HV_TAG_EM)
         pushfont(font |= FL_ITALIC, fsize);
-      else if (buf.cmp("CODE") ||
-               buf.cmp("TT"))
+      else if (tag == HV_TAG_CODE ||
+               tag == HV_TAG_TT)
         pushfont(font = FL_COURIER, fsize);
-      else if (buf.cmp("KBD"))
+      else if (tag == HV_TAG_KBD)
         pushfont(font = FL_COURIER_BOLD, fsize);
-      else if (buf.cmp("VAR"))
+      else if (tag == HV_TAG_VAR)
         pushfont(font = FL_COURIER_ITALIC, fsize);
-      else if (buf.cmp("/B") ||
-               buf.cmp("/STRONG") ||
-               buf.cmp("/I") ||
-               buf.cmp("/EM") ||
-               buf.cmp("/CODE") ||
-               buf.cmp("/TT") ||
-               buf.cmp("/KBD") ||
-               buf.cmp("/VAR"))
+      else if (tag == HV_TAG_END_B ||
+               tag == HV_TAG_END_STRONG ||
+               tag == HV_TAG_END_I ||
+               tag == HV_TAG_END_EM ||
+               tag == HV_TAG_END_CODE ||
+               tag == HV_TAG_END_TT ||
+               tag == HV_TAG_END_KBD ||
+               tag == HV_TAG_END_VAR)
         popfont(font, fsize, fcolor);
-      else if (buf.cmp("IMG") && incell)
+      else if (tag == HV_TAG_IMG && incell)
       {
-        Fl_Shared_Image *img = 0;
         int             iwidth, iheight;
 
 
@@ -2254,11 +3119,8 @@ Fl_Help_View::format_table(int        *table_width,     // O - Total table width
         iwidth  = get_length(wattr);
         iheight = get_length(hattr);
 
-        if (get_attr(attrs, "SRC", attr, sizeof(attr))) {
-          img     = get_image(attr, iwidth, iheight);
-          iwidth  = img->w();
-          iheight = img->h();
-        }
+        if (get_attr(attrs, "SRC", attr, sizeof(attr)))
+          format_image(start, attr, iwidth, iheight);
 
         if (iwidth > minwidths[column])
           minwidths[column] = iwidth;
@@ -2399,77 +3261,67 @@ Fl_Help_View::format_table(int        *table_width,     // O - Total table width
 /** Frees memory used for the document. */
 void
 Fl_Help_View::free_data() {
-  // Release all images...
+  Fl_Int_Vector &images = fstate_->images;
+
+  // Stop formatting...
+  Fl::remove_idle(format_cb, this);
+  fstate_->busy      = 0;
+  fstate_->formatted = 0;
+
+  // Release all images that were loaded, see format_image()...
   if (value_) {
-    const char  *ptr,           // Pointer into block
-                *attrs;         // Pointer to start of element attributes
-    HV_Edit_Buffer buf;         // Text buffer
+    const char  *attrs;         // Pointer to start of element attributes
     char        attr[1024],     // Attribute buffer
                 wattr[1024],    // Width attribute buffer
                 hattr[1024];    // Height attribute buffer
+    unsigned    i;              // Looping var
 
     DEBUG_FUNCTION(__LINE__,__FUNCTION__);
 
-    for (ptr = value_; *ptr;)
+    for (i = 0; i < images.size(); i ++)
     {
-      if (*ptr == '<')
-      {
-        ptr ++;
-
-        if (strncmp(ptr, "!--", 3) == 0)
-        {
-          // Comment...
-          ptr += 3;
-          if ((ptr = strstr(ptr, "-->")) != NULL)
-          {
-            ptr += 3;
-            continue;
-          }
-          else
-            break;
-        }
-
-        buf.clear();
-
-        while (*ptr && *ptr != '>' && !isspace((*ptr)&255))
-          buf += *ptr++;
-
-        attrs = ptr;
-        while (*ptr && *ptr != '>')
-          ptr ++;
-
-        if (*ptr == '>')
-          ptr ++;
-
-        if (buf.cmp("IMG"))
-        {
-          Fl_Shared_Image       *img;
-          int           width;
-          int           height;
-
-          get_attr(attrs, "WIDTH", wattr, sizeof(wattr));
-          get_attr(attrs, "HEIGHT", hattr, sizeof(hattr));
-          width  = get_length(wattr);
-          height = get_length(hattr);
-
-          if (get_attr(attrs, "SRC", attr, sizeof(attr))) {
-            // Get and release the image to free it from memory...
-            img = get_image(attr, width, height);
-            if ((void*)img != &broken_image) {
-              img->release();
-            }
-          }
+      Fl_Shared_Image   *img;
+      int               width;
+      int               height;
+
+      attrs = value_ + images[i] + 4;   // after "<IMG"
+
+      get_attr(attrs, "WIDTH", wattr, sizeof(wattr));
+      get_attr(attrs, "HEIGHT", hattr, sizeof(hattr));
+      width  = get_length(wattr);
+      height = get_length(hattr);
+
+      if (get_attr(attrs, "SRC", attr, sizeof(attr))) {
+        // Get and release the image to free it from memory...
+        img = get_image(attr, width, height);
+        if ((void*)img != &broken_image) {
+          img->release();
         }
       }
-      else
-        ptr ++;
     }
 
+    images.size(0);
+
     free((void *)value_);
     value_ = 0;
   }
 
+  // Stop decoding images, and release those that were decoded...
+  Fl::remove_timeout(images_cb, this);
+  while (fstate_->jobs) {
+    HV_Image_Job *job = fstate_->jobs;
+    fstate_->jobs = job->next;
+
+    if (!job->done) Fl_Shared_Image::cancel_async(image_done, job);
+    if (job->shared) job->shared->release();
+    free(job->file);
+    free(job);
+  }
+
   // Free all of the arrays...
+  dlist_->clear();
+  tindex_->clear();
+
   if (nblocks_) {
     free(blocks_);
 
@@ -2672,6 +3524,13 @@ Fl_Help_View::get_color(const char *n,  // I - Color name
   This should be fixed in FLTK 1.3 !
 
 
+  format_image() sets initial_load the first time an <IMG> element of
+  the document is formatted, which may be in an idle callback after load()
+  or value() returned. With async_images(1), image files that are not in
+  the shared image pool yet are decoded on a worker thread first (see
+  image_ready()), so that initial_load is only set once the file can be
+  taken from the pool.
+
   If initial_load is true, then Fl_Shared_Image::get() is called to
   load the image, and the reference count of the shared image is
   increased by one.
@@ -2691,32 +3550,61 @@ Fl_Help_View::get_color(const char *n,  // I - Color name
 Fl_Shared_Image *
 Fl_Help_View::get_image(const char *name, int W, int H) {
   const char    *localname;             // Local filename
-  char          dir[FL_PATH_MAX];       // Current directory
-  char          temp[2 * FL_PATH_MAX],  // Temporary filename
-                *tempptr;               // Pointer into temporary name
+  char          temp[2 * FL_PATH_MAX];  // Temporary filename
   Fl_Shared_Image *ip;                  // Image pointer...
 
+  if ((localname = image_file(name, temp, sizeof(temp))) == NULL) return 0;
+
+  if (initial_load) {
+    if ((ip = Fl_Shared_Image::get(localname, W, H)) == NULL) {
+      ip = (Fl_Shared_Image *)&broken_image;
+    }
+  } else { // draw or resize
+    if ((ip = Fl_Shared_Image::find(localname, W, H)) == NULL) {
+      ip = (Fl_Shared_Image *)&broken_image;
+    } else {
+      ip->release();
+    }
+  }
+
+  return ip;
+}
+
+
+/**
+  Gets the name of the file of the image \p name, relative to the
+  directory of the document and transformed by the link() function.
+
+  \return the file name, which may be in \p temp, or NULL if the link()
+          function refused the image
+*/
+const char *
+Fl_Help_View::image_file(const char *name, char *temp, int tempsize) {
+  const char    *localname;             // Local filename
+  char          dir[FL_PATH_MAX];       // Current directory
+  char          *tempptr;               // Pointer into temporary name
+
   // See if the image can be found...
   if (strchr(directory_, ':') != NULL && strchr(name, ':') == NULL) {
     if (name[0] == '/') {
-      strlcpy(temp, directory_, sizeof(temp));
+      strlcpy(temp, directory_, tempsize);
 
       if ((tempptr = strrchr(strchr(directory_, ':') + 3, '/')) != NULL) {
-        strlcpy(tempptr, name, sizeof(temp) - (tempptr - temp));
+        strlcpy(tempptr, name, tempsize - (tempptr - temp));
       } else {
-        strlcat(temp, name, sizeof(temp));
+        strlcat(temp, name, tempsize);
       }
     } else {
-      snprintf(temp, sizeof(temp), "%s/%s", directory_, name);
+      snprintf(temp, tempsize, "%s/%s", directory_, name);
     }
 
     if (link_) localname = (*link_)(this, temp);
     else localname = temp;
   } else if (name[0] != '/' && strchr(name, ':') == NULL) {
-    if (directory_[0]) snprintf(temp, sizeof(temp), "%s/%s", directory_, name);
+    if (directory_[0]) snprintf(temp, tempsize, "%s/%s", directory_, name);
     else {
       fl_getcwd(dir, sizeof(dir));
-      snprintf(temp, sizeof(temp), "file:%s/%s", dir, name);
+      snprintf(temp, tempsize, "file:%s/%s", dir, name);
     }
 
     if (link_) localname = (*link_)(this, temp);
@@ -2728,19 +3616,153 @@ Fl_Help_View::get_image(const char *name, int W, int H) {
 
   if (strncmp(localname, "file:", 5) == 0) localname += 5;
 
+  return localname;
+}
+
+
+/**
+  Gets the size of the image of the <IMG> element at \p tag for formatting.
+
+  The image is loaded the first time an element is formatted, and
+  released by free_data(). See get_image(). While the image file is
+  decoded on a worker thread \p W and \p H are kept, or set to the
+  size of the broken image if either is 0.
+*/
+void
+Fl_Help_View::format_image(const char *tag, const char *name, int &W, int &H) {
+  Fl_Int_Vector   &images = fstate_->images;
+  Fl_Shared_Image *ip;
+  int             pos = (int) (tag - value_), lo = 0, hi = (int)images.size(), k;
+
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (images[mid] < pos) lo = mid + 1;
+    else hi = mid;
+  }
+
+  initial_load = (lo == (int)images.size() || images[lo] != pos);
+
   if (initial_load) {
-    if ((ip = Fl_Shared_Image::get(localname, W, H)) == NULL) {
-      ip = (Fl_Shared_Image *)&broken_image;
-    }
-  } else { // draw or resize
-    if ((ip = Fl_Shared_Image::find(localname, W, H)) == NULL) {
-      ip = (Fl_Shared_Image *)&broken_image;
-    } else {
-      ip->release();
+    char        temp[2 * FL_PATH_MAX];  // Temporary filename
+    const char  *localname = image_file(name, temp, sizeof(temp));
+
+    if (localname && !image_ready(localname)) {
+      // Lay out a placeholder until the image arrives...
+      if (!W || !H) {
+        W = broken_image.w();
+        H = broken_image.h();
+      }
+      initial_load = 0;
+      return;
     }
   }
 
-  return ip;
+  ip = get_image(name, W, H);
+
+  if (initial_load) {
+    images.push_back(pos);
+    for (k = (int)images.size() - 1; k > lo; k --)
+      images[k] = images[k - 1];
+    images[lo] = pos;
+  }
+  initial_load = 0;
+
+  if (ip) {
+    W = ip->w();
+    H = ip->h();
+  }
+}
+
+
+/**
+  Checks whether the image file \p file can be taken from the shared
+  image pool.
+
+  If async_images() is set and the file is neither in the pool nor being
+  loaded, this starts loading it with Fl_Shared_Image::get_async().
+  image_done() formats the document again when the image arrives.
+  Otherwise get_image() loads it right away.
+
+  \return 1 if the image can be loaded now or could not be decoded, 0
+          while it is being decoded
+*/
+int
+Fl_Help_View::image_ready(const char *file) {
+  HV_Image_Job    *job;
+  Fl_Shared_Image *ip;
+
+  for (job = fstate_->jobs; job; job = job->next)
+    if (!strcmp(job->file, file)) return job->done;
+
+  if (!fstate_->async_images)
+    return 1;
+
+  if ((ip = Fl_Shared_Image::find(file)) != NULL) {
+    ip->release();                      // just checking
+    return 1;
+  }
+
+  job = (HV_Image_Job *)malloc(sizeof(HV_Image_Job));
+  job->view   = this;
+  job->file   = fl_strdup(file);
+  job->shared = 0;
+  job->done   = 0;
+  job->next   = fstate_->jobs;
+  fstate_->jobs = job;
+
+  Fl_Shared_Image::get_async(file, 0, 0, image_done, job);
+  return 0;
+}
+
+
+/**
+  Keeps the image loaded for a HV_Image_Job, and schedules formatting
+  the document with it. Images arriving together are formatted once,
+  see images_cb().
+*/
+void Fl_Help_View::image_done(Fl_Shared_Image *img, void *v) {
+  HV_Image_Job *job = (HV_Image_Job *)v;
+
+  // This reference is released by free_data()
+  job->done   = 1;
+  job->shared = img;
+  if (!img)
+    return;
+
+  if (!Fl::has_timeout(images_cb, job->view))
+    Fl::add_timeout(0.0, images_cb, job->view);
+}
+
+
+/** Formats and redraws the document with the images that arrived. */
+void Fl_Help_View::images_cb(void *v) {
+  Fl_Help_View *hv = (Fl_Help_View *)v;
+
+  hv->format();
+  hv->redraw();
+}
+
+
+/**
+  Sets whether image files are decoded on worker threads.
+
+  If \p val is 0 (the default), images that are not in the
+  Fl_Shared_Image pool yet are loaded while the document is formatted.
+  Otherwise they are decoded with Fl_Shared_Image::get_async(), and the
+  document is formatted again when they arrive. Like all threaded FLTK
+  programs, the application must call Fl::lock() before Fl::run() for
+  them to arrive promptly.
+
+  Takes effect for images that are formatted from now on.
+*/
+void Fl_Help_View::async_images(int val) {
+  fstate_->async_images = val ? 1 : 0;
+}
+
+
+/** Returns 1 if image files are decoded on worker threads, see async_images(int). */
+int Fl_Help_View::async_images() const {
+  return fstate_->async_images;
 }
 
 
@@ -3148,6 +4170,9 @@ Fl_Help_View::Fl_Help_View(int        xx,       // I - Left position
   ablocks_      = 0;
   nblocks_      = 0;
   blocks_       = (Fl_Help_Block *)0;
+  dlist_        = new HV_Display_List;
+  tindex_       = new HV_Text_Index;
+  fstate_       = new HV_Format_State;
 
   link_         = (Fl_Help_Func *)0;
 
@@ -3193,6 +4218,9 @@ Fl_Help_View::~Fl_Help_View()
 {
   clear_selection();
   free_data();
+  delete dlist_;
+  delete tindex_;
+  delete fstate_;
 }
 
 
@@ -3327,9 +4355,7 @@ int Fl_Help_View::load(const char *f)
     ret = -1;
   }
 
-  initial_load = 1;
   format();
-  initial_load = 0;
 
   if (target)
     topline(target);
@@ -3376,6 +4402,8 @@ Fl_Help_View::topline(const char *n)    // I - Target name
                 *target;                // Pointer to matching target
 
 
+  format_finish();
+
   if (ntargets_ == 0)
     return;
 
@@ -3464,9 +4492,7 @@ Fl_Help_View::value(const char *val)    // I - Text to view
 
   value_ = fl_strdup(val);
 
-  initial_load = 1;
   format();
-  initial_load = 0;
 
   topline(0);
   leftline(0);
@@ -3499,130 +4525,142 @@ Fl_Help_View::value(const char *val)    // I - Text to view
 */
 static int                      // O - Code or -1 on error
 quote_char(const char *p) {     // I - Quoted string
-  int   i;                      // Looping var
   static const struct {
     const char  *name;
-    int         namelen;
     int         code;
-  }     *nameptr,               // Pointer into name array
-        names[] = {             // Quoting names
-    { "Aacute;", 7, 193 },
-    { "aacute;", 7, 225 },
-    { "Acirc;",  6, 194 },
-    { "acirc;",  6, 226 },
-    { "acute;",  6, 180 },
-    { "AElig;",  6, 198 },
-    { "aelig;",  6, 230 },
-    { "Agrave;", 7, 192 },
-    { "agrave;", 7, 224 },
-    { "amp;",    4, '&' },
-    { "Aring;",  6, 197 },
-    { "aring;",  6, 229 },
-    { "Atilde;", 7, 195 },
-    { "atilde;", 7, 227 },
-    { "Auml;",   5, 196 },
-    { "auml;",   5, 228 },
-    { "brvbar;", 7, 166 },
-    { "bull;",   5, 0x2022 },
-    { "Ccedil;", 7, 199 },
-    { "ccedil;", 7, 231 },
-    { "cedil;",  6, 184 },
-    { "cent;",   5, 162 },
-    { "copy;",   5, 169 },
-    { "curren;", 7, 164 },
-    { "dagger;", 7, 0x2020 },
-    { "deg;",    4, 176 },
-    { "divide;", 7, 247 },
-    { "Eacute;", 7, 201 },
-    { "eacute;", 7, 233 },
-    { "Ecirc;",  6, 202 },
-    { "ecirc;",  6, 234 },
-    { "Egrave;", 7, 200 },
-    { "egrave;", 7, 232 },
-    { "ETH;",    4, 208 },
-    { "eth;",    4, 240 },
-    { "Euml;",   5, 203 },
-    { "euml;",   5, 235 },
-    { "euro;",   5, 0x20ac },
-    { "frac12;", 7, 189 },
-    { "frac14;", 7, 188 },
-    { "frac34;", 7, 190 },
-    { "gt;",     3, '>' },
-    { "Iacute;", 7, 205 },
-    { "iacute;", 7, 237 },
-    { "Icirc;",  6, 206 },
-    { "icirc;",  6, 238 },
-    { "iexcl;",  6, 161 },
-    { "Igrave;", 7, 204 },
-    { "igrave;", 7, 236 },
-    { "iquest;", 7, 191 },
-    { "Iuml;",   5, 207 },
-    { "iuml;",   5, 239 },
-    { "laquo;",  6, 171 },
-    { "lt;",     3, '<' },
-    { "macr;",   5, 175 },
-    { "micro;",  6, 181 },
-    { "middot;", 7, 183 },
-    { "nbsp;",   5, ' ' },
-    { "ndash;",  6, 0x2013 },
-    { "not;",    4, 172 },
-    { "Ntilde;", 7, 209 },
-    { "ntilde;", 7, 241 },
-    { "Oacute;", 7, 211 },
-    { "oacute;", 7, 243 },
-    { "Ocirc;",  6, 212 },
-    { "ocirc;",  6, 244 },
-    { "Ograve;", 7, 210 },
-    { "ograve;", 7, 242 },
-    { "ordf;",   5, 170 },
-    { "ordm;",   5, 186 },
-    { "Oslash;", 7, 216 },
-    { "oslash;", 7, 248 },
-    { "Otilde;", 7, 213 },
-    { "otilde;", 7, 245 },
-    { "Ouml;",   5, 214 },
-    { "ouml;",   5, 246 },
-    { "para;",   5, 182 },
-    { "permil;", 7, 0x2030 },
-    { "plusmn;", 7, 177 },
-    { "pound;",  6, 163 },
-    { "quot;",   5, '\"' },
-    { "raquo;",  6, 187 },
-    { "reg;",    4, 174 },
-    { "sect;",   5, 167 },
-    { "shy;",    4, 173 },
-    { "sup1;",   5, 185 },
-    { "sup2;",   5, 178 },
-    { "sup3;",   5, 179 },
-    { "szlig;",  6, 223 },
-    { "THORN;",  6, 222 },
-    { "thorn;",  6, 254 },
-    { "times;",  6, 215 },
-    { "trade;",  6, 0x2122 },
-    { "Uacute;", 7, 218 },
-    { "uacute;", 7, 250 },
-    { "Ucirc;",  6, 219 },
-    { "ucirc;",  6, 251 },
-    { "Ugrave;", 7, 217 },
-    { "ugrave;", 7, 249 },
-    { "uml;",    4, 168 },
-    { "Uuml;",   5, 220 },
-    { "uuml;",   5, 252 },
-    { "Yacute;", 7, 221 },
-    { "yacute;", 7, 253 },
-    { "yen;",    4, 165 },
-    { "Yuml;",   5, 0x0178 },
-    { "yuml;",   5, 255 }
+  }     names[] = {             // Quoting names, sorted with strcmp()
+    { "AElig",   198 },
+    { "Aacute",  193 },
+    { "Acirc",   194 },
+    { "Agrave",  192 },
+    { "Aring",   197 },
+    { "Atilde",  195 },
+    { "Auml",    196 },
+    { "Ccedil",  199 },
+    { "ETH",     208 },
+    { "Eacute",  201 },
+    { "Ecirc",   202 },
+    { "Egrave",  200 },
+    { "Euml",    203 },
+    { "Iacute",  205 },
+    { "Icirc",   206 },
+    { "Igrave",  204 },
+    { "Iuml",    207 },
+    { "Ntilde",  209 },
+    { "Oacute",  211 },
+    { "Ocirc",   212 },
+    { "Ograve",  210 },
+    { "Oslash",  216 },
+    { "Otilde",  213 },
+    { "Ouml",    214 },
+    { "THORN",   222 },
+    { "Uacute",  218 },
+    { "Ucirc",   219 },
+    { "Ugrave",  217 },
+    { "Uuml",    220 },
+    { "Yacute",  221 },
+    { "Yuml",    0x0178 },
+    { "aacute",  225 },
+    { "acirc",   226 },
+    { "acute",   180 },
+    { "aelig",   230 },
+    { "agrave",  224 },
+    { "amp",     '&' },
+    { "aring",   229 },
+    { "atilde",  227 },
+    { "auml",    228 },
+    { "brvbar",  166 },
+    { "bull",    0x2022 },
+    { "ccedil",  231 },
+    { "cedil",   184 },
+    { "cent",    162 },
+    { "copy",    169 },
+    { "curren",  164 },
+    { "dagger",  0x2020 },
+    { "deg",     176 },
+    { "divide",  247 },
+    { "eacute",  233 },
+    { "ecirc",   234 },
+    { "egrave",  232 },
+    { "eth",     240 },
+    { "euml",    235 },
+    { "euro",    0x20ac },
+    { "frac12",  189 },
+    { "frac14",  188 },
+    { "frac34",  190 },
+    { "gt",      '>' },
+    { "iacute",  237 },
+    { "icirc",   238 },
+    { "iexcl",   161 },
+    { "igrave",  236 },
+    { "iquest",  191 },
+    { "iuml",    239 },
+    { "laquo",   171 },
+    { "lt",      '<' },
+    { "macr",    175 },
+    { "micro",   181 },
+    { "middot",  183 },
+    { "nbsp",    ' ' },
+    { "ndash",   0x2013 },
+    { "not",     172 },
+    { "ntilde",  241 },
+    { "oacute",  243 },
+    { "ocirc",   244 },
+    { "ograve",  242 },
+    { "ordf",    170 },
+    { "ordm",    186 },
+    { "oslash",  248 },
+    { "otilde",  245 },
+    { "ouml",    246 },
+    { "para",    182 },
+    { "permil",  0x2030 },
+    { "plusmn",  177 },
+    { "pound",   163 },
+    { "quot",    '\"' },
+    { "raquo",   187 },
+    { "reg",     174 },
+    { "sect",    167 },
+    { "shy",     173 },
+    { "sup1",    185 },
+    { "sup2",    178 },
+    { "sup3",    179 },
+    { "szlig",   223 },
+    { "thorn",   254 },
+    { "times",   215 },
+    { "trade",   0x2122 },
+    { "uacute",  250 },
+    { "ucirc",   251 },
+    { "ugrave",  249 },
+    { "uml",     168 },
+    { "uuml",    252 },
+    { "yacute",  253 },
+    { "yen",     165 },
+    { "yuml",    255 }
   };
+  int   lo, hi, len;            // Binary search range and name length
 
-  if (!strchr(p, ';')) return -1;
+  // The number or name must be followed by ';', which is searched only
+  // past its digits, or as far as the longest name, so that a stray '&'
+  // does not scan the whole text...
   if (*p == '#') {
-    if (*(p+1) == 'x' || *(p+1) == 'X') return (int)strtol(p+2, NULL, 16);
-    else return atoi(p+1);
+    int hex = (p[1] == 'x' || p[1] == 'X');
+    const char *d = p + 1 + hex;
+    for (len = 0; hex ? isxdigit(d[len] & 255) : isdigit(d[len] & 255); len ++) {/*empty*/}
+    if (!len || d[len] != ';') return -1;
+    return (int)strtol(d, NULL, hex ? 16 : 10);
+  }
+
+  for (len = 0; len < 8 && isalnum(p[len] & 255); len ++) {/*empty*/}
+  if (p[len] != ';') return -1;
+
+  for (lo = 0, hi = (int)(sizeof(names) / sizeof(names[0])); lo < hi;) {
+    int mid = (lo + hi) / 2;
+    int c = strncmp(p, names[mid].name, len);
+    if (c == 0) c = -(names[mid].name[len] != 0); // names[mid] is longer
+    if (c == 0) return names[mid].code;
+    if (c < 0) hi = mid;
+    else lo = mid + 1;
   }
-  for (i = (int)(sizeof(names) / sizeof(names[0])), nameptr = names; i > 0; i --, nameptr ++)
-    if (strncmp(p, nameptr->name, nameptr->namelen) == 0)
-      return nameptr->code;
 
   return -1;
 }
@@ -0,0 +1,389 @@
+//
+// Image scaling for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "Fl_Image_Scale.h"
+#include "Fl_Worker_Pool.h"
+#include "../hdr/math.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FL_SCALE_SSE2 1
+#endif
+
+// Weights are fixed point numbers with this many fraction bits
+#define WBITS 14
+#define WONE (1 << WBITS)
+// The horizontal pass keeps this many fraction bits of the 8 bit values
+#define HBITS 6
+// Scalings with less work than this (pixels times taps) use one thread
+#define MIN_PARALLEL_WORK (1 << 18)
+
+// The weights of the source pixels for each destination pixel along one axis
+struct Fl_Scale_Weights {
+  int n;                        // #taps (source pixels) per destination pixel
+  int *first;                   // first source pixel of each destination pixel
+  short *w;                     // n weights per destination pixel, summing up to WONE
+};
+
+// Everything the passes of one scaling need
+struct Fl_Scale_Job {
+  const uchar *src;             // source pixels..
+  int sw, sh, d, ld;            // ..their size, depth and line size in bytes
+  uchar *dst;                   // destination pixels, dw * d bytes per line
+  int dw, dh;
+  int alpha;                    // 1: the last channel is alpha
+  int *xoff, *yrow;             // nearest: source byte offset and row of each pixel
+  Fl_Scale_Weights xw, yw;      // filtered: the weights along x and y
+  char *used;                   // filtered: 1 for source rows yw uses
+  short *buf;                   // filtered: the rows of the horizontal pass
+};
+
+typedef void (*Fl_Scale_Rows)(const Fl_Scale_Job *job, int from, int to);
+
+// A range of rows of a pass, run by a worker thread
+struct Fl_Scale_Stripe {
+  Fl_Scale_Rows run;
+  const Fl_Scale_Job *job;
+  int from, to;
+};
+
+// The pool of the threads scaling images, created on first use
+static Fl_Worker_Pool *scale_pool() {
+  static Fl_Worker_Pool *pool = 0;
+  if (!pool) pool = new Fl_Worker_Pool();
+  return pool;
+}
+
+static void run_stripe(void *v) {
+  Fl_Scale_Stripe *s = (Fl_Scale_Stripe*)v;
+  s->run(s->job, s->from, s->to);
+}
+
+// Run rows 0..rows-1 of a pass, split among the threads if there is enough work
+static void run_rows(Fl_Scale_Rows run, const Fl_Scale_Job *job, int rows, double work) {
+  Fl_Worker_Pool *pool = work < MIN_PARALLEL_WORK ? 0 : scale_pool();
+  int n = pool ? pool->threads() * 2 : 1;
+  if (n > rows) n = rows;
+  if (n < 2) {
+    run(job, 0, rows);
+    return;
+  }
+  Fl_Scale_Stripe *s = (Fl_Scale_Stripe*)malloc(n * sizeof(Fl_Scale_Stripe));
+  for (int i = 0; i < n; i++) {
+    s[i].run = run;
+    s[i].job = job;
+    s[i].from = (int)((long)rows * i / n);
+    s[i].to = (int)((long)rows * (i + 1) / n);
+  }
+  for (int i = 1; i < n; i++) pool->submit(run_stripe, s + i);
+  run_stripe(s);                // this thread takes the first stripe
+  pool->wait();
+  free(s);
+}
+
+// Source pixel of each destination pixel, like Bresenham's line algorithm
+static void nearest_table(int *t, int slen, int dlen, int mul) {
+  int mod = slen % dlen, step = slen / dlen, err = dlen, s = 0;
+  for (int i = 0; i < dlen; i++) {
+    t[i] = s * mul;
+    s += step;
+    err -= mod;
+    if (err <= 0) {
+      err += dlen;
+      s++;
+    }
+  }
+}
+
+static void nearest_rows(const Fl_Scale_Job *job, int from, int to) {
+  const int d = job->d, dw = job->dw;
+  const int *xoff = job->xoff;
+  for (int y = from; y < to; y++) {
+    const uchar *s = job->src + (long)job->yrow[y] * job->ld;
+    uchar *p = job->dst + (long)y * dw * d;
+    int x;
+    switch (d) {
+      case 1:
+        for (x = 0; x < dw; x++) *p++ = s[xoff[x]];
+        break;
+      case 2:
+        for (x = 0; x < dw; x++, p += 2) {
+          const uchar *q = s + xoff[x];
+          p[0] = q[0]; p[1] = q[1];
+        }
+        break;
+      case 3:
+        for (x = 0; x < dw; x++, p += 3) {
+          const uchar *q = s + xoff[x];
+          p[0] = q[0]; p[1] = q[1]; p[2] = q[2];
+        }
+        break;
+      case 4:
+        for (x = 0; x < dw; x++, p += 4) memcpy(p, s + xoff[x], 4);
+        break;
+      default:
+        for (x = 0; x < dw; x++, p += d) memcpy(p, s + xoff[x], d);
+        break;
+    }
+  }
+}
+
+// Bilinear weights, sampling the source at i * (slen - 1) / dlen
+static void bilinear_weights(Fl_Scale_Weights &wt, int slen, int dlen) {
+  wt.n = slen > 1 ? 2 : 1;
+  wt.first = (int*)malloc(dlen * sizeof(int));
+  wt.w = (short*)malloc(dlen * wt.n * sizeof(short));
+  const float scale = (slen - 1) / (float)dlen;
+  for (int i = 0; i < dlen; i++) {
+    short *w = wt.w + i * wt.n;
+    if (wt.n == 1) {
+      wt.first[i] = 0;
+      w[0] = WONE;
+      continue;
+    }
+    float o = i * scale;
+    int left = (int)o;
+    if (left > slen - 2) left = slen - 2;
+    int f = (int)((o - left) * WONE + 0.5f);
+    if (f > WONE) f = WONE;
+    wt.first[i] = left;
+    w[0] = (short)(WONE - f);
+    w[1] = (short)f;
+  }
+}
+
+// Catmull-Rom cubic at distance x
+static double catmull_rom(double x) {
+  x = fabs(x);
+  if (x < 1) return (1.5 * x - 2.5) * x * x + 1;
+  if (x < 2) return ((-0.5 * x + 2.5) * x - 4) * x + 2;
+  return 0;
+}
+
+// Lanczos window of 3 lobes at distance x
+static double lanczos3(double x) {
+  x = fabs(x);
+  if (x < 1e-8) return 1;
+  if (x >= 3) return 0;
+  double px = M_PI * x;
+  return 3 * sin(px) * sin(px / 3) / (px * px);
+}
+
+/*
+  Weights of the box, Catmull-Rom and Lanczos filters.
+
+  Destination pixel i covers source pixels (i..i+1) * slen / dlen. When
+  shrinking the filter is stretched by the scale, so that each destination
+  pixel averages all the source pixels it covers; the box filter weighs
+  them by how much of them it covers. Pixels beyond the edges are those
+  at the edges. The weights are rounded so that their sum stays exactly WONE.
+*/
+static void filter_weights(Fl_Scale_Weights &wt, int slen, int dlen, Fl_RGB_Scaling method) {
+  const double scale = (double)slen / dlen;
+  const double stretch = scale > 1 ? scale : 1;
+  double radius = method == FL_RGB_SCALING_BOX ? 0.5 :
+                  method == FL_RGB_SCALING_CATMULL_ROM ? 2 : 3;
+  const double support = radius * stretch;
+  int n = (int)ceil(2 * support) + 1;
+  if (n > slen) n = slen;
+  wt.n = n;
+  wt.first = (int*)malloc(dlen * sizeof(int));
+  wt.w = (short*)malloc(dlen * n * sizeof(short));
+  double *f = (double*)malloc(n * sizeof(double));
+  for (int i = 0; i < dlen; i++) {
+    const double center = (i + 0.5) * scale;
+    int first = (int)floor(center - support);
+    if (first > slen - n) first = slen - n;
+    if (first < 0) first = 0;
+    int k, j, jmax = (int)ceil(center + support);
+    double sum = 0;
+    for (k = 0; k < n; k++) f[k] = 0;
+    for (j = (int)floor(center - support); j < jmax; j++) {
+      double v;
+      if (method == FL_RGB_SCALING_BOX) {       // coverage of source pixel j
+        double l = center - support, r = center + support;
+        v = (r < j + 1 ? r : j + 1) - (l > j ? l : j);
+        if (v <= 0) continue;
+      } else if (method == FL_RGB_SCALING_CATMULL_ROM) {
+        v = catmull_rom((j + 0.5 - center) / stretch);
+      } else {
+        v = lanczos3((j + 0.5 - center) / stretch);
+      }
+      k = (j < 0 ? 0 : j >= slen ? slen - 1 : j) - first;
+      f[k < 0 ? 0 : k >= n ? n - 1 : k] += v;
+      sum += v;
+    }
+    short *w = wt.w + i * n;
+    int total = 0, big = 0;
+    for (k = 0; k < n; k++) {
+      w[k] = sum ? (short)floor(f[k] / sum * WONE + 0.5) : (short)(k == 0 ? WONE : 0);
+      total += w[k];
+      if (abs(w[k]) > abs(w[big])) big = k;
+    }
+    w[big] = (short)(w[big] + WONE - total);
+    wt.first[i] = first;
+  }
+  free(f);
+}
+
+// Resample source rows from..to-1 that the vertical pass uses into job->buf.
+// With alpha the colors are premultiplied: the sums of color * alpha * weight
+// fit into an int, and are divided by 255 once.
+static void horizontal_rows(const Fl_Scale_Job *job, int from, int to) {
+  const int d = job->d, dw = job->dw, n = job->xw.n;
+  const int shift = WBITS - HBITS, round = 1 << (shift - 1);
+  for (int y = from; y < to; y++) {
+    if (!job->used[y]) continue;
+    const uchar *s = job->src + (long)y * job->ld;
+    short *out = job->buf + (long)y * dw * d;
+    for (int x = 0; x < dw; x++) {
+      const uchar *q = s + job->xw.first[x] * d;
+      const short *w = job->xw.w + x * n;
+      int c, t, acc;
+      if (job->alpha) {
+        const int a = d - 1;
+        for (c = 0; c < a; c++) {
+          for (t = 0, acc = 0; t < n; t++) acc += q[t * d + c] * q[t * d + a] * w[t];
+          *out++ = (short)((acc / 255 + round) >> shift);
+        }
+        for (t = 0, acc = 0; t < n; t++) acc += q[t * d + a] * w[t];
+        *out++ = (short)((acc + round) >> shift);
+      } else {
+        for (c = 0; c < d; c++) {
+          for (t = 0, acc = 0; t < n; t++) acc += q[t * d + c] * w[t];
+          *out++ = (short)((acc + round) >> shift);
+        }
+      }
+    }
+  }
+}
+
+// Sum destination rows from..to-1 from the rows of the horizontal pass
+static void vertical_rows(const Fl_Scale_Job *job, int from, int to) {
+  const int d = job->d, len = job->dw * d, n = job->yw.n;
+  const int shift = WBITS + HBITS, round = 1 << (shift - 1);
+  const short **rows = (const short**)malloc(n * sizeof(short*));
+  for (int y = from; y < to; y++) {
+    const short *w = job->yw.w + y * n;
+    int t, i = 0;
+    for (t = 0; t < n; t++) rows[t] = job->buf + (long)(job->yw.first[y] + t) * len;
+    uchar *out = job->dst + (long)y * len;
+#ifdef FL_SCALE_SSE2
+    for ( ; i + 8 <= len; i += 8) {
+      __m128i lo = _mm_set1_epi32(round), hi = lo;
+      for (t = 0; t < n; t += 2) {      // two rows at a time with pmaddwd
+        __m128i a = _mm_loadu_si128((const __m128i*)(rows[t] + i));
+        __m128i b = t + 1 < n ? _mm_loadu_si128((const __m128i*)(rows[t + 1] + i)) : _mm_setzero_si128();
+        int w1 = t + 1 < n ? w[t + 1] : 0;
+        __m128i ww = _mm_set1_epi32((int)((unsigned)w1 << 16 | (unsigned short)w[t]));
+        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), ww));
+        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), ww));
+      }
+      lo = _mm_srai_epi32(lo, shift);
+      hi = _mm_srai_epi32(hi, shift);
+      __m128i v = _mm_packs_epi32(lo, hi);
+      _mm_storel_epi64((__m128i*)(out + i), _mm_packus_epi16(v, v));
+    }
+#endif // FL_SCALE_SSE2
+    for ( ; i < len; i++) {
+      int acc = round;
+      for (t = 0; t < n; t++) acc += rows[t][i] * w[t];
+      acc >>= shift;
+      out[i] = (uchar)(acc < 0 ? 0 : acc > 255 ? 255 : acc);
+    }
+    if (job->alpha) {           // undo the premultiplication
+      for (uchar *p = out; p < out + len; p += d) {
+        int a = p[d - 1];
+        if (!a) continue;
+        for (int c = 0; c < d - 1; c++) {
+          int v = (p[c] * 255 + a / 2) / a;
+          p[c] = (uchar)(v > 255 ? 255 : v);
+        }
+      }
+    }
+  }
+  free(rows);
+}
+
+/**
+  Scale the \p sw x \p sh pixels of depth \p d at \p src, whose lines are
+  \p ld bytes apart, to the \p dw x \p dh pixels at \p dst, whose lines
+  are dw * d bytes apart.
+*/
+void Fl_Image_Scale::scale(const uchar *src, int sw, int sh, int d, int ld,
+                           uchar *dst, int dw, int dh, Fl_RGB_Scaling method) {
+  Fl_Scale_Job job;
+  memset(&job, 0, sizeof(job));
+  job.src = src;
+  job.sw = sw;
+  job.sh = sh;
+  job.d = d;
+  job.ld = ld ? ld : sw * d;
+  job.dst = dst;
+  job.dw = dw;
+  job.dh = dh;
+  job.alpha = (d == 2 || d == 4);
+
+  if (method == FL_RGB_SCALING_NEAREST) {
+    job.xoff = (int*)malloc(dw * sizeof(int));
+    job.yrow = (int*)malloc(dh * sizeof(int));
+    nearest_table(job.xoff, sw, dw, d);
+    nearest_table(job.yrow, sh, dh, 1);
+    run_rows(nearest_rows, &job, dh, (double)dw * dh);
+    free(job.xoff);
+    free(job.yrow);
+    return;
+  }
+
+  if (method == FL_RGB_SCALING_BILINEAR) {
+    bilinear_weights(job.xw, sw, dw);
+    bilinear_weights(job.yw, sh, dh);
+  } else {
+    filter_weights(job.xw, sw, dw, method);
+    filter_weights(job.yw, sh, dh, method);
+  }
+
+  // Only the source rows the vertical pass sums need a horizontal pass
+  int y, t, nused = 0;
+  job.used = (char*)calloc(sh, 1);
+  for (y = 0; y < dh; y++)
+    for (t = 0; t < job.yw.n; t++) job.used[job.yw.first[y] + t] = 1;
+  for (y = 0; y < sh; y++) nused += job.used[y];
+  job.buf = (short*)malloc((long)sh * dw * d * sizeof(short));
+
+  run_rows(horizontal_rows, &job, sh, (double)nused * dw * job.xw.n);
+  run_rows(vertical_rows, &job, dh, (double)dw * dh * job.yw.n);
+
+  free(job.buf);
+  free(job.used);
+  free(job.xw.first);
+  free(job.xw.w);
+  free(job.yw.first);
+  free(job.yw.w);
+}
+
+/**
+ \}
+ \endcond
+ */
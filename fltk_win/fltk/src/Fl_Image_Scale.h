@@ -0,0 +1,61 @@
+//
+// Image scaling for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#ifndef Fl_Image_Scale_H
+#define Fl_Image_Scale_H
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "../hdr/Fl_Export.h"
+#include "../hdr/Fl_Image.h"
+
+/** \file src/Fl_Image_Scale.h
+  Resampling of the pixel data of RGB images.
+*/
+
+/**
+  Resamples the pixel data of an RGB image to another size.
+
+  Nearest neighbor scaling copies the source pixel picked for each
+  destination pixel. The bilinear, box (area averaging), Catmull-Rom and
+  Lanczos filters are applied in two separable passes with fixed point
+  weight tables computed once per scaling: each source row is resampled
+  horizontally into a buffer of 16 bit values, and the destination rows
+  are summed from the buffer rows, which is done with
+  SSE2 where the compiler provides it. Color channels are premultiplied
+  by alpha for filtering, so transparent pixels do not bleed into their
+  neighbors.
+
+  Large images are scaled by several threads, each taking a range of rows.
+
+  \note This class is only for internal use by Fl_RGB_Image.
+*/
+class FL_EXPORT Fl_Image_Scale {
+public:
+  static void scale(const uchar *src, int sw, int sh, int d, int ld,
+                    uchar *dst, int dw, int dh, Fl_RGB_Scaling method);
+};
+
+/**
+ \}
+ \endcond
+ */
+
+#endif // Fl_Image_Scale_H
@@ -25,6 +25,10 @@
 #include "../hdr/Fl_XPM_Image.h"
 #include "../hdr/Fl_Preferences.h"
 #include "../hdr/fl_draw.h"
+#include "../hdr/Fl_Device.h"
+#include "../hdr/Fl_Graphics_Driver.h"
+#include "../hdr/math.h"
+#include "Fl_Worker_Pool.h"
 
 //
 // Global class vars...
@@ -38,13 +42,46 @@ Fl_Shared_Handler *Fl_Shared_Image::handlers_ = 0;// Additional format handlers
 int     Fl_Shared_Image::num_handlers_ = 0;     // Number of format handlers
 int     Fl_Shared_Image::alloc_handlers_ = 0;   // Allocated format handlers
 
+size_t  Fl_Shared_Image::cache_size_ = 0;       // Bytes of released images kept in the pool
+size_t  Fl_Shared_Image::cache_bytes_ = 0;      // Bytes of all images in the pool
+long    Fl_Shared_Image::cache_hits_ = 0;       // Requests found in the pool
+long    Fl_Shared_Image::cache_misses_ = 0;     // Requests that loaded the file
+long    Fl_Shared_Image::cache_evictions_ = 0;  // Released images deleted by the cache
+Fl_Shared_Image *Fl_Shared_Image::lru_first_ = 0; // Most recently released image
+Fl_Shared_Image *Fl_Shared_Image::lru_last_ = 0;  // Least recently released image
+
 
 //
-// Typedef the C API sort function type the only way I know how...
+// Pending get_async() requests, one per image file...
 //
 
-extern "C" {
-  typedef int (*compare_func_t)(const void *, const void *);
+struct Fl_Shared_Image_Waiter {
+  int                   W, H;           // Requested size
+  Fl_Shared_Image_Cb    cb;             // Callback and..
+  void                  *data;          // ..its data
+  Fl_Shared_Image       *img;           // The image given to the callback
+  Fl_Shared_Image_Waiter *next;         // Next request of the file
+};
+
+struct Fl_Shared_Image_Request {
+  char                  *name;          // Image file
+  Fl_Image              *image;         // Decoded image, NULL if not (yet) decoded
+  Fl_Shared_Image_Waiter *waiters;      // Requests of the file, in order
+  Fl_Shared_Image_Request *next;        // Next pending file
+};
+
+static Fl_Shared_Image_Request *async_requests = 0;
+
+//
+// Approximate size of the data of an image, for the cache budget...
+//
+
+static size_t image_bytes(const Fl_Image *img) {
+  if (!img) return 0;
+  size_t pixels = (size_t)img->data_w() * img->data_h();
+  if (img->d() > 0) return pixels * img->d();   // RGB image
+  if (img->d() == 0) return pixels / 8;         // bitmap
+  return pixels;                                // pixmap
 }
 
 
@@ -77,13 +114,9 @@ int Fl_Shared_Image::num_images() {
     -# Image width
     -# Image height
 
-  Binary search in a sorted array works only if we search for the same
-  parameters that were also used for sorting. No special cases are possible
-  here.
-
-  Fl_Shared_Image::find() requires a search for an element with a matching name
-  and the original_ flags set. This is not implemented via binary search, but
-  by a simple run of the array inside Fl_Shared_Image::find().
+  Images with the same name and size follow each other in the pool.
+  Fl_Shared_Image::find() searches for the first of them and then looks
+  for the original image or the copy made with the current RGB_scaling().
 
   \param[in] i0, i1 image pointer pointer for sorting
   \returns      Whether the images match or their relative sort order (see text).
@@ -117,6 +150,12 @@ Fl_Shared_Image::Fl_Shared_Image() : Fl_Image(0,0,0) {
   original_    = 0;
   image_       = 0;
   alloc_image_ = 0;
+  bytes_       = 0;
+  pooled_      = 0;
+  scaling_     = -1;
+  cacheable_   = 1;
+  lru_prev_    = 0;
+  lru_next_    = 0;
 }
 
 
@@ -140,6 +179,12 @@ Fl_Shared_Image::Fl_Shared_Image(const char *n,
   image_       = img;
   alloc_image_ = !img;
   original_    = 1;
+  bytes_       = 0;
+  pooled_      = 0;
+  scaling_     = -1;
+  cacheable_   = 1;
+  lru_prev_    = 0;
+  lru_next_    = 0;
 
   if (!img) reload();
   else update();
@@ -158,6 +203,7 @@ Fl_Shared_Image::Fl_Shared_Image(const char *n,
 void
 Fl_Shared_Image::add() {
   Fl_Shared_Image       **temp;         // New image pointer array...
+  int                   i;              // Position in the pool
 
   if (num_images_ >= alloc_images_) {
     // Allocate more memory...
@@ -173,13 +219,59 @@ Fl_Shared_Image::add() {
     alloc_images_ += 32;
   }
 
-  images_[num_images_] = this;
+  // Insert the image after those with the same name and size
+  i = lower_bound_(name_, data_w(), data_h());
+  while (i < num_images_ && !strcmp(images_[i]->name_, name_) &&
+         images_[i]->data_w() == data_w() && images_[i]->data_h() == data_h())
+    i ++;
+  memmove(images_ + i + 1, images_ + i,
+          (num_images_ - i) * sizeof(Fl_Shared_Image *));
+  images_[i] = this;
   num_images_ ++;
+  pooled_ = 1;
+  cache_bytes_ += bytes_;
+}
+
+/**
+  Removes the image from the pool, without deleting it.
+*/
+void
+Fl_Shared_Image::remove_() {
+  int   i;      // Looping var...
+
+  for (i = lower_bound_(name_, data_w(), data_h()); i < num_images_; i ++) {
+    if (images_[i] == this) {
+      num_images_ --;
+
+      if (i < num_images_) {
+        memmove(images_ + i, images_ + i + 1,
+                (num_images_ - i) * sizeof(Fl_Shared_Image *));
+      }
 
-  if (num_images_ > 1) {
-    qsort(images_, num_images_, sizeof(Fl_Shared_Image *),
-          (compare_func_t)compare);
+      break;
+    }
   }
+  pooled_ = 0;
+  cache_bytes_ -= bytes_;
+}
+
+/**
+  Returns the position of the first image in the pool that is not less
+  than name \p name and size \p W x \p H, in the order of compare().
+*/
+int
+Fl_Shared_Image::lower_bound_(const char *name, int W, int H) {
+  int lo = 0, hi = num_images_;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    Fl_Shared_Image *img = images_[mid];
+    int c = strcmp(img->name_, name);
+    if (!c) c = img->data_w() - W;
+    if (!c) c = img->data_h() - H;
+    if (c < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
 }
 
 /**
@@ -189,6 +281,10 @@ Fl_Shared_Image::add() {
  */
 void
 Fl_Shared_Image::update() {
+  // The pool is sorted by size, so a reloaded image of another size moves
+  int moved = pooled_ && image_ &&
+              (image_->data_w() != data_w() || image_->data_h() != data_h());
+  if (moved) remove_();
   if (image_) {
     int W = w(), H = h();
     w(image_->data_w());
@@ -197,6 +293,10 @@ Fl_Shared_Image::update() {
     data(image_->data(), image_->count());
     if (W && H) scale(W, H, 0, 1);
   }
+  if (pooled_) cache_bytes_ -= bytes_;
+  bytes_ = image_bytes(image_);
+  if (pooled_) cache_bytes_ += bytes_;
+  if (moved) add();
 }
 
 /**
@@ -216,11 +316,14 @@ Fl_Shared_Image::~Fl_Shared_Image() {
 
   In the latter case, it will reorganize the shared image array
   so that no hole will occur.
+
+  If a cache size is set, an image the pool owns is not destroyed
+  but kept in the pool, until the cache needs the memory for more
+  recently released images.
+
+  \see cache_size(size_t)
 */
 void Fl_Shared_Image::release() {
-  int   i;      // Looping var...
-  Fl_Shared_Image *the_original = NULL;
-
 #ifdef SHIM_DEBUG
   printf("----> Fl_Shared_Image::release() %d %s %d %d\n", original_, name_, w(), h());
   print_pool();
@@ -230,30 +333,39 @@ void Fl_Shared_Image::release() {
   refcount_ --;
   if (refcount_ > 0) return;
 
-  // If this image is not the original, find the original image and make sure
-  // to delete its reference counter as well at the end of this method.
-  if (!original()) {
-    Fl_Shared_Image *o = find(name());
-    if (o) {
-      if (o->original() && o!=this && o->refcount_>1)
-        the_original = o; // mark to release later
-      o->release(); // release from find() operation
-    }
+  // Keep the image in the pool if it can be found again (a copy keeps
+  // its reference to the original while it is cached)
+  if (cache_size_ && alloc_image_ && image_ && pooled_ && cacheable_) {
+    lru_add_();
+    trim_cache_();
+  } else {
+    destroy_();
   }
+#ifdef SHIM_DEBUG
+  printf("<---- Fl_Shared_Image::release()\n");
+  print_pool();
+  printf("\n");
+#endif
+}
 
-  for (i = 0; i < num_images_; i ++) {
-    if (images_[i] == this) {
-      num_images_ --;
+/**
+  Removes the image from the pool and deletes it.
 
-      if (i < num_images_) {
-        memmove(images_ + i, images_ + i + 1,
-                (num_images_ - i) * sizeof(Fl_Shared_Image *));
-      }
+  A copy also releases its reference to the original image.
+*/
+void Fl_Shared_Image::destroy_() {
+  Fl_Shared_Image *the_original = NULL;
 
-      break;
-    }
+  // If this image is not the original, find the original image and make sure
+  // to delete its reference counter as well at the end of this method.
+  if (!original()) {
+    Fl_Shared_Image *o = find_(name(), 0, 0);
+    if (o && o != this && o->refcount_ > 0)
+      the_original = o; // mark to release later
   }
 
+  if (pooled_) remove_();
+
   delete this;
 
   if (num_images_ == 0 && images_) {
@@ -262,50 +374,137 @@ void Fl_Shared_Image::release() {
     images_       = 0;
     alloc_images_ = 0;
   }
-#ifdef SHIM_DEBUG
-  printf("<---- Fl_Shared_Image::release() %d %s %d %d\n", original_, name_, w(), h());
-  print_pool();
-  printf("\n");
-#endif
 
   // Release one reference count in the original image as well.
   if (the_original)
     the_original->release();
 }
 
-/** Reloads the shared image from disk. */
-void Fl_Shared_Image::reload() {
-  // Load image from disk...
+/** Puts a released image first in the list of cached images. */
+void Fl_Shared_Image::lru_add_() {
+  lru_prev_ = 0;
+  lru_next_ = lru_first_;
+  if (lru_first_) lru_first_->lru_prev_ = this;
+  else lru_last_ = this;
+  lru_first_ = this;
+}
+
+/** Takes an image that is used again out of the list of cached images. */
+void Fl_Shared_Image::lru_remove_() {
+  if (lru_prev_) lru_prev_->lru_next_ = lru_next_;
+  else lru_first_ = lru_next_;
+  if (lru_next_) lru_next_->lru_prev_ = lru_prev_;
+  else lru_last_ = lru_prev_;
+  lru_prev_ = lru_next_ = 0;
+}
+
+/**
+  Deletes the least recently released images until the pool fits
+  into the cache size, or no released images are left.
+*/
+void Fl_Shared_Image::trim_cache_() {
+  // Deleting a copy may release its original, which is then cached
+  // first, so this takes the last image again each time
+  while (lru_last_ && cache_bytes_ > cache_size_) {
+    Fl_Shared_Image *img = lru_last_;
+    img->lru_remove_();
+    cache_evictions_ ++;
+    img->destroy_();
+  }
+}
+
+/**
+  Sets the memory budget of the shared image cache.
+
+  When the cache size is not 0, images whose refcount drops to 0 stay
+  in the pool, so that getting them again with get() or find() does not
+  load the file again. When the images in the pool take up more than
+  \p bytes, the images released the longest time ago are deleted until
+  the pool fits again. Images that are still in use are never deleted,
+  so the pool can be bigger than the cache size.
+
+  Images made with get(Fl_RGB_Image*, int) are deleted when released,
+  whether the pool owns them or not, because their generated name can't
+  be looked up again. The default size is 0, which deletes all images
+  when they are released.
+
+  \param[in] bytes approximate size of the pixel data of all images
+  \see cache_bytes(), cache_hits(), cache_misses(), cache_evictions()
+  \see flush_cache()
+*/
+void Fl_Shared_Image::cache_size(size_t bytes) {
+  cache_size_ = bytes;
+  if (!cache_size_) flush_cache();
+  else trim_cache_();
+}
+
+/**
+  Deletes all cached images that are not in use.
+
+  The cache size does not change, images released later are cached
+  again.
+*/
+void Fl_Shared_Image::flush_cache() {
+  while (lru_last_) {
+    Fl_Shared_Image *img = lru_last_;
+    img->lru_remove_();
+    cache_evictions_ ++;
+    img->destroy_();
+  }
+}
+
+/**
+  Reads and decodes the image file \p name, without adding it to the pool.
+
+  The file type is detected like reload() does. This does not use the
+  pool or draw anything, so it may be called from a worker thread as
+  long as the image handlers do not call FLTK either.
+
+  \param[in] name name of the image file
+  \return a new image that the caller must delete, or NULL if the file
+        can't be read or its format is not known
+*/
+Fl_Image *Fl_Shared_Image::decode(const char *name) {
   int           i;              // Looping var
   int           count = 0;      // number of bytes read from image header
   FILE          *fp;            // File pointer
   uchar         header[64];     // Buffer for auto-detecting files
   Fl_Image      *img;           // New image
 
-  if (!name_) return;
-
-  if ((fp = fl_fopen(name_, "rb")) != NULL) {
+  if ((fp = fl_fopen(name, "rb")) != NULL) {
     count = (int)fread(header, 1, sizeof(header), fp);
     fclose(fp);
     if (count == 0)
-      return;
+      return 0;
   } else {
-    return;
+    return 0;
   }
 
   // Load the image as appropriate...
   if (count >= 7 && memcmp(header, "#define", 7) == 0) // XBM file
-    img = new Fl_XBM_Image(name_);
+    img = new Fl_XBM_Image(name);
   else if (count >= 9 && memcmp(header, "/* XPM */", 9) == 0) // XPM file
-    img = new Fl_XPM_Image(name_);
+    img = new Fl_XPM_Image(name);
   else {
     // Not a standard format; try an image handler...
     for (i = 0, img = 0; i < num_handlers_; i ++) {
-      img = (handlers_[i])(name_, header, count);
+      img = (handlers_[i])(name, header, count);
       if (img) break;
     }
   }
 
+  return img;
+}
+
+/** Reloads the shared image from disk. */
+void Fl_Shared_Image::reload() {
+  // Load image from disk...
+  Fl_Image      *img;           // New image
+
+  if (!name_) return;
+
+  img = decode(name_);
+
   if (img) {
     if (alloc_image_) delete image_;
 
@@ -349,6 +548,7 @@ Fl_Shared_Image::copy_(int W, int H) const {
   temp_shared->refcount_    = 1;
   temp_shared->image_       = temp_image;
   temp_shared->alloc_image_ = 1;
+  if (image_ && image_->d() > 0) temp_shared->scaling_ = RGB_scaling();
 
   temp_shared->update();
 
@@ -440,6 +640,12 @@ Fl_Shared_Image::desaturate() {
 /**
  Draw this image to the current graphics context.
 
+ If a cache size is set and the image is drawn at another size than its
+ data, the image is drawn from a copy of the size in drawing units, which
+ is kept in the pool like copy(int, int) does. Widgets that draw the image
+ at the same size share the copy, and it is not scaled again each time the
+ image is drawn at another size or scale factor.
+
  \param[in] X, Y, W, H draw at this position and size
  \param[in] cx, cy image origin
  */
@@ -448,11 +654,26 @@ void Fl_Shared_Image::draw(int X, int Y, int W, int H, int cx, int cy) {
     Fl_Image::draw(X, Y, W, H, cx, cy);
     return;
   }
-  // transiently set the drawing size of image_ to that of the shared image
-  int width = image_->w(), height = image_->h();
-  image_->scale(w(), h(), 0, 1);
-  image_->draw(X, Y, W, H, cx, cy);
-  image_->scale(width, height, 0, 1);
+  Fl_Image *img = image_;
+  Fl_Shared_Image *variant = 0;
+  if (cache_size_ && pooled_ && image_->d() > 0 && w() > 0 && h() > 0) {
+    // draw a copy with the size in drawing units, which is kept in the pool
+    // with its own device data for other widgets and scale factors
+    float s = Fl_Surface_Device::surface()->driver()->scale();
+    if (fabs(w() - data_w() / s) / w() > 0.05 || fabs(h() - data_h() / s) / h() > 0.05) {
+      Fl_RGB_Scaling keep = RGB_scaling();
+      RGB_scaling(scaling_algorithm());
+      variant = get(name_, int(w() * s + 0.5), int(h() * s + 0.5));
+      RGB_scaling(keep);
+      if (variant && variant->image_) img = variant->image_;
+    }
+  }
+  // transiently set the drawing size of img to that of the shared image
+  int width = img->w(), height = img->h();
+  img->scale(w(), h(), 0, 1);
+  img->draw(X, Y, W, H, cx, cy);
+  img->scale(width, height, 0, 1);
+  if (variant) variant->release();
 }
 
 /**
@@ -470,7 +691,9 @@ void Fl_Shared_Image::uncache()
   This uses a binary search in the image cache.
 
   If the image \p name exists with the exact width \p W and height \p H,
-  then it is returned.
+  then it is returned. If there are several resized copies of an RGB image
+  with that size, made with different Fl_Image::RGB_scaling() methods, the
+  one made with the current method is preferred.
 
   If \p W == 0 and the image \p name exists with another size, then the
   \b original image with that \p name is returned.
@@ -482,11 +705,7 @@ void Fl_Shared_Image::uncache()
   An image is marked \p original if it was directly loaded from a file or
   from memory as opposed to copied and resized images.
 
-  This comparison is used in Fl_Shared_Image::find() to find an image that
-  matches the requested one or to find the position where a new image
-  should be entered into the sorted list of shared images.
-
-  It is used in two steps by Fl_Shared_Image::add():
+  It is used in two steps by Fl_Shared_Image::get():
 
   -# search with exact width and height
   -# if not found, search again with width = 0 (and height = 0)
@@ -496,47 +715,35 @@ void Fl_Shared_Image::uncache()
   marked \p original with the same name, regardless of width and height.
 */
 Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
-  if (num_images_) {
-    if (W) {
-      Fl_Shared_Image *key;     // Image key
-      Fl_Shared_Image **match;  // Matching image
-
-      key = new Fl_Shared_Image();
-      key->name_ = new char[strlen(name) + 1];
-      strcpy((char *)key->name_, name);
-      key->w(W);
-      key->h(H);
-
-      match = (Fl_Shared_Image **)bsearch(&key, images_, num_images_,
-                                          sizeof(Fl_Shared_Image *),
-                                          (compare_func_t)compare);
-
-      delete key;
-
-      if (match) {
-        (*match)->refcount_ ++;
-        return *match;
-      }
+  Fl_Shared_Image *img = find_(name, W, H);
+  if (img) {
+    if (img->refcount_ <= 0) img->lru_remove_();    // cached, used again
+    img->refcount_ ++;
+  }
+  return img;
+}
+
+/**
+  Finds a shared image like find() without changing its refcount.
+  If \p same_scaling is set, a resized copy made with another
+  RGB_scaling() than the current one is not returned.
+*/
+Fl_Shared_Image* Fl_Shared_Image::find_(const char *name, int W, int H, int same_scaling) {
+  Fl_Shared_Image *other = NULL;        // same size, other scaling method
+  // The images with this name follow each other, ordered by size
+  for (int i = lower_bound_(name, W, H); i < num_images_; i ++) {
+    Fl_Shared_Image *img = images_[i];
+    if (strcmp(img->name_, name)) break;
+    if (!W) {
+      if (img->original_) return img;
     } else {
-      // if no width was given we need to find the original. The list is sorted
-      // by name, width, and height, but we need to find the item by name with
-      // the original_ flags set, no matter how wide, so binary search does not
-      // work here.
-      int i;
-      for (i = 0; i < num_images_; ++i) {
-        // If there are thousands of images and running the array becomes
-        // inefficient, we can hand implement a binary search by name, and then
-        // search back and forth from that location for the member with the
-        // original_ flag set.
-        Fl_Shared_Image *img = images_[i];
-        if (img->original_ && img->name_ && (strcmp(img->name_, name) == 0)) {
-          img->refcount_++;
-          return img;
-        }
-      }
+      if (img->data_w() != W || img->data_h() != H) break;
+      if (img->original_ || img->scaling_ < 0 || img->scaling_ == RGB_scaling())
+        return img;
+      if (!other) other = img;
     }
   }
-  return NULL;
+  return same_scaling ? NULL : other;
 }
 
 /**
@@ -547,7 +754,9 @@ Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
   If the image exists, but only with another size, then a new copy with the
   requested size (width \p W and height \p H) will be created as a resized
   copy of the original image. The new image is added to the internal list
-  of shared images.
+  of shared images. Copies of RGB images are scaled with the current
+  Fl_Image::RGB_scaling(), and a copy of the same size made with another
+  scaling method is not returned.
 
   If the image does not yet exist, then a new image of the proper
   dimension is created from the filename \p name. The original image
@@ -560,6 +769,9 @@ Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
         This is intentional so the original image is cached and preserved.
         If you request the same image with another size later, then the
         \b original image will be found, copied, resized, and returned.
+        Without a cache_size() the original loaded for a copy is kept until
+        the program exits; with one it is kept while the copy is in the
+        pool, and then cached like other released images.
 
   Shared JPEG and PNG images can also be created from memory by using their
   named memory access constructor.
@@ -577,21 +789,43 @@ Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
   \see Fl_PNG_Image::Fl_PNG_Image (const char *name_png, const unsigned char *buffer, int maxsize)
 */
 Fl_Shared_Image* Fl_Shared_Image::get(const char *name, int W, int H) {
+  return get_(name, 0, W, H);
+}
+
+/**
+  Finds or adds an image like get(const char *name, int W, int H).
+
+  If \p img is not NULL it is the decoded file \p name (see decode()),
+  which is added to the pool instead of loading the file again. The
+  shared image takes ownership of \p img, which is deleted right away if
+  the pool already has an image by that name.
+*/
+Fl_Shared_Image* Fl_Shared_Image::get_(const char *name, Fl_Image *img, int W, int H) {
   Fl_Shared_Image *temp;
   bool temp_referenced = false;
 
-  // Find an image by the requested size
-  // ::find() increments the ref count for us
-  if ((temp = find(name, W, H)) != NULL)
+  // Find an image by the requested size, made with the current
+  // RGB_scaling(): otherwise a copy is made with it below
+  if ((temp = find_(name, W, H, 1)) != NULL) {
+    if (temp->refcount_ <= 0) temp->lru_remove_();  // cached, used again
+    temp->refcount_ ++;
+    cache_hits_ ++;
+    delete img;
     return temp;
+  }
 
   // Find the original image, size does not matter
   temp = find(name);
   if (temp) {
+    cache_hits_ ++;
     temp_referenced = true;
+    delete img;
   } else {
+    cache_misses_ ++;
     // No original found, so we generate it by loading the file
-    temp = new Fl_Shared_Image(name);
+    // (or from the decoded image)
+    temp = new Fl_Shared_Image(name, img);
+    temp->alloc_image_ = 1;
     // We can't load the file or create the image, so return fail
     if (!temp->image_) {
       delete temp;
@@ -606,9 +840,15 @@ Fl_Shared_Image* Fl_Shared_Image::get(const char *name, int W, int H) {
   if ((temp->w() != W || temp->h() != H) && W && H) {
     // Generate a copy with the new size, the copy gets refcount 1
     Fl_Shared_Image *new_temp = temp->copy_(W, H);
-    if (!new_temp) return NULL;
-    // Also increment the refcount of the original image
-    if (!temp_referenced)
+    if (!new_temp) {
+      temp->release();                  // nobody holds the original then
+      return NULL;
+    }
+    // The copy keeps a reference to the original. Without a cache the
+    // original gets one more, which is never released, to preserve it;
+    // with a cache the copy's reference keeps it, so the original is
+    // cached and evicted after the copy
+    if (!temp_referenced && !cache_size_)
       temp->refcount_++;
     // add the newly created image to the pool and return it
     new_temp->add();
@@ -630,10 +870,152 @@ Fl_Shared_Image *Fl_Shared_Image::get(Fl_RGB_Image *rgb, int own_it)
 {
   Fl_Shared_Image *shared = new Fl_Shared_Image(Fl_Preferences::newUUID(), rgb);
   shared->alloc_image_ = own_it;
+  shared->cacheable_   = 0;     // nobody knows the generated name
   shared->add();
   return shared;
 }
 
+/**
+  Gets an image like get() without loading the file on the calling thread.
+
+  If the image is in the pool \p cb is called right away. Otherwise the
+  file is read and decoded on a worker thread, and \p cb is called in the
+  main thread once the image is ready (see Fl::awake()). Requests of the
+  same file that arrive meanwhile share the decoding, each gets the image
+  in the size it asked for.
+
+  \p cb gets the image, or NULL if it could not be loaded, and \p data.
+  It must release() the image when it is no longer needed, like images
+  returned by get(). A widget that goes away before its images arrive
+  must call cancel_async().
+
+  As for all threaded FLTK programs, the application must call Fl::lock()
+  before Fl::run() for the images to be delivered promptly. The image
+  handlers (see add_handler()) are called on worker threads, so they must
+  not call FLTK functions.
+
+  \param[in] name  name of the image file
+  \param[in] W, H  desired size, see get()
+  \param[in] cb    function called with the image
+  \param[in] data  user data passed to \p cb
+
+  \see get(), cancel_async()
+  \since 1.4.0
+*/
+void Fl_Shared_Image::get_async(const char *name, int W, int H,
+                                Fl_Shared_Image_Cb cb, void *data) {
+  Fl_Shared_Image_Request *req;
+  Fl_Shared_Image_Waiter  *w, **wp;
+
+  if (find_(name, 0, 0)) {      // in the pool, only resizing is left
+    cb(get(name, W, H), data);
+    return;
+  }
+
+  w = (Fl_Shared_Image_Waiter *)malloc(sizeof(Fl_Shared_Image_Waiter));
+  w->W    = W;
+  w->H    = H;
+  w->cb   = cb;
+  w->data = data;
+  w->img  = 0;
+  w->next = 0;
+
+  // Join the request of the file if it is already being decoded
+  for (req = async_requests; req; req = req->next) {
+    if (!strcmp(req->name, name)) {
+      for (wp = &req->waiters; *wp; wp = &(*wp)->next) { }
+      *wp = w;
+      return;
+    }
+  }
+
+  req = (Fl_Shared_Image_Request *)malloc(sizeof(Fl_Shared_Image_Request));
+  req->name    = fl_strdup(name);
+  req->image   = 0;
+  req->waiters = w;
+  req->next    = async_requests;
+  async_requests = req;
+
+  Fl_Worker_Pool::shared()->submit(async_run_, req);
+}
+
+/** Decodes the file of a get_async() request on a worker thread. */
+void Fl_Shared_Image::async_run_(void *v) {
+  Fl_Shared_Image_Request *req = (Fl_Shared_Image_Request *)v;
+
+  req->image = decode(req->name);
+  Fl_Worker_Pool::awake(async_done_, req);
+}
+
+/**
+  Adds the image of a get_async() request to the pool and calls the
+  callbacks of the request.
+*/
+void Fl_Shared_Image::async_done_(void *v) {
+  Fl_Shared_Image_Request *req = (Fl_Shared_Image_Request *)v;
+  Fl_Shared_Image_Request **rp;
+  Fl_Shared_Image_Waiter  *w, *next;
+
+  for (rp = &async_requests; *rp; rp = &(*rp)->next) {
+    if (*rp == req) {
+      *rp = req->next;
+      break;
+    }
+  }
+
+  // Get all images before calling back, so that a callback releasing
+  // its image does not delete the original that the others need
+  if (req->image || find_(req->name, 0, 0)) {
+    if (!req->waiters) {        // all canceled, keep it in the cache
+      Fl_Shared_Image *img = get_(req->name, req->image, 0, 0);
+      if (img) img->release();
+    }
+    for (w = req->waiters; w; w = w->next) {
+      w->img = get_(req->name, req->image, w->W, w->H);
+      req->image = 0;           // owned by the pool now
+    }
+  }
+
+  for (w = req->waiters; w; w = next) {
+    next = w->next;
+    w->cb(w->img, w->data);
+    free(w);
+  }
+  free(req->name);
+  free(req);
+}
+
+/**
+  Cancels the requests of get_async() with callback \p cb and \p data.
+
+  Their callback is not called. A file that no other request waits for
+  is still added to the pool if it was already being decoded.
+
+  \see get_async()
+*/
+void Fl_Shared_Image::cancel_async(Fl_Shared_Image_Cb cb, void *data) {
+  Fl_Shared_Image_Request *req, **rp;
+  Fl_Shared_Image_Waiter  *w, **wp;
+
+  for (rp = &async_requests; (req = *rp) != NULL; ) {
+    for (wp = &req->waiters; (w = *wp) != NULL; ) {
+      if (w->cb == cb && w->data == data) {
+        *wp = w->next;
+        free(w);
+      } else {
+        wp = &w->next;
+      }
+    }
+    if (!req->waiters && Fl_Worker_Pool::shared()->cancel(req)) {
+      *rp = req->next;          // not started, forget it
+      free(req->name);
+      free(req);
+    } else {
+      rp = &req->next;
+    }
+  }
+}
+
 /** Adds a shared image handler, which is basically a test function
   for adding new image formats.
 
@@ -19,16 +19,13 @@
 #include "../hdr/Fl_Table.h"
 #include "../hdr/Fl.h"
 #include "../hdr/fl_draw.h"
+#include "../hdr/Fl_Device.h"
+#include "../hdr/Fl_Graphics_Driver.h"
 
-// EXPERIMENTAL
-// We use either std::vector or the private class Fl_Int_Vector
-// depending on the build option FLTK_OPTION_STD or equivalent.
-// This option allows to use std::string and maybe std::vector
-// already in FLTK 1.4.x
-
-#if (!FLTK_USE_STD)
-#include "Fl_Int_Vector.h"      // Note: MUST NOT be included in Fl_Table.h
-#endif
+#include "Fl_Table_Sizes.h"     // Note: MUST NOT be included in Fl_Table.h
+#include "Fl_Table_Cache.h"
+#include "Fl_Table_Sort.h"
+#include "Fl_Table_Autosize.h"
 
 #include <sys/types.h>
 #include <string.h>             // memcpy
@@ -50,7 +47,7 @@ void Fl_Table::row_position(int row) {
   }
   vscrollbar->Fl_Slider::value(newtop);
   table_scrolled();
-  redraw();
+  _scroll_redraw();
   _row_position = row;  // HACK: override what table_scrolled() came up with
 }
 
@@ -69,46 +66,24 @@ void Fl_Table::col_position(int col) {
   }
   hscrollbar->Fl_Slider::value(newleft);
   table_scrolled();
-  redraw();
+  _scroll_redraw();
   _col_position = col;  // HACK: override what table_scrolled() came up with
 }
 
 /**
   Returns the scroll position (in pixels) of the specified 'row'.
+  This is O(log rows), using an index of the row heights.
 */
 long Fl_Table::row_scroll_position(int row) {
-  int startrow = 0;
-  long scroll = 0;
-  // OPTIMIZATION:
-  //     Attempt to use precomputed row scroll position
-  //
-  if ( toprow_scrollpos != -1 && row >= toprow ) {
-    scroll = toprow_scrollpos;
-    startrow = toprow;
-  }
-  for ( int t=startrow; t<row; t++ ) {
-    scroll += row_height(t);
-  }
-  return(scroll);
+  return(_rowheights->position(row));
 }
 
 /**
   Returns the scroll position (in pixels) of the specified column 'col'.
+  This is O(log cols), using an index of the column widths.
 */
 long Fl_Table::col_scroll_position(int col) {
-  int startcol = 0;
-  long scroll = 0;
-  // OPTIMIZATION:
-  //     Attempt to use precomputed row scroll position
-  //
-  if ( leftcol_scrollpos != -1 && col >= leftcol ) {
-    scroll = leftcol_scrollpos;
-    startcol = leftcol;
-  }
-  for ( int t=startcol; t<col; t++ ) {
-    scroll += col_width(t);
-  }
-  return(scroll);
+  return(_colwidths->position(col));
 }
 
 /**
@@ -154,14 +129,14 @@ Fl_Table::Fl_Table(int X, int Y, int W, int H, const char *l) : Fl_Group(X,Y,W,H
   select_col        = -1;
   _scrollbar_size   = 0;
   flags_            = 0;        // TABCELLNAV off
+  _drawn_hoff       = -1;
+  _drawn_voff       = -1;
 
-#if (FLTK_USE_STDXX)
-  _colwidths        = new std::vector<int>;  // column widths in pixels
-  _rowheights       = new std::vector<int>;  // row heights in pixels
-#else
-  _colwidths        = new Fl_Int_Vector();  // column widths in pixels
-  _rowheights       = new Fl_Int_Vector();  // row heights in pixels
-#endif
+  _colwidths        = new Fl_Table_Sizes(); // column widths in pixels
+  _rowheights       = new Fl_Table_Sizes(); // row heights in pixels
+  _cache            = new Fl_Table_Cache(this); // cell data, if data_provider() is used
+  _sort             = new Fl_Table_Sort(this);  // row order, if sort_rows() is used
+  _autosize         = new Fl_Table_Autosize(this); // column widths, if col_autosize() is used
 
   box(FL_THIN_DOWN_FRAME);
 
@@ -198,6 +173,9 @@ Fl_Table::~Fl_Table() {
   // The parent Fl_Group takes care of destroying scrollbars
   delete _colwidths;
   delete _rowheights;
+  _cache->destroy();            // may live on until pending data arrives
+  _sort->destroy();             // ditto for a sort in progress
+  delete _autosize;
 }
 
 
@@ -209,7 +187,7 @@ Fl_Table::~Fl_Table() {
   \returns Number of columns.
 */
 int Fl_Table::col_size() {
-  return int(_colwidths->size());
+  return _colwidths->size();
 }
 
 /**
@@ -220,7 +198,7 @@ int Fl_Table::col_size() {
   \returns Number of rows.
 */
 int Fl_Table::row_size() {
-  return int(_rowheights->size());
+  return _rowheights->size();
 }
 
 /**
@@ -231,21 +209,15 @@ int Fl_Table::row_size() {
 */
 void Fl_Table::row_height(int row, int height) {
   if ( row < 0 ) return;
-  if ( row < row_size() && (*_rowheights)[row] == height ) {
+  if ( row < row_size() && _rowheights->value(row) == height ) {
     return;             // OPTIMIZATION: no change? avoid redraw
   }
   // Add row heights, even if none yet
-  int now_size = row_size();
-  if (row >= now_size) {
-#if (FLTK_USE_STD)
-    _rowheights->resize(row, height);
-#else
-    _rowheights->size(row);
-    while (now_size < row)
-      (*_rowheights)[now_size++] = height;
-#endif // FLTK_USE_STD
+  if ( row >= row_size() ) {
+    _rowheights->size(row+1, height);
+  } else {
+    _rowheights->value(row, height);
   }
-  (*_rowheights)[row] = height;
   table_resized();
   if ( row <= botrow ) {        // OPTIMIZATION: only redraw if onscreen or above screen
     redraw();
@@ -264,21 +236,15 @@ void Fl_Table::row_height(int row, int height) {
 void Fl_Table::col_width(int col, int width)
 {
   if ( col < 0 ) return;
-  if ( col < col_size() && (*_colwidths)[col] == width ) {
+  if ( col < col_size() && _colwidths->value(col) == width ) {
     return;                     // OPTIMIZATION: no change? avoid redraw
   }
   // Add column widths, even if none yet
-  int now_size = col_size();
-  if ( col >= now_size ) {
-#if (FLTK_USE_STD)
-    _colwidths->resize(col+1, width);
-#else
-    _colwidths->size(col+1);
-    while (now_size < col)
-      (*_colwidths)[now_size++] = width;
-#endif
+  if ( col >= col_size() ) {
+    _colwidths->size(col+1, width);
+  } else {
+    _colwidths->value(col, width);
   }
-  (*_colwidths)[col] = width;
   table_resized();
   if ( col <= rightcol ) {      // OPTIMIZATION: only redraw if onscreen or to the left
     redraw();
@@ -590,38 +556,28 @@ void Fl_Table::recalc_dimensions() {
   TODO: Assumes ti[xywh] has already been recalculated.
 */
 void Fl_Table::table_scrolled() {
-  // Find top row
-  int y, row, voff = vscrollbar->value();
-  for ( row=y=0; row < _rows; row++ ) {
-    y += row_height(row);
-    if ( y > voff ) { y -= row_height(row); break; }
-  }
-  _row_position = toprow = ( row >= _rows ) ? (row - 1) : row;
-  toprow_scrollpos = y;         // OPTIMIZATION: save for later use
-  // Find bottom row
-  voff = vscrollbar->value() + tih;
-  for ( ; row < _rows; row++ ) {
-    y += row_height(row);
-    if ( y >= voff ) { break; }
-  }
-  botrow = ( row >= _rows ) ? (row - 1) : row;
+  // Find top row: the row containing the scroll position
+  //    O(log rows) lookups in the row height index
+  //
+  int row, voff = (int)vscrollbar->value();
+  row = _rowheights->find(voff);
+  _row_position = toprow = ( row >= _rows ) ? (_rows - 1) : row;
+  toprow_scrollpos = (int)row_scroll_position(toprow);    // OPTIMIZATION: save for later use
+  // Find bottom row: the first row reaching the bottom edge
+  voff = (int)vscrollbar->value() + tih;
+  row = _rowheights->find(voff - 1);
+  botrow = ( row >= _rows ) ? (_rows - 1) : row;
+  if ( botrow < toprow ) botrow = toprow;
   // Left column
-  int x, col, hoff = hscrollbar->value();
-  for ( col=x=0; col < _cols; col++ ) {
-    x += col_width(col);
-    if ( x > hoff ) { x -= col_width(col); break; }
-  }
-  _col_position = leftcol = ( col >= _cols ) ? (col - 1) : col;
-  leftcol_scrollpos = x;        // OPTIMIZATION: save for later use
+  int col, hoff = (int)hscrollbar->value();
+  col = _colwidths->find(hoff);
+  _col_position = leftcol = ( col >= _cols ) ? (_cols - 1) : col;
+  leftcol_scrollpos = (int)col_scroll_position(leftcol);   // OPTIMIZATION: save for later use
   // Right column
-  //    Work with data left over from leftcol calculation
-  //
-  hoff = hscrollbar->value() + tiw;
-  for ( ; col < _cols; col++ ) {
-    x += col_width(col);
-    if ( x >= hoff ) { break; }
-  }
-  rightcol = ( col >= _cols ) ? (col - 1) : col;
+  hoff = (int)hscrollbar->value() + tiw;
+  col = _colwidths->find(hoff - 1);
+  rightcol = ( col >= _cols ) ? (_cols - 1) : col;
+  if ( rightcol < leftcol ) rightcol = leftcol;
   // First tell children to scroll
   draw_cell(CONTEXT_RC_RESIZE, 0,0,0,0,0,0);
 }
@@ -677,7 +633,55 @@ void Fl_Table::scroll_cb(Fl_Widget*w, void *data) {
   Fl_Table *o = (Fl_Table*)data;
   o->recalc_dimensions();       // recalc tix, tiy, etc.
   o->table_scrolled();
-  o->redraw();
+  o->_scroll_redraw();
+}
+
+/**
+  Schedules a redraw after the table was scrolled.
+
+  If the cells were drawn before and there are no child widgets that
+  would have to move, only FL_DAMAGE_SCROLL is set, and draw() shifts the
+  cells already drawn with fl_scroll() and draws just the newly exposed
+  cells. Otherwise the whole table is redrawn.
+*/
+void Fl_Table::_scroll_redraw() {
+  if ( _drawn_voff < 0 || table->visible() ) {
+    redraw();
+  } else {
+    damage(FL_DAMAGE_SCROLL);
+  }
+}
+
+/**
+  Draws the cells in the area \p X, \p Y, \p W, \p H of the table,
+  e.g. an area exposed by scrolling.
+*/
+void Fl_Table::_draw_cells_area(int X, int Y, int W, int H) {
+  fl_push_clip(X, Y, W, H);
+  if ( table_w < tiw || table_h < tih ) {       // area may extend past the last row/col
+    fl_rectf(X, Y, W, H, color());
+  }
+  if ( _rows > 0 && _cols > 0 ) {
+    long voff = (long)vscrollbar->value() - tiy;
+    long hoff = (long)hscrollbar->value() - tix;
+    int r1 = _rowheights->find(voff + Y), r2 = _rowheights->find(voff + Y + H - 1);
+    int c1 = _colwidths->find(hoff + X),  c2 = _colwidths->find(hoff + X + W - 1);
+    if ( r2 >= _rows ) r2 = _rows - 1;
+    if ( c2 >= _cols ) c2 = _cols - 1;
+    for ( int r = r1; r <= r2; r++ ) {
+      for ( int c = c1; c <= c2; c++ ) {
+        _redraw_cell(CONTEXT_CELL, r, c);
+      }
+    }
+  }
+  fl_pop_clip();
+}
+
+/**
+  fl_scroll() callback drawing an area exposed by scrolling.
+*/
+void Fl_Table::_draw_cells_area_cb(void *d, int X, int Y, int W, int H) {
+  ((Fl_Table*)d)->_draw_cells_area(X, Y, W, H);
 }
 
 /**
@@ -687,17 +691,10 @@ void Fl_Table::rows(int val) {
   int oldrows = _rows;
   _rows = val;
 
-  int default_h = row_size() > 0 ? _rowheights->back() : 25;
-  int now_size = row_size();
-
-#if (FLTK_USE_STD)
-  if (now_size != val)
-    _rowheights->resize(val, default_h);      // enlarge or shrink as needed
-#else
-  _rowheights->size(val);                     // enlarge or shrink as needed
-  while (now_size < val)
-    (*_rowheights)[now_size++] = default_h;   // fill new
-#endif
+  int default_h = row_size() > 0 ? _rowheights->value(row_size()-1) : 25;
+  _rowheights->size(val, default_h);          // enlarge or shrink as needed
+  _sort->rows(val);                           // keep the row order
+  _autosize->clear();
 
   table_resized();
 
@@ -715,17 +712,8 @@ void Fl_Table::rows(int val) {
 void Fl_Table::cols(int val) {
   _cols = val;
 
-  int default_w = col_size() > 0 ? (*_colwidths)[col_size()-1] : 80;
-  int now_size = col_size();
-
-#if (FLTK_USE_STD)
-  if (now_size != val)
-    _colwidths->resize(val, default_w);       // enlarge or shrink as needed
-#else
-  _colwidths->size(val);                      // enlarge or shrink as needed
-  while (now_size < val)
-    (*_colwidths)[now_size++] = default_w;    // fill new
-#endif
+  int default_w = col_size() > 0 ? _colwidths->value(col_size()-1) : 80;
+  _colwidths->size(val, default_w);           // enlarge or shrink as needed
 
   table_resized();
   redraw();
@@ -1299,6 +1287,23 @@ void Fl_Table::draw() {
     table_resized();
   }
 
+  // Request cell data for the visible cells (and prefetch margin), if any
+  _cache->prefetch();
+
+  // Only scrolled? Shift the cells drawn before, if the surface can do it
+  int full = damage() & FL_DAMAGE_ALL;
+  int dx = 0, dy = 0;
+  if ( !full && (damage() & FL_DAMAGE_SCROLL) ) {
+    float scale = Fl_Surface_Device::surface()->driver()->scale();
+    if ( _drawn_voff < 0 || table->visible() || scale != int(scale) ||
+         Fl_Surface_Device::surface() != Fl_Display_Device::display_device() ) {
+      full = 1;                                 // can't copy: draw everything
+    } else {
+      dx = _drawn_hoff - (int)hscrollbar->value();
+      dy = _drawn_voff - (int)vscrollbar->value();
+    }
+  }
+
   draw_cell(CONTEXT_STARTPAGE, 0, 0,            // let user's drawing routine
             tix, tiy, tiw, tih);                // prep new page
 
@@ -1321,15 +1326,36 @@ void Fl_Table::draw() {
   //    that leak around the border.
   //
   if ( ! table->visible() ) {
-    if ( damage() & FL_DAMAGE_ALL || damage() & FL_DAMAGE_CHILD ) {
+    if ( full || damage() & FL_DAMAGE_CHILD ) {
       draw_box(table->box(), tox, toy, tow, toh, table->color());
     }
   }
   // Clip all further drawing to the inner widget dimensions
   fl_push_clip(wix, wiy, wiw, wih);
   {
+    // Scrolled? Shift the drawn cells, draw the exposed ones and the headers
+    if ( !full && ( dx || dy ) ) {
+      fl_scroll(tix, tiy, tiw, tih, dx, dy, _draw_cells_area_cb, this);
+      int X,Y,W,H;
+      if ( dy && row_header() ) {
+        get_bounds(CONTEXT_ROW_HEADER, X, Y, W, H);
+        fl_push_clip(X,Y,W,H);
+        for ( int r = toprow; r <= botrow; r++ ) {
+          _redraw_cell(CONTEXT_ROW_HEADER, r, 0);
+        }
+        fl_pop_clip();
+      }
+      if ( dx && col_header() ) {
+        get_bounds(CONTEXT_COL_HEADER, X, Y, W, H);
+        fl_push_clip(X,Y,W,H);
+        for ( int c = leftcol; c <= rightcol; c++ ) {
+          _redraw_cell(CONTEXT_COL_HEADER, 0, c);
+        }
+        fl_pop_clip();
+      }
+    }
     // Only redraw a few cells?
-    if ( ! ( damage() & FL_DAMAGE_ALL ) && _redraw_leftcol != -1 ) {
+    if ( ! full && _redraw_leftcol != -1 ) {
       fl_push_clip(tix, tiy, tiw, tih);
       for ( int c = _redraw_leftcol; c <= _redraw_rightcol; c++ ) {
         for ( int r = _redraw_toprow; r <= _redraw_botrow; r++ ) {
@@ -1338,7 +1364,7 @@ void Fl_Table::draw() {
       }
       fl_pop_clip();
     }
-    if ( damage() & FL_DAMAGE_ALL ) {
+    if ( full ) {
       int X,Y,W,H;
       // Draw row headers, if any
       if ( row_header() ) {
@@ -1428,18 +1454,248 @@ void Fl_Table::draw() {
     _redraw_leftcol = _redraw_rightcol = _redraw_toprow = _redraw_botrow = -1;
   }
   fl_pop_clip();
+  // Remember what was drawn, for the next scroll
+  _drawn_hoff = (int)hscrollbar->value();
+  _drawn_voff = (int)vscrollbar->value();
+}
+
+/**
+  Convenience method to set the height of all rows to the
+  same value, in pixels. The screen is redrawn.
+
+  This takes constant time regardless of the number of rows.
+  If when() is FL_WHEN_CHANGED, callback() is invoked once
+  with CONTEXT_RC_RESIZE for row 0.
+*/
+void Fl_Table::row_height_all(int height) {
+  _rowheights->fill(height);
+  table_resized();
+  redraw();
+  // ROW RESIZE CALLBACK
+  if ( Fl_Widget::callback() && when() & FL_WHEN_CHANGED ) {
+    do_callback(CONTEXT_RC_RESIZE, 0, 0);
+  }
+}
+
+/**
+  Convenience method to set the width of all columns to the
+  same value, in pixels. The screen is redrawn.
+
+  This takes constant time regardless of the number of columns.
+  If when() is FL_WHEN_CHANGED, callback() is invoked once
+  with CONTEXT_RC_RESIZE for column 0.
+*/
+void Fl_Table::col_width_all(int width) {
+  _colwidths->fill(width);
+  table_resized();
+  redraw();
+  // COLUMN RESIZE CALLBACK
+  if ( Fl_Widget::callback() && when() & FL_WHEN_CHANGED ) {
+    do_callback(CONTEXT_RC_RESIZE, 0, 0);
+  }
+}
+
+/**
+  Sets the provider of the table's cell data.
+
+  The provider fetches blocks of cells on \p threads worker threads,
+  and draw_cell() gets them with cell_data(). All cached cell data is
+  dropped. Queued fetches of a previous provider are cancelled, but
+  fetch() calls already running are not waited for, so the main thread
+  never blocks on them; their cells are discarded.
+
+  The provider must stay valid until it is replaced (e.g. with 0) or
+  the table is destroyed, and until fetch() calls running then returned.
+
+  \see Fl_Table_Provider
+*/
+void Fl_Table::data_provider(Fl_Table_Provider *p, int threads) {
+  _cache->provider(p, threads);
+  redraw();
+}
+
+/**
+  Returns the provider of the table's cell data, or 0 if none.
+*/
+Fl_Table_Provider *Fl_Table::data_provider() const {
+  return(_cache->provider());
+}
+
+/**
+  Sets the number of rows and columns of the blocks of cells requested
+  from the data_provider() (default 64 rows x 16 columns).
+  All cached cell data is dropped.
+*/
+void Fl_Table::data_block_size(int rows, int cols) {
+  _cache->block_size(rows, cols);
+  redraw();
+}
+
+/**
+  Sets how many rows and columns around the visible cells are requested
+  from the data_provider() in advance (default 64 rows, 16 columns).
+  Prefetched blocks are only requested if there is room in the cache.
+*/
+void Fl_Table::data_prefetch(int rows, int cols) {
+  _cache->prefetch(rows, cols);
+}
+
+/**
+  Sets the maximum number of blocks of cells kept from the data_provider()
+  (default 64). Least recently used blocks outside the prefetch margin
+  are dropped first; blocks with visible cells are never dropped.
+*/
+void Fl_Table::data_cache_size(int blocks) {
+  _cache->max_blocks(blocks);
+}
+
+/**
+  Returns the maximum number of blocks of cells kept from the data_provider().
+*/
+int Fl_Table::data_cache_size() const {
+  return(_cache->max_blocks());
+}
+
+/**
+  Returns the data the data_provider() fetched for cell \p R, \p C.
+
+  Returns 0 if the data did not arrive yet; its block is then requested
+  if needed, and the cell is redrawn when the block arrives.
+  If \p ready is not 0 it is set to 1 if the data arrived, or to 0 if the
+  cell is still being fetched (or there is no data provider).
+
+  Use this from draw_cell() to get the cell's contents, drawing a
+  placeholder if they are not ready:
+  \code
+  case CONTEXT_CELL: {
+    int ready;
+    const char *s = (const char*)cell_data(R, C, &ready);
+    fl_draw(ready ? (s ? s : "") : "...", X, Y, W, H, FL_ALIGN_LEFT);
+    return;
+  }
+  \endcode
+*/
+void *Fl_Table::cell_data(int R, int C, int *ready) {
+  return(_cache->cell(R, C, ready));
+}
+
+/**
+  Discards all cell data fetched from the data_provider(), e.g. because
+  the underlying data changed. The visible cells are fetched again.
+*/
+void Fl_Table::data_changed() {
+  _cache->clear();
+  _autosize->clear();
+  redraw();
+}
+
+/**
+  Sorts the rows of the table in the background.
+
+  The table shows the rows of the application's data (model rows) in
+  the order of \p cmp, which is called with model rows and \p data.
+  Rows that compare equal keep their current order, so sorting by one
+  column and then by another sorts by the second, then the first.
+
+  Tables with fewer than 16384 rows are sorted right away. Larger ones
+  are sorted on worker threads; the table keeps showing the previous
+  order until it is done, then it is redrawn. A sort still in progress
+  is abandoned. Changing the number of rows restarts it.
+
+  Row numbers passed to draw_cell(), cell_text() and the callback are
+  view rows: use row_model() to get the row of your data to draw.
+  cell_data() is not affected, since the data_provider() fetches blocks
+  of adjacent rows.
+
+  \see Fl_Table_Row_Compare, unsort_rows()
+*/
+void Fl_Table::sort_rows(Fl_Table_Row_Compare *cmp, void *data) {
+  _sort->sort(cmp, data);
+}
+
+/**
+  Shows the rows in the order of the application's data again,
+  abandoning a sort in progress.
+*/
+void Fl_Table::unsort_rows() {
+  _sort->reset();
+  redraw();
+}
+
+/**
+  Returns 1 while sort_rows() is sorting in the background, 0 otherwise.
+*/
+int Fl_Table::sorting_rows() const {
+  return(_sort->sorting());
+}
+
+/**
+  Returns the row of the application's data shown in table row \p R.
+  This is \p R unless the rows were sorted with sort_rows().
+*/
+int Fl_Table::row_model(int R) const {
+  return(_sort->model(R));
+}
+
+/**
+  Returns the table row showing row \p M of the application's data.
+  The first call after a sort takes time proportional to rows().
+*/
+int Fl_Table::row_view(int M) {
+  return(_sort->view(M));
+}
+
+/**
+  Fits column \p col, or all columns if \p col is negative, to the
+  widest text returned by cell_text() for the column.
+
+  Columns are measured while the program is idle, a few milliseconds at
+  a time, so this returns immediately and the widths change when each
+  column is done. Measured widths are kept until the number of rows
+  changes or data_changed() is called, so fitting a column again is
+  immediate. Columns without text keep their width.
+
+  \see col_autosize_sample(int), col_autosize_font()
+*/
+void Fl_Table::col_autosize(int col) {
+  _autosize->request(col);
+}
+
+/**
+  Sets the maximum number of rows measured by col_autosize() per column.
+  Larger tables are measured at evenly spread rows. 0 measures all rows.
+  The default is 1000.
+*/
+void Fl_Table::col_autosize_sample(int rows) {
+  _autosize->sample(rows);
+}
+
+/**
+  Returns the maximum number of rows measured by col_autosize() per column.
+*/
+int Fl_Table::col_autosize_sample() const {
+  return(_autosize->sample());
+}
+
+/**
+  Sets the font col_autosize() measures the text with; it should be the
+  font draw_cell() uses. The default is FL_HELVETICA, FL_NORMAL_SIZE.
+  Measured widths are forgotten.
+*/
+void Fl_Table::col_autosize_font(Fl_Font font, Fl_Fontsize size) {
+  _autosize->font(font, size);
 }
 
 /**
   Returns the current height of the specified row as a value in pixels.
 */
 int Fl_Table::row_height(int row) {
-  return((row < 0 || row >= row_size()) ? 0 : (*_rowheights)[row]);
+  return((row < 0 || row >= row_size()) ? 0 : _rowheights->value(row));
 }
 
 /**
   Returns the current width of the specified column in pixels.
 */
 int Fl_Table::col_width(int col) {
-  return((col < 0 || col >= col_size()) ? 0 : (*_colwidths)[col]);
+  return((col < 0 || col >= col_size()) ? 0 : _colwidths->value(col));
 }
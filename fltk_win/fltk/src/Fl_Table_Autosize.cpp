@@ -0,0 +1,171 @@
+//
+// Column auto-size for Fl_Table.
+//
+// Copyright 2002 by Greg Ercolano.
+// Copyright 2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "Fl_Table_Autosize.h"
+#include "../hdr/Fl.h"
+#include "../hdr/fl_draw.h"
+#include <stdlib.h>
+
+// Seconds of measuring per idle callback
+static const double SLICE = 0.005;
+// Cells measured between checks of the time
+static const int CHECK_EVERY = 32;
+// Pixels added to the widest text of a column
+static const int PADDING = 8;
+
+/** Create the auto-size data of \p table; nothing is measured yet. */
+Fl_Table_Autosize::Fl_Table_Autosize(Fl_Table *table) {
+  table_ = table;
+  textw_ = 0;
+  queued_ = 0;
+  ncols_ = 0;
+  col_ = -1;
+  next_ = 0;
+  w_ = -1;
+  sample_ = 1000;
+  font_ = FL_HELVETICA;
+  size_ = -1;                   // FL_NORMAL_SIZE
+}
+
+/** Stop measuring and free the data. */
+Fl_Table_Autosize::~Fl_Table_Autosize() {
+  Fl::remove_idle(idle_cb, this);
+  if (textw_) free(textw_);
+  if (queued_) free(queued_);
+}
+
+/**
+  Make room for \p n columns. Columns that were removed are forgotten,
+  new ones are not measured yet.
+*/
+void Fl_Table_Autosize::cols(int n) {
+  if (n == ncols_) return;
+  textw_ = (int*)realloc(textw_, (n > 0 ? n : 1) * sizeof(int));
+  queued_ = (char*)realloc(queued_, (n > 0 ? n : 1));
+  for (int c = ncols_; c < n; c++) {
+    textw_[c] = -1;
+    queued_[c] = 0;
+  }
+  ncols_ = n;
+  if (col_ >= n) next_column();
+}
+
+/** Start measuring the first queued column, if any. */
+void Fl_Table_Autosize::next_column() {
+  col_ = -1;
+  next_ = 0;
+  w_ = -1;
+  for (int c = 0; c < ncols_; c++)
+    if (queued_[c]) { col_ = c; break; }
+}
+
+/** Set the width of column \p col from its measured text. */
+void Fl_Table_Autosize::apply(int col) {
+  if (textw_[col] < 0) return;                  // no text: leave it alone
+  int w = textw_[col] + PADDING;
+  if (w < table_->col_resize_min()) w = table_->col_resize_min();
+  if (w != table_->col_width(col)) table_->col_width(col, w);
+}
+
+/**
+  Fit column \p col to its text, or all columns if \p col is negative.
+  Columns measured since the last clear() are fitted immediately,
+  the others when they were measured.
+*/
+void Fl_Table_Autosize::request(int col) {
+  cols(table_->cols());
+  int c1 = col < 0 ? 0 : col, c2 = col < 0 ? ncols_ - 1 : col;
+  if (c1 >= ncols_) return;
+  for (int c = c1; c <= c2; c++) {
+    if (textw_[c] >= 0) apply(c);
+    else queued_[c] = 1;
+  }
+  if (col_ < 0) {
+    next_column();
+    if (col_ >= 0) Fl::add_idle(idle_cb, this);
+  }
+}
+
+/**
+  Forget the measured text widths, e.g. because the data changed.
+  The column being measured is measured again.
+*/
+void Fl_Table_Autosize::clear() {
+  cols(table_->cols());
+  for (int c = 0; c < ncols_; c++) textw_[c] = -1;
+  next_ = 0;
+  w_ = -1;
+}
+
+/** Measure at most \p rows evenly spread rows per column, or all if 0. */
+void Fl_Table_Autosize::sample(int rows) {
+  sample_ = rows < 0 ? 0 : rows;
+}
+
+/** Set the font used to measure the text. Measured widths are forgotten. */
+void Fl_Table_Autosize::font(Fl_Font f, Fl_Fontsize s) {
+  font_ = f;
+  size_ = s;
+  clear();
+}
+
+/**
+  Measure the queued columns for a few milliseconds, and set the width
+  of each column done.
+*/
+void Fl_Table_Autosize::idle_cb(void *v) {
+  Fl_Table_Autosize *a = (Fl_Table_Autosize*)v;
+  a->cols(a->table_->cols());                   // columns may have been removed
+  Fl_Timestamp start = Fl::now();
+  Fl_Font oldfont = fl_font();
+  Fl_Fontsize oldsize = fl_size();
+  fl_font(a->font_, a->size_ < 0 ? FL_NORMAL_SIZE : a->size_);
+  while (a->col_ >= 0) {
+    int rows = a->table_->rows();
+    int n = (a->sample_ > 0 && rows > a->sample_) ? a->sample_ : rows;
+    for (int k = 0; k < CHECK_EVERY && a->next_ < n; k++, a->next_++) {
+      int R = (n == rows) ? a->next_ : (int)((double)a->next_ * rows / n);
+      const char *s = a->table_->cell_text(R, a->col_);
+      if (s && *s) {
+        int tw = (int)(fl_width(s) + 0.5);
+        if (tw > a->w_) a->w_ = tw;
+      }
+    }
+    if (a->next_ >= n) {                        // column done
+      int c = a->col_;
+      a->textw_[c] = a->w_;
+      a->queued_[c] = 0;
+      a->next_column();
+      a->apply(c);
+    } else if (Fl::seconds_since(start) >= SLICE) {
+      break;
+    }
+  }
+  fl_font(oldfont, oldsize);
+  if (a->col_ < 0) Fl::remove_idle(idle_cb, a);
+}
+
+/**
+ \}
+ \endcond
+ */
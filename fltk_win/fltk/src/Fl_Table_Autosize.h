@@ -0,0 +1,80 @@
+//
+// Column auto-size for Fl_Table.
+//
+// Copyright 2002 by Greg Ercolano.
+// Copyright 2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#ifndef Fl_Table_Autosize_H
+#define Fl_Table_Autosize_H
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "../hdr/Fl_Table.h"
+
+/** \file src/Fl_Table_Autosize.h
+  Fits the columns of an Fl_Table to their text.
+*/
+
+/**
+  Measures the text of an Fl_Table's columns while the program is idle.
+
+  Columns to fit are queued and measured one at a time from an idle
+  callback, in slices of a few milliseconds, so that large tables do not
+  block the user interface. Only a sample of evenly spread rows is
+  measured in large tables. The widest text of each column is kept until
+  the data changes, so fitting a measured column again is immediate.
+
+  \note This class is only for internal use by Fl_Table.
+*/
+class FL_EXPORT Fl_Table_Autosize {
+  Fl_Table *table_;
+  int *textw_;                  // widest text of each column, -1: not measured
+  char *queued_;                // 1: column waits to be measured
+  int ncols_;                   // #columns of textw_ and queued_
+  int col_;                     // column being measured, -1: none
+  int next_;                    // next sample of col_
+  int w_;                       // widest text of col_ so far, -1: none
+  int sample_;                  // max #rows measured, 0: all
+  Fl_Font font_;
+  Fl_Fontsize size_;
+
+  void cols(int n);
+  void next_column();
+  void apply(int col);
+  static void idle_cb(void *v);
+
+public:
+  Fl_Table_Autosize(Fl_Table *table);
+  ~Fl_Table_Autosize();
+
+  void request(int col);
+  void clear();
+  void sample(int rows);
+  /** Return the maximum number of rows measured per column, 0 for all. */
+  int sample() const {
+    return sample_;
+  }
+  void font(Fl_Font f, Fl_Fontsize s);
+};
+
+/**
+ \}
+ \endcond
+ */
+
+#endif // Fl_Table_Autosize_H
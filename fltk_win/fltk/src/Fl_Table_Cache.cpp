@@ -0,0 +1,386 @@
+//
+// Cell data cache for Fl_Table.
+//
+// Copyright 2002 by Greg Ercolano.
+// Copyright 2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "Fl_Table_Cache.h"
+#include "Fl_Worker_Pool.h"
+#include <stdlib.h>
+
+// A block of cells, fetched or being fetched
+struct Fl_Table_Block {
+  int brow, bcol;               // block coordinates: first cell / block size
+  int nrows, ncols;             // #cells fetched (less at the table's edges)
+  void **cells;                 // nrows x ncols cell data, 0 while pending
+  Fl_Table_Job *job;            // job fetching the cells, 0 once they arrived
+  unsigned long used;           // LRU stamp
+  Fl_Table_Block *next;         // next block in the hash chain
+};
+
+// A request to fetch a block, run on a worker thread
+struct Fl_Table_Job {
+  Fl_Table_Cache *cache;
+  Fl_Table_Provider *provider;
+  int generation;               // cache generation when submitted
+  int brow, bcol;               // the block
+  int r0, c0, nrows, ncols;     // the cells
+  void **cells;                 // filled by the provider
+};
+
+static unsigned int block_hash(int brow, int bcol) {
+  return (unsigned int)brow * 2654435761u ^ (unsigned int)bcol * 40503u;
+}
+
+/** Create an empty cache for \p table, without a provider. */
+Fl_Table_Cache::Fl_Table_Cache(Fl_Table *table) {
+  table_ = table;
+  provider_ = 0;
+  pool_ = 0;
+  threads_ = 1;
+  block_rows_ = 64;
+  block_cols_ = 16;
+  prefetch_rows_ = 64;
+  prefetch_cols_ = 16;
+  max_blocks_ = 64;
+  generation_ = 0;
+  inflight_ = 0;
+  hash_size_ = 64;
+  hash_ = (Fl_Table_Block**)calloc(hash_size_, sizeof(Fl_Table_Block*));
+  nblocks_ = 0;
+  clock_ = 0;
+  wr1_ = wr2_ = wc1_ = wc2_ = -1;
+}
+
+/** Private: use destroy(). */
+Fl_Table_Cache::~Fl_Table_Cache() {
+  clear();
+  free(hash_);
+}
+
+/**
+  Called by the table's destructor.
+  Drops all blocks and cancels queued fetches. Running fetches are not
+  waited for: their cells are discarded when they arrive. The cache
+  itself is deleted now, or when the last running fetch is delivered.
+*/
+void Fl_Table_Cache::destroy() {
+  table_ = 0;
+  clear();
+  if (pool_) pool_->detach();   // deletes itself when running jobs are done
+  pool_ = 0;
+  provider_ = 0;
+  if (inflight_ == 0) delete this;
+}
+
+/**
+  Set the provider, dropping all cached cells.
+  Queued fetches of the old provider are cancelled; running ones finish
+  in the background and their cells are discarded. The provider's
+  blocks are fetched by \p threads worker threads.
+*/
+void Fl_Table_Cache::provider(Fl_Table_Provider *p, int threads) {
+  clear();
+  if (pool_) pool_->detach();   // deletes itself when running jobs are done
+  pool_ = 0;
+  provider_ = p;
+  threads_ = threads < 1 ? 1 : threads;
+}
+
+/** Set the number of rows and columns of a block, dropping all cached cells. */
+void Fl_Table_Cache::block_size(int rows, int cols) {
+  if (rows < 1) rows = 1;
+  if (cols < 1) cols = 1;
+  if (rows == block_rows_ && cols == block_cols_) return;
+  clear();
+  block_rows_ = rows;
+  block_cols_ = cols;
+}
+
+/** Set the number of rows and columns to fetch around the visible cells. */
+void Fl_Table_Cache::prefetch(int rows, int cols) {
+  prefetch_rows_ = rows < 0 ? 0 : rows;
+  prefetch_cols_ = cols < 0 ? 0 : cols;
+}
+
+/** Set the maximum number of blocks kept in the cache. */
+void Fl_Table_Cache::max_blocks(int n) {
+  max_blocks_ = n < 1 ? 1 : n;
+  evict();
+}
+
+/**
+  Free the \p n cell data pointers in \p cells, and the array itself.
+*/
+void Fl_Table_Cache::free_cells(void **cells, int n) {
+  if (!cells) return;
+  for (int t = 0; t < n; t++)
+    if (cells[t]) free(cells[t]);
+  free(cells);
+}
+
+/** Return the block \p brow, \p bcol, or 0 if it is not in the cache. */
+Fl_Table_Block *Fl_Table_Cache::find(int brow, int bcol) const {
+  Fl_Table_Block *b = hash_[block_hash(brow, bcol) & (hash_size_ - 1)];
+  for ( ; b; b = b->next)
+    if (b->brow == brow && b->bcol == bcol) return b;
+  return 0;
+}
+
+/**
+  Add block \p brow, \p bcol to the cache and submit a job fetching it.
+  Private: the block must not be in the cache.
+*/
+Fl_Table_Block *Fl_Table_Cache::request(int brow, int bcol) {
+  if (nblocks_ >= hash_size_) {                 // grow the hash table
+    int newsize = hash_size_ * 2;
+    Fl_Table_Block **newhash = (Fl_Table_Block**)calloc(newsize, sizeof(Fl_Table_Block*));
+    for (int t = 0; t < hash_size_; t++) {
+      Fl_Table_Block *b = hash_[t], *next;
+      for ( ; b; b = next) {
+        next = b->next;
+        unsigned int h = block_hash(b->brow, b->bcol) & (newsize - 1);
+        b->next = newhash[h];
+        newhash[h] = b;
+      }
+    }
+    free(hash_);
+    hash_ = newhash;
+    hash_size_ = newsize;
+  }
+  Fl_Table_Job *job = (Fl_Table_Job*)malloc(sizeof(Fl_Table_Job));
+  job->cache = this;
+  job->provider = provider_;
+  job->generation = generation_;
+  job->brow = brow;
+  job->bcol = bcol;
+  job->r0 = brow * block_rows_;
+  job->c0 = bcol * block_cols_;
+  job->nrows = table_->rows() - job->r0;
+  job->ncols = table_->cols() - job->c0;
+  if (job->nrows > block_rows_) job->nrows = block_rows_;
+  if (job->ncols > block_cols_) job->ncols = block_cols_;
+  job->cells = (void**)calloc(job->nrows * job->ncols, sizeof(void*));
+
+  Fl_Table_Block *b = (Fl_Table_Block*)malloc(sizeof(Fl_Table_Block));
+  b->brow = brow;
+  b->bcol = bcol;
+  b->nrows = job->nrows;
+  b->ncols = job->ncols;
+  b->cells = 0;
+  b->job = job;
+  b->used = ++clock_;
+  unsigned int h = block_hash(brow, bcol) & (hash_size_ - 1);
+  b->next = hash_[h];
+  hash_[h] = b;
+  nblocks_++;
+
+  if (!pool_) pool_ = new Fl_Worker_Pool(threads_);
+  inflight_++;
+  pool_->submit(job_run, job);
+  return b;
+}
+
+/**
+  Cancel the job fetching block \p b if it did not start yet.
+  \returns 1 if cancelled (or nothing to cancel), 0 if it is running
+*/
+int Fl_Table_Cache::cancel(Fl_Table_Block *b) {
+  if (!b->job) return 1;
+  if (!pool_ || !pool_->cancel(b->job)) return 0;
+  free(b->job->cells);                          // still empty
+  free(b->job);
+  b->job = 0;
+  inflight_--;
+  return 1;
+}
+
+/**
+  Remove block \p b from the cache and free its cells.
+  A job still running for it is discarded when it is delivered.
+*/
+void Fl_Table_Cache::drop(Fl_Table_Block *b) {
+  Fl_Table_Block **pb = &hash_[block_hash(b->brow, b->bcol) & (hash_size_ - 1)];
+  while (*pb != b) pb = &(*pb)->next;
+  *pb = b->next;
+  free_cells(b->cells, b->nrows * b->ncols);
+  free(b);
+  nblocks_--;
+}
+
+/** Drop all blocks, cancelling queued jobs. */
+void Fl_Table_Cache::clear() {
+  for (int t = 0; t < hash_size_; t++) {
+    Fl_Table_Block *b = hash_[t], *next;
+    for ( ; b; b = next) {
+      next = b->next;
+      cancel(b);
+      drop(b);
+    }
+  }
+  generation_++;
+}
+
+/** Return 1 if block \p b is in the prefetch window, which includes the visible cells. */
+int Fl_Table_Cache::in_window(const Fl_Table_Block *b) const {
+  return (b->brow >= wr1_ && b->brow <= wr2_ && b->bcol >= wc1_ && b->bcol <= wc2_);
+}
+
+/**
+  Drop the least recently used fetched block outside the prefetch window.
+  \returns 0 if there is no such block
+*/
+int Fl_Table_Cache::evict_one() {
+  Fl_Table_Block *lru = 0;
+  for (int t = 0; t < hash_size_; t++) {
+    for (Fl_Table_Block *b = hash_[t]; b; b = b->next) {
+      if (b->job || in_window(b)) continue;
+      if (!lru || b->used < lru->used) lru = b;
+    }
+  }
+  if (!lru) return 0;
+  drop(lru);
+  return 1;
+}
+
+/** Drop blocks until at most max_blocks() are left, if possible. */
+void Fl_Table_Cache::evict() {
+  while (nblocks_ > max_blocks_ && evict_one()) { }
+}
+
+/**
+  Request all blocks of rows \p r1..r2 and columns \p c1..c2 (clipped to
+  the table) that are not in the cache.
+  If \p bounded is set, stop when the cache is full.
+*/
+void Fl_Table_Cache::request_range(int r1, int r2, int c1, int c2, int bounded) {
+  if (r1 < 0) r1 = 0;
+  if (c1 < 0) c1 = 0;
+  if (r2 >= table_->rows()) r2 = table_->rows() - 1;
+  if (c2 >= table_->cols()) c2 = table_->cols() - 1;
+  if (r1 > r2 || c1 > c2) return;
+  for (int brow = r1 / block_rows_; brow <= r2 / block_rows_; brow++) {
+    for (int bcol = c1 / block_cols_; bcol <= c2 / block_cols_; bcol++) {
+      Fl_Table_Block *b = find(brow, bcol);
+      if (b) {
+        b->used = ++clock_;
+      } else {
+        if (bounded && nblocks_ >= max_blocks_ && !evict_one()) return;
+        request(brow, bcol);
+      }
+    }
+  }
+}
+
+/**
+  Request the blocks of the visible cells and then those of the prefetch
+  margin around them, and cancel queued jobs for blocks outside of it.
+  Called by Fl_Table::draw().
+*/
+void Fl_Table_Cache::prefetch() {
+  if (!provider_ || !table_ || table_->rows() <= 0 || table_->cols() <= 0) return;
+  int r1 = table_->toprow - prefetch_rows_, r2 = table_->botrow + prefetch_rows_;
+  int c1 = table_->leftcol - prefetch_cols_, c2 = table_->rightcol + prefetch_cols_;
+  wr1_ = (r1 < 0 ? 0 : r1) / block_rows_;
+  wr2_ = (r2 < 0 ? 0 : r2) / block_rows_;
+  wc1_ = (c1 < 0 ? 0 : c1) / block_cols_;
+  wc2_ = (c2 < 0 ? 0 : c2) / block_cols_;
+  // Cancel fetches that did not start yet for blocks scrolled far away
+  for (int t = 0; t < hash_size_; t++) {
+    Fl_Table_Block *b = hash_[t], *next;
+    for ( ; b; b = next) {
+      next = b->next;
+      if (b->job && !in_window(b) && cancel(b)) drop(b);
+    }
+  }
+  request_range(table_->toprow, table_->botrow, table_->leftcol, table_->rightcol, 0);
+  request_range(r1, r2, c1, c2, 1);
+}
+
+/**
+  Return the data of cell \p R, \p C, or 0 if it did not arrive yet.
+  Requests the cell's block if needed. If \p ready is not 0 it is set to
+  1 if the cell's data arrived (the data may be 0 nonetheless) or to 0
+  if it is being fetched.
+*/
+void *Fl_Table_Cache::cell(int R, int C, int *ready) {
+  if (ready) *ready = 0;
+  if (!provider_ || !table_ || R < 0 || C < 0 || R >= table_->rows() || C >= table_->cols())
+    return 0;
+  int brow = R / block_rows_, bcol = C / block_cols_;
+  Fl_Table_Block *b = find(brow, bcol);
+  if (b) {
+    b->used = ++clock_;
+    if (b->job) return 0;                       // pending
+    int r = R - brow * block_rows_, c = C - bcol * block_cols_;
+    if (r < b->nrows && c < b->ncols) {
+      if (ready) *ready = 1;
+      return b->cells[r * b->ncols + c];
+    }
+    drop(b);                                    // table grew since fetched
+  }
+  request(brow, bcol);
+  return 0;
+}
+
+/**
+  Run a job on a worker thread: fetch the cells and deliver them.
+*/
+void Fl_Table_Cache::job_run(void *v) {
+  Fl_Table_Job *job = (Fl_Table_Job*)v;
+  job->provider->fetch(job->r0, job->c0, job->nrows, job->ncols, job->cells);
+  Fl_Worker_Pool::awake(job_done, job);
+}
+
+/**
+  Deliver a job's cells in the main thread, and redraw those visible.
+  Cells of blocks dropped meanwhile are freed.
+*/
+void Fl_Table_Cache::job_done(void *v) {
+  Fl_Table_Job *job = (Fl_Table_Job*)v;
+  Fl_Table_Cache *cache = job->cache;
+  cache->inflight_--;
+  Fl_Table_Block *b = 0;
+  if (cache->table_ && job->generation == cache->generation_)
+    b = cache->find(job->brow, job->bcol);
+  if (b && b->job == job) {
+    b->cells = job->cells;
+    b->job = 0;
+    Fl_Table *t = cache->table_;
+    int r1 = job->r0, r2 = job->r0 + job->nrows - 1;
+    int c1 = job->c0, c2 = job->c0 + job->ncols - 1;
+    if (r1 < t->toprow) r1 = t->toprow;
+    if (r2 > t->botrow) r2 = t->botrow;
+    if (c1 < t->leftcol) c1 = t->leftcol;
+    if (c2 > t->rightcol) c2 = t->rightcol;
+    if (r1 <= r2 && c1 <= c2)                   // redraw just the visible cells
+      t->redraw_range(r1, r2, c1, c2);
+    cache->evict();
+  } else {
+    free_cells(job->cells, job->nrows * job->ncols);
+  }
+  free(job);
+  if (!cache->table_ && cache->inflight_ == 0) delete cache;
+}
+
+/**
+ \}
+ \endcond
+ */
@@ -0,0 +1,109 @@
+//
+// Cell data cache for Fl_Table.
+//
+// Copyright 2002 by Greg Ercolano.
+// Copyright 2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#ifndef Fl_Table_Cache_H
+#define Fl_Table_Cache_H
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "../hdr/Fl_Table.h"
+
+class Fl_Worker_Pool;
+struct Fl_Table_Block;
+struct Fl_Table_Job;
+
+/** \file src/Fl_Table_Cache.h
+  Cell data of an Fl_Table fetched by an Fl_Table_Provider.
+*/
+
+/**
+  A bounded cache of cell blocks fetched by an Fl_Table_Provider.
+
+  Cells are grouped in blocks of block_rows x block_cols. Missing blocks
+  are fetched on worker threads and handed back to the main thread with
+  Fl::awake(), which redraws just the visible cells of the block.
+  At most max_blocks fetched blocks are kept; the least recently used
+  blocks outside the visible area are dropped first.
+
+  Jobs still queued for blocks that scrolled out of the prefetch window
+  are cancelled. Since fetches may still be running, or their results
+  queued for the main thread, when the table is destroyed, the cache
+  deletes itself when the last one arrives.
+
+  \note This class is only for internal use by Fl_Table.
+*/
+class FL_EXPORT Fl_Table_Cache {
+  Fl_Table *table_;             // the table, 0 once it was destroyed
+  Fl_Table_Provider *provider_;
+  Fl_Worker_Pool *pool_;        // created when a provider is set
+  int threads_;                 // #threads of pool_
+  int block_rows_, block_cols_; // size of a block in cells
+  int prefetch_rows_;           // prefetch margin around the visible cells
+  int prefetch_cols_;
+  int max_blocks_;              // max #blocks kept
+  int generation_;              // incremented when all blocks are dropped
+  int inflight_;                // #jobs submitted but not delivered yet
+  Fl_Table_Block **hash_;       // hash table of blocks, chained
+  int hash_size_;               // #hash buckets, a power of 2
+  int nblocks_;                 // #blocks, fetched or pending
+  unsigned long clock_;         // LRU clock
+  int wr1_, wr2_, wc1_, wc2_;   // prefetch window in blocks: not evicted
+
+  ~Fl_Table_Cache();
+  Fl_Table_Block *find(int brow, int bcol) const;
+  Fl_Table_Block *request(int brow, int bcol);
+  void drop(Fl_Table_Block *b);
+  int cancel(Fl_Table_Block *b);
+  int in_window(const Fl_Table_Block *b) const;
+  int evict_one();
+  void evict();
+  void request_range(int r1, int r2, int c1, int c2, int bounded);
+  static void free_cells(void **cells, int n);
+  static void job_run(void *v);
+  static void job_done(void *v);
+
+public:
+  Fl_Table_Cache(Fl_Table *table);
+  void destroy();
+
+  void provider(Fl_Table_Provider *p, int threads);
+  /** Return the provider, or 0 if none. */
+  Fl_Table_Provider *provider() const {
+    return provider_;
+  }
+  void block_size(int rows, int cols);
+  void prefetch(int rows, int cols);
+  void max_blocks(int n);
+  /** Return the maximum number of blocks kept. */
+  int max_blocks() const {
+    return max_blocks_;
+  }
+  void *cell(int R, int C, int *ready);
+  void prefetch();
+  void clear();
+};
+
+/**
+ \}
+ \endcond
+ */
+
+#endif // Fl_Table_Cache_H
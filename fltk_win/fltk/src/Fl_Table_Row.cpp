@@ -26,6 +26,7 @@
 #include "../hdr/Fl.h"
 #include "../hdr/fl_draw.h"
 #include <stdlib.h>
+#include <string.h>
 
 // for debugging...
 // #define DEBUG 1
@@ -38,36 +39,185 @@
 #define PRINTEVENT
 #endif
 
-// An STL-ish vector without templates (private to Fl_Table_Row)
+// A sorted set of row ranges (private to Fl_Table_Row)
 
-void Fl_Table_Row::CharVector::copy(char *newarr, int newsize) {
-  size(newsize);
-  memcpy(arr, newarr, newsize * sizeof(char));
+Fl_Table_Row::RowRanges::~RowRanges() {         // DTOR
+  if (_start) free(_start);
+  if (_end) free(_end);
+  _start = _end = 0;
 }
 
-Fl_Table_Row::CharVector::~CharVector() {       // DTOR
-  if (arr) free(arr);
-  arr = 0;
+// Index of the first range ending at or after 'row' (_count if none)
+//    This is the first range containing or right of 'row-1'.
+//
+int Fl_Table_Row::RowRanges::lower(int row) const {
+  int lo = 0, hi = _count;
+  while ( lo < hi ) {
+    int mid = (lo + hi) / 2;
+    if ( _end[mid] < row ) lo = mid + 1;
+    else hi = mid;
+  }
+  return(lo);
+}
+
+// Replace ranges i..j-1 with the 'n' ranges s[]/e[]
+void Fl_Table_Row::RowRanges::replace(int i, int j, int n, const int *s, const int *e) {
+  int newcount = _count - (j - i) + n;
+  if ( newcount > _alloc ) {                    // grow geometrically
+    int newalloc = _alloc * 2;
+    if ( newalloc < newcount ) newalloc = newcount;
+    if ( newalloc < 8 ) newalloc = 8;
+    _start = (int*)realloc(_start, (unsigned)newalloc * sizeof(int));
+    _end   = (int*)realloc(_end,   (unsigned)newalloc * sizeof(int));
+    _alloc = newalloc;
+  }
+  if ( j - i != n && _count > j ) {
+    memmove(_start + i + n, _start + j, (unsigned)(_count - j) * sizeof(int));
+    memmove(_end   + i + n, _end   + j, (unsigned)(_count - j) * sizeof(int));
+  }
+  for ( int t=0; t<n; t++ ) {
+    _start[i+t] = s[t];
+    _end[i+t]   = e[t];
+  }
+  _count = newcount;
+}
+
+// Add rows a..b-1 to the stored ranges, merging overlapping/adjacent ones
+void Fl_Table_Row::RowRanges::add(int a, int b) {
+  int i = lower(a);
+  int j = i;
+  while ( j < _count && _start[j] <= b ) j++;
+  int s = a, e = b;
+  if ( j > i ) {
+    if ( _start[i] < s ) s = _start[i];
+    if ( _end[j-1] > e ) e = _end[j-1];
+  }
+  replace(i, j, 1, &s, &e);
 }
 
-void Fl_Table_Row::CharVector::size(int count) {
-  if (count <= 0 ) {    // Same state as init() - (issue #296)
-    if ( arr ) free(arr);
-    arr   = 0;
-    _size = 0;
+// Remove rows a..b-1 from the stored ranges, splitting ranges as needed
+void Fl_Table_Row::RowRanges::remove(int a, int b) {
+  int i = lower(a + 1);                         // first range with end > a
+  int j = i;
+  while ( j < _count && _start[j] < b ) j++;
+  if ( j == i ) return;                         // nothing overlaps
+  int s[2], e[2], n = 0;
+  if ( _start[i] < a ) { s[n] = _start[i]; e[n] = a; n++; }
+  if ( _end[j-1] > b ) { s[n] = b; e[n] = _end[j-1]; n++; }
+  replace(i, j, n, s, e);
+}
+
+// Set number of rows; new rows are not in the set
+void Fl_Table_Row::RowRanges::size(int count) {
+  if ( count <= 0 ) {   // Same state as init() - (issue #296)
+    if ( _start ) free(_start);
+    if ( _end ) free(_end);
+    init();
     return;
   }
-  if (count != _size) {
-    arr = (char*)realloc(arr, (unsigned)count * sizeof(char));
-    _size = count;
+  if ( count < _size ) {
+    remove(count, _size);
+  } else if ( count > _size && _inverted ) {
+    add(_size, count);
   }
+  _size = count;
+}
+
+// Is 'row' in the set? (0=no, 1=yes)
+int Fl_Table_Row::RowRanges::get(int row) const {
+  int i = lower(row + 1);
+  int in = ( i < _count && _start[i] <= row ) ? 1 : 0;
+  return(in ^ _inverted);
+}
+
+// Add (val=1) or remove (val=0) rows a..b-1
+void Fl_Table_Row::RowRanges::set(int a, int b, int val) {
+  if ( a < 0 ) a = 0;
+  if ( b > _size ) b = _size;
+  if ( a >= b ) return;
+  if ( (val ? 1 : 0) != _inverted ) add(a, b);
+  else remove(a, b);
+}
+
+// Toggle rows a..b-1
+//    The stored ranges within a..b-1 are replaced by the gaps between them.
+//
+void Fl_Table_Row::RowRanges::toggle(int a, int b) {
+  if ( a < 0 ) a = 0;
+  if ( b > _size ) b = _size;
+  if ( a >= b ) return;
+  int i = lower(a + 1);
+  int j = i;
+  while ( j < _count && _start[j] < b ) j++;
+  int n = 0;
+  int *s = (int*)malloc((unsigned)(j - i + 1) * 2 * sizeof(int));
+  int *e = s + (j - i + 1);
+  int prev = a;
+  for ( int t=i; t<j; t++ ) {                   // gaps within a..b-1
+    if ( _start[t] > prev ) { s[n] = prev; e[n] = _start[t]; n++; }
+    prev = _end[t];
+  }
+  if ( prev < b ) { s[n] = prev; e[n] = b; n++; }
+  remove(a, b);
+  for ( int t=0; t<n; t++ ) add(s[t], e[t]);
+  free(s);
+}
+
+// Number of rows in the set within a..b-1
+int Fl_Table_Row::RowRanges::count(int a, int b) const {
+  if ( a < 0 ) a = 0;
+  if ( b > _size ) b = _size;
+  if ( a >= b ) return(0);
+  int stored = 0;
+  for ( int t=lower(a + 1); t<_count && _start[t] < b; t++ ) {
+    int s = _start[t] > a ? _start[t] : a;
+    int e = _end[t] < b ? _end[t] : b;
+    stored += e - s;
+  }
+  return(_inverted ? (b - a) - stored : stored);
+}
+
+// First row at or after 'row' in the set, or -1 if none
+int Fl_Table_Row::RowRanges::first(int row) const {
+  if ( row < 0 ) row = 0;
+  if ( row >= _size ) return(-1);
+  int i = lower(row + 1);
+  if ( !_inverted ) {
+    if ( i >= _count ) return(-1);
+    return(_start[i] > row ? _start[i] : row);
+  }
+  if ( i < _count && _start[i] <= row ) row = _end[i];  // skip excluded range
+  return(row < _size ? row : -1);
+}
+
+// Store up to 'max' ranges of rows in the set as first[]..last[] (inclusive)
+//    Returns the total number of ranges.
+//
+int Fl_Table_Row::RowRanges::ranges(int *first, int *last, int max) const {
+  int n = 0;
+  if ( !_inverted ) {
+    for ( ; n<_count; n++ ) {
+      if ( n < max ) { first[n] = _start[n]; last[n] = _end[n] - 1; }
+    }
+    return(n);
+  }
+  int prev = 0;                                 // the set is the gaps
+  for ( int t=0; t<=_count; t++ ) {
+    int s = ( t < _count ) ? _start[t] : _size;
+    if ( s > prev ) {
+      if ( n < max ) { first[n] = prev; last[n] = s - 1; }
+      n++;
+    }
+    if ( t < _count ) prev = _end[t];
+  }
+  return(n);
 }
 
 
 // Is row selected?
 int Fl_Table_Row::row_selected(int row) {
   if ( row < 0 || row >= rows() ) return(-1);
-  return(_rowselect[row]);
+  return(_rowselect.get(row));
 }
 
 // Change row selection type
@@ -75,21 +225,14 @@ void Fl_Table_Row::type(TableRowSelectMode val) {
   _selectmode = val;
   switch ( _selectmode ) {
     case SELECT_NONE: {
-      for ( int row=0; row<rows(); row++ ) {
-        _rowselect[row] = 0;
-      }
+      _rowselect.all(0);
       redraw();
       break;
     }
     case SELECT_SINGLE: {
-      int count = 0;
-      for ( int row=0; row<rows(); row++ ) {
-        if ( _rowselect[row] ) {
-          if ( ++count > 1 ) {  // only one allowed
-            _rowselect[row] = 0;
-          }
-        }
-      }
+      int row = _rowselect.first(0);            // only one allowed: keep the first
+      _rowselect.all(0);
+      if ( row >= 0 ) _rowselect.set(row, row+1, 1);
       redraw();
       break;
     }
@@ -118,30 +261,26 @@ int Fl_Table_Row::select_row(int row, int flag) {
       return(-1);
 
     case SELECT_SINGLE: {
-      int oldval;
-      for ( int t=0; t<rows(); t++ ) {
-        if ( t == row ) {
-          oldval = _rowselect[row];
-          if ( flag == 2 ) { _rowselect[row] ^= 1; }
-          else             { _rowselect[row] = flag; }
-          if ( oldval != _rowselect[row] ) {
-            redraw_range(row, row, leftcol, rightcol);
-            ret = 1;
-          }
-        }
-        else if ( _rowselect[t] ) {
-          _rowselect[t] = 0;
-          redraw_range(t, t, leftcol, rightcol);
-        }
+      int oldval = _rowselect.get(row);
+      int newval = ( flag == 2 ) ? (oldval ^ 1) : (flag ? 1 : 0);
+      // Deselect any other selected rows
+      for ( int t=_rowselect.first(0); t>=0; t=_rowselect.first(t+1) ) {
+        if ( t != row ) redraw_range(t, t, leftcol, rightcol);
+      }
+      _rowselect.all(0);
+      _rowselect.set(row, row+1, newval);
+      if ( oldval != newval ) {
+        redraw_range(row, row, leftcol, rightcol);
+        ret = 1;
       }
       break;
     }
 
     case SELECT_MULTI: {
-      int oldval = _rowselect[row];
-      if ( flag == 2 ) { _rowselect[row] ^= 1; }
-      else             { _rowselect[row] = flag; }
-      if ( _rowselect[row] != oldval ) {                // select state changed?
+      int oldval = _rowselect.get(row);
+      if ( flag == 2 ) { _rowselect.toggle(row, row+1); }
+      else             { _rowselect.set(row, row+1, flag); }
+      if ( _rowselect.get(row) != oldval ) {            // select state changed?
         if ( row >= toprow && row <= botrow ) {         // row visible?
           // Extend partial redraw range
           redraw_range(row, row, leftcol, rightcol);
@@ -166,15 +305,12 @@ void Fl_Table_Row::select_all_rows(int flag) {
     case SELECT_MULTI: {
       char changed = 0;
       if ( flag == 2 ) {
-        for ( int row=0; row<(int)_rowselect.size(); row++ ) {
-          _rowselect[row] ^= 1;
-        }
+        _rowselect.toggle_all();                // O(1): invert the set
         changed = 1;
       } else {
-        for ( int row=0; row<(int)_rowselect.size(); row++ ) {
-          changed |= (_rowselect[row] != flag)?1:0;
-          _rowselect[row] = flag;
-        }
+        int want = flag ? _rowselect.size() : 0;
+        changed = ( _rowselect.count(0, _rowselect.size()) != want ) ? 1 : 0;
+        _rowselect.all(flag);                   // O(1)
       }
       if ( changed ) {
         redraw();
@@ -183,11 +319,56 @@ void Fl_Table_Row::select_all_rows(int flag) {
   }
 }
 
+// Change selection state for rows 'from' through 'to' (inclusive)
+//
+//     flag:
+//        0 - clear selection
+//        1 - set selection
+//        2 - toggle selection
+//
+//     Returns:
+//        0 - selection state did not change
+//        1 - selection state changed
+//       -1 - rows out of range or incorrect selection mode
+//
+int Fl_Table_Row::select_rows(int from, int to, int flag) {
+  if ( from > to ) { int t = from; from = to; to = t; }
+  if ( from < 0 || to >= rows() ) { return(-1); }
+  switch ( _selectmode ) {
+    case SELECT_NONE:
+      return(-1);
+
+    case SELECT_SINGLE:                         // same as selecting each row in turn
+      if ( flag == 2 ) {
+        int ret = 0;
+        for ( int row = from; row <= to; row++ ) ret |= select_row(row, 2);
+        return(ret);
+      }
+      return(select_row(flag ? to : from, flag));
+
+    case SELECT_MULTI: {
+      int ret = 1;
+      if ( flag == 2 ) {
+        _rowselect.toggle(from, to+1);          // toggling always changes
+      } else {
+        int before = _rowselect.count(from, to+1);
+        ret = ( before != (flag ? (to - from + 1) : 0) ) ? 1 : 0;
+        _rowselect.set(from, to+1, flag);
+      }
+      if ( ret && to >= toprow && from <= botrow ) {    // rows visible?
+        // Extend partial redraw range
+        redraw_range(from < toprow ? toprow : from, to > botrow ? botrow : to, leftcol, rightcol);
+      }
+      return(ret);
+    }
+  }
+  return(0);
+}
+
 // Set number of rows
 void Fl_Table_Row::rows(int val) {
   Fl_Table::rows(val);
-  while ( val > (int)_rowselect.size() ) { _rowselect.push_back(0); }   // enlarge
-  while ( val < (int)_rowselect.size() ) { _rowselect.pop_back(); }     // shrink
+  _rowselect.size(val);         // new rows are not selected
 }
 
 // Handle events
@@ -244,9 +425,7 @@ int Fl_Table_Row::handle(int event) {
                   srow = _last_row;
                   erow = R;
                 }
-                for ( int row = srow; row <= erow; row++ ) {
-                  select_row(row, 1);
-                }
+                select_rows(srow, erow, 1);
               }
               break;
             }
@@ -310,9 +489,7 @@ int Fl_Table_Row::handle(int event) {
                   srow = _last_row;
                   erow = R;
                 }
-                for ( int row = srow; row <= erow; row++ ) {
-                  select_row(row, 1);
-                }
+                select_rows(srow, erow, 1);
               }
               break;
           }
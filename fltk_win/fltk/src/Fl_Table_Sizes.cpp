@@ -0,0 +1,345 @@
+//
+// Row height / column width storage for Fl_Table.
+//
+// Copyright 2002 by Greg Ercolano.
+// Copyright 2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "Fl_Table_Sizes.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Upgrade from runs to dense storage when there are more runs than
+// this, and more than one run per RUNS_PER_ENTRY entries, or in any
+// case beyond MAX_RUNS runs: value() updates the runs in O(#runs), so
+// that bounds the cost of a resize on huge tables.
+static const int MIN_DENSE_RUNS = 16;
+static const int RUNS_PER_ENTRY = 4;
+static const int MAX_RUNS = 2048;
+
+/** Destructor - frees the internal arrays. */
+Fl_Table_Sizes::~Fl_Table_Sizes() {
+  free_dense();
+  if (run_start_) free(run_start_);
+  if (run_val_) free(run_val_);
+  if (run_pos_) free(run_pos_);
+}
+
+/**
+  Free the dense arrays, if any.
+  Private: the caller must set up the runs.
+*/
+void Fl_Table_Sizes::free_dense() {
+  if (arr_) free(arr_);
+  if (sum_) free(sum_);
+  arr_ = 0;
+  sum_ = 0;
+  alloc_ = 0;
+}
+
+/**
+  Rebuild the Fenwick tree from the entries in O(n).
+  Private: used after resizing the dense arrays.
+*/
+void Fl_Table_Sizes::rebuild() {
+  int i;
+  for (i = 1; i <= size_; i++)
+    sum_[i] = arr_[i-1];
+  for (i = 1; i <= size_; i++) {
+    int j = i + (i & -i);                       // parent node
+    if (j <= size_) sum_[j] += sum_[i];
+  }
+}
+
+/**
+  Convert the runs to dense storage with one int per entry.
+  Private: used when the runs became too fragmented.
+*/
+void Fl_Table_Sizes::make_dense() {
+  alloc_ = size_;
+  arr_ = (int *)malloc(alloc_ * sizeof(int));
+  sum_ = (long *)malloc((alloc_ + 1) * sizeof(long));
+  for (int j = 0; j < nruns_; j++) {
+    int end = (j + 1 < nruns_) ? run_start_[j+1] : size_;
+    for (int t = run_start_[j]; t < end; t++)
+      arr_[t] = run_val_[j];
+  }
+  if (run_start_) free(run_start_);
+  if (run_val_) free(run_val_);
+  if (run_pos_) free(run_pos_);
+  run_start_ = run_val_ = 0;
+  run_pos_ = 0;
+  nruns_ = runalloc_ = 0;
+  rebuild();
+}
+
+/**
+  Return the run containing entry \p index in O(log runs).
+  Private: \p index must be in the range 0 .. size()-1.
+*/
+int Fl_Table_Sizes::run_find(int index) const {
+  int lo = 0, hi = nruns_ - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (run_start_[mid] <= index) lo = mid;
+    else hi = mid - 1;
+  }
+  return lo;
+}
+
+/**
+  Return the size of entry \p index from the runs.
+  Private: used by value(int) if there is no dense storage.
+*/
+int Fl_Table_Sizes::run_size(int index) const {
+  return run_val_[run_find(index)];
+}
+
+/**
+  Make room for at least \p count runs.
+  Private: grows the run arrays geometrically.
+*/
+void Fl_Table_Sizes::run_room(int count) {
+  if (count <= runalloc_) return;
+  int newalloc = runalloc_ * 2;
+  if (newalloc < count) newalloc = count;
+  if (newalloc < 4) newalloc = 4;
+  run_start_ = (int *)realloc(run_start_, newalloc * sizeof(int));
+  run_val_ = (int *)realloc(run_val_, newalloc * sizeof(int));
+  run_pos_ = (long *)realloc(run_pos_, newalloc * sizeof(long));
+  runalloc_ = newalloc;
+}
+
+/**
+  Insert a run starting at entry \p start with size \p val at slot \p at.
+  Private: the caller must update the positions with run_positions().
+*/
+void Fl_Table_Sizes::run_insert(int at, int start, int val) {
+  run_room(nruns_ + 1);
+  int move = nruns_ - at;
+  if (move > 0) {
+    memmove(run_start_ + at + 1, run_start_ + at, move * sizeof(int));
+    memmove(run_val_ + at + 1, run_val_ + at, move * sizeof(int));
+    memmove(run_pos_ + at + 1, run_pos_ + at, move * sizeof(long));
+  }
+  run_start_[at] = start;
+  run_val_[at] = val;
+  run_pos_[at] = 0;
+  nruns_++;
+}
+
+/**
+  Remove \p count runs starting at slot \p at.
+  Private: the caller must update the positions with run_positions().
+*/
+void Fl_Table_Sizes::run_remove(int at, int count) {
+  int move = nruns_ - at - count;
+  if (move > 0) {
+    memmove(run_start_ + at, run_start_ + at + count, move * sizeof(int));
+    memmove(run_val_ + at, run_val_ + at + count, move * sizeof(int));
+    memmove(run_pos_ + at, run_pos_ + at + count, move * sizeof(long));
+  }
+  nruns_ -= count;
+}
+
+/**
+  Recalculate the positions of the runs from slot \p from to the end.
+  Private: used after inserting or removing runs.
+*/
+void Fl_Table_Sizes::run_positions(int from) {
+  if (nruns_ > 0) run_pos_[0] = 0;
+  if (from < 1) from = 1;
+  for (int j = from; j < nruns_; j++)
+    run_pos_[j] = run_pos_[j-1] + (long)(run_start_[j] - run_start_[j-1]) * run_val_[j-1];
+}
+
+/**
+  Change the size of entry \p index in the runs.
+  Private: splits the run holding \p index and merges equal neighbours,
+  then switches to dense storage if there are too many runs.
+*/
+void Fl_Table_Sizes::run_value(int index, int val) {
+  int j = run_find(index);
+  if (run_val_[j] == val) return;
+  int start = run_start_[j];
+  int end = (j + 1 < nruns_) ? run_start_[j+1] : size_;
+  if (end - start == 1) {                       // run of one: just change it
+    run_val_[j] = val;
+  } else if (index == start) {                  // split off the first entry
+    run_insert(j + 1, index + 1, run_val_[j]);
+    run_val_[j] = val;
+  } else if (index == end - 1) {                // split off the last entry
+    run_insert(j + 1, index, val);
+    j++;
+  } else {                                      // split into three runs
+    run_insert(j + 1, index, val);
+    run_insert(j + 2, index + 1, run_val_[j]);
+    j++;
+  }
+  // run j now holds just 'index': merge with equal neighbours
+  if (j + 1 < nruns_ && run_val_[j+1] == val) run_remove(j + 1, 1);
+  if (j > 0 && run_val_[j-1] == val) { run_remove(j, 1); j--; }
+  if (nruns_ > MAX_RUNS ||
+      (nruns_ > MIN_DENSE_RUNS && nruns_ > size_ / RUNS_PER_ENTRY)) {
+    make_dense();
+    return;
+  }
+  run_positions(j);
+}
+
+/**
+  Set the number of entries to \p count.
+
+  New entries get the size \p fill. Shrinking keeps the remaining entries
+  (and their positions) unchanged; setting size to zero frees all memory.
+
+  Appending entries with the same size as the last one costs O(1)
+  unless the sizes are stored densely.
+*/
+void Fl_Table_Sizes::size(int count, int fill) {
+  if (count < 0) count = 0;
+  if (count == 0) {
+    free_dense();
+    if (run_start_) free(run_start_);
+    if (run_val_) free(run_val_);
+    if (run_pos_) free(run_pos_);
+    run_start_ = run_val_ = 0;
+    run_pos_ = 0;
+    nruns_ = runalloc_ = 0;
+    size_ = 0;
+    return;
+  }
+  if (!arr_) {                                  // runs
+    if (count <= size_) {                       // shrink: drop runs past the end
+      nruns_ = run_find(count - 1) + 1;
+    } else if (nruns_ == 0 || run_val_[nruns_-1] != fill) {
+      long end = total();                       // append a run
+      run_insert(nruns_, size_, fill);
+      run_pos_[nruns_-1] = end;
+    }
+    size_ = count;
+    return;
+  }
+  if (count <= size_) {                         // shrink: tree prefix is still valid
+    size_ = count;
+    return;
+  }
+  if (count > alloc_) {                         // grow allocation geometrically
+    int newalloc = alloc_ * 2;
+    if (newalloc < count) newalloc = count;
+    arr_ = (int *)realloc(arr_, newalloc * sizeof(int));
+    sum_ = (long *)realloc(sum_, (newalloc + 1) * sizeof(long));
+    alloc_ = newalloc;
+  }
+  for (int t = size_; t < count; t++)
+    arr_[t] = fill;
+  size_ = count;
+  rebuild();
+}
+
+/**
+  Set the size of entry \p index to \p val.
+  This is O(log n) for dense storage, or O(runs) when runs have to be split.
+  \warning No range checking is done on \p index, which must be less than size().
+*/
+void Fl_Table_Sizes::value(int index, int val) {
+  if (!arr_) {
+    run_value(index, val);
+    return;
+  }
+  long delta = (long)val - arr_[index];
+  arr_[index] = val;
+  for (int i = index + 1; i <= size_; i += (i & -i))
+    sum_[i] += delta;
+}
+
+/**
+  Set all entries to the size \p val in O(1), keeping size().
+  This frees the dense storage, if any.
+*/
+void Fl_Table_Sizes::fill(int val) {
+  free_dense();
+  nruns_ = 0;
+  if (size_ == 0) return;
+  run_room(1);
+  run_start_[0] = 0;
+  run_val_[0] = val;
+  run_pos_[0] = 0;
+  nruns_ = 1;
+}
+
+/**
+  Return the sum of the sizes of all entries before \p index,
+  i.e. the scroll position of row or column \p index.
+  Indexes past the end return total().
+*/
+long Fl_Table_Sizes::position(int index) const {
+  if (index > size_) index = size_;
+  if (index <= 0) return 0;
+  if (!arr_) {                                  // runs: closed form
+    int j = run_find(index - 1);
+    return run_pos_[j] + (long)(index - run_start_[j]) * run_val_[j];
+  }
+  long pos = 0;
+  for (int i = index; i > 0; i -= (i & -i))
+    pos += sum_[i];
+  return pos;
+}
+
+/**
+  Return the number of leading entries that end at or before \p pos,
+  which is the index of the entry containing scroll position \p pos
+  (or size() if \p pos is at or past the end).
+
+  This is the largest \p k with position(k) <= \p pos, found in O(log n)
+  by a binary search over the runs, or by descending the Fenwick tree.
+  Sizes must not be negative.
+*/
+int Fl_Table_Sizes::find(long pos) const {
+  if (pos < 0) return 0;
+  if (!arr_) {
+    if (nruns_ == 0) return 0;
+    int lo = 0, hi = nruns_ - 1;                // last run starting at or before pos
+    while (lo < hi) {
+      int mid = (lo + hi + 1) / 2;
+      if (run_pos_[mid] <= pos) lo = mid;
+      else hi = mid - 1;
+    }
+    int end = (lo + 1 < nruns_) ? run_start_[lo+1] : size_;
+    if (run_val_[lo] <= 0) return end;
+    long m = (pos - run_pos_[lo]) / run_val_[lo];
+    if (m >= end - run_start_[lo]) return end;
+    return run_start_[lo] + (int)m;
+  }
+  int k = 0;
+  int step = 1;
+  while (step * 2 <= size_) step *= 2;
+  for ( ; step > 0; step /= 2) {
+    if (k + step <= size_ && sum_[k + step] <= pos) {
+      k += step;
+      pos -= sum_[k];
+    }
+  }
+  return k;
+}
+
+/**
+ \}
+ \endcond
+ */
@@ -0,0 +1,122 @@
+//
+// Row height / column width storage for Fl_Table.
+//
+// Copyright 2002 by Greg Ercolano.
+// Copyright 2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#ifndef Fl_Table_Sizes_H
+#define Fl_Table_Sizes_H
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "../hdr/Fl_Export.h"
+
+/** \file src/Fl_Table_Sizes.h
+  Row heights or column widths of an Fl_Table, with fast position lookup.
+*/
+
+/**
+  The row heights (or column widths) of an Fl_Table.
+
+  Tables usually have all or most entries at the same size, so entries
+  are first stored as runs of equal sizes: a uniform table of any size
+  is a single run using O(1) memory, and positions are computed in
+  closed form by a binary search over the runs:
+
+  - position(i) returns the sum of the sizes of entries 0..i-1,
+    i.e. the scroll position of row/column i
+  - find(pos) returns the entry at scroll position pos
+  - value(i, val) changes one entry, splitting a run if needed
+
+  When individual resizes have split the runs too much (a few thousand
+  runs at most, as each resize costs O(#runs)) the storage is
+  transparently upgraded to one int per entry plus a Fenwick tree
+  (binary indexed tree) of the sizes, so all of the above remain
+  O(log n). fill() returns to a single run.
+
+  \note This class is only for internal use by Fl_Table.
+*/
+class FL_EXPORT Fl_Table_Sizes {
+  // dense storage, used if arr_ != 0
+  int *arr_;                    // size of each entry
+  long *sum_;                   // Fenwick tree over arr_, 1-based (sum_[0] unused)
+  int alloc_;                   // #entries allocated
+  // run storage, used if arr_ == 0: run j covers entries
+  // run_start_[j] .. run_start_[j+1]-1 (or size_-1 for the last run)
+  int *run_start_;              // first entry of each run
+  int *run_val_;                // size of each entry in the run
+  long *run_pos_;               // position of the run's first entry
+  int nruns_;                   // #runs
+  int runalloc_;                // #runs allocated
+  int size_;                    // #entries
+  void rebuild();
+  void free_dense();
+  void make_dense();
+  int run_find(int index) const;
+  void run_room(int count);
+  void run_insert(int at, int start, int val);
+  void run_remove(int at, int count);
+  void run_value(int index, int val);
+  void run_positions(int from);
+  int run_size(int index) const;
+
+public:
+  /** Create an empty list of sizes. */
+  Fl_Table_Sizes() {
+    arr_ = 0;
+    sum_ = 0;
+    alloc_ = 0;
+    run_start_ = 0;
+    run_val_ = 0;
+    run_pos_ = 0;
+    nruns_ = 0;
+    runalloc_ = 0;
+    size_ = 0;
+  }
+  ~Fl_Table_Sizes();
+
+  /** Return the number of entries. */
+  int size() const {
+    return size_;
+  }
+  void size(int count, int fill);
+
+  /**
+    Return the size of entry \p index.
+    \warning No range checking is done on \p index, which must be less than size().
+  */
+  int value(int index) const {
+    return arr_ ? arr_[index] : run_size(index);
+  }
+  void value(int index, int val);
+
+  long position(int index) const;
+  /** Return the sum of all entries, e.g. the table's total height. */
+  long total() const {
+    return position(size_);
+  }
+  int find(long pos) const;
+  void fill(int val);
+};
+
+/**
+ \}
+ \endcond
+ */
+
+#endif // Fl_Table_Sizes_H
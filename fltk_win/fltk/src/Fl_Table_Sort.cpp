@@ -0,0 +1,330 @@
+//
+// Row order for Fl_Table.
+//
+// Copyright 2002 by Greg Ercolano.
+// Copyright 2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "Fl_Table_Sort.h"
+#include "Fl_Worker_Pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The rows of one sort, shared by the sort and its jobs: an abandoned
+// sort leaves them to the jobs still running, the last one frees them
+struct Fl_Table_Sort_Work {
+  Fl_Table_Row_Compare *cmp;
+  void *data;
+  int *rows;                    // the rows being sorted
+  int *tmp;                     // scratch space for merging
+  int refs;                     // the sort, if still using them, and its jobs
+};
+
+// Sort a chunk (mid < 0) or merge two sorted runs, on a worker thread
+struct Fl_Table_Sort_Job {
+  Fl_Table_Sort *sort;
+  Fl_Table_Sort_Work *work;     // the rows
+  int generation;               // sort generation when submitted
+  int lo, mid, hi;              // rows[lo..mid-1] and rows[mid..hi-1]
+  Fl_Table_Sort_Job *next;      // next job in flight
+};
+
+// Sort fewer rows than this right away, in the main thread
+static const int MIN_PARALLEL = 16384;
+// Chunks are first sorted in runs of this many rows by insertion sort
+static const int INSERTION_RUN = 16;
+
+// Stable merge of src[lo..mid-1] and src[mid..hi-1] into dst[lo..hi-1]
+static void merge_runs(const int *src, int *dst, int lo, int mid, int hi,
+                       Fl_Table_Row_Compare *cmp, void *data) {
+  int i = lo, j = mid, k = lo;
+  while (i < mid && j < hi)
+    dst[k++] = (cmp(src[j], src[i], data) < 0) ? src[j++] : src[i++];
+  while (i < mid) dst[k++] = src[i++];
+  while (j < hi) dst[k++] = src[j++];
+}
+
+// Stable bottom-up merge sort of a[lo..hi-1], using tmp[lo..hi-1]
+static void sort_rows(int *a, int *tmp, int lo, int hi,
+                      Fl_Table_Row_Compare *cmp, void *data) {
+  int s, width;
+  for (s = lo; s < hi; s += INSERTION_RUN) {
+    int e = (s + INSERTION_RUN < hi) ? s + INSERTION_RUN : hi;
+    for (int i = s + 1; i < e; i++) {
+      int x = a[i], j = i;
+      for ( ; j > s && cmp(a[j-1], x, data) > 0; j--) a[j] = a[j-1];
+      a[j] = x;
+    }
+  }
+  int *src = a, *dst = tmp;
+  for (width = INSERTION_RUN; width < hi - lo; width *= 2) {
+    for (s = lo; s < hi; s += 2 * width) {
+      int mid = (s + width < hi) ? s + width : hi;
+      int e = (s + 2 * width < hi) ? s + 2 * width : hi;
+      merge_runs(src, dst, s, mid, e, cmp, data);
+    }
+    int *t = src; src = dst; dst = t;
+  }
+  if (src != a) memcpy(a + lo, src + lo, (hi - lo) * sizeof(int));
+}
+
+// Drop a reference to 'w', freeing it with the last one (main thread only)
+static void release_work(Fl_Table_Sort_Work *w) {
+  if (--w->refs > 0) return;
+  free(w->rows);
+  free(w->tmp);
+  free(w);
+}
+
+/** Create the identity order for \p table. */
+Fl_Table_Sort::Fl_Table_Sort(Fl_Table *table) {
+  table_ = table;
+  perm_ = 0;
+  inv_ = 0;
+  n_ = table->rows();
+  work_ = 0;
+  bounds_ = 0;
+  nruns_ = pending_ = 0;
+  generation_ = 0;
+  inflight_ = 0;
+  jobs_ = 0;
+}
+
+/** Private: use destroy(). */
+Fl_Table_Sort::~Fl_Table_Sort() {
+  abandon();
+  if (perm_) free(perm_);
+  if (inv_) free(inv_);
+}
+
+/**
+  Called by the table's destructor.
+  Abandons a sort in progress without waiting for its running jobs.
+  The object itself is deleted now, or when the last of them is
+  delivered.
+*/
+void Fl_Table_Sort::destroy() {
+  table_ = 0;
+  abandon();
+  if (inflight_ == 0) delete this;
+}
+
+/**
+  Return the view row showing model row \p M.
+  The inverse order is built in O(n) on first use after a sort.
+*/
+int Fl_Table_Sort::view(int M) {
+  if (!perm_ || M < 0 || M >= n_) return M;
+  if (!inv_) {
+    inv_ = (int*)malloc(n_ * sizeof(int));
+    for (int t = 0; t < n_; t++) inv_[perm_[t]] = t;
+  }
+  return inv_[M];
+}
+
+/**
+  The table's number of rows changed to \p n.
+  New model rows are shown at the end, removed ones are taken out of
+  the order. A sort in progress is restarted.
+*/
+void Fl_Table_Sort::rows(int n) {
+  if (n < 0) n = 0;
+  if (n == n_) return;
+  Fl_Table_Row_Compare *cmp = work_ ? work_->cmp : 0;
+  void *data = work_ ? work_->data : 0;
+  abandon();
+  if (perm_) {
+    if (n > n_) {
+      perm_ = (int*)realloc(perm_, n * sizeof(int));
+      for (int t = n_; t < n; t++) perm_[t] = t;
+    } else {
+      int k = 0;
+      for (int t = 0; t < n_; t++)
+        if (perm_[t] < n) perm_[k++] = perm_[t];
+    }
+    if (inv_) free(inv_);
+    inv_ = 0;
+  }
+  n_ = n;
+  if (cmp) sort(cmp, data);
+}
+
+/** Forget the sort order: view rows show the same model rows. */
+void Fl_Table_Sort::reset() {
+  abandon();
+  if (perm_) free(perm_);
+  if (inv_) free(inv_);
+  perm_ = inv_ = 0;
+}
+
+/**
+  Start sorting the current order with \p cmp in the background, or
+  sort it right away if there are few rows.
+  A sort in progress is abandoned. The table is redrawn when done.
+*/
+void Fl_Table_Sort::sort(Fl_Table_Row_Compare *cmp, void *data) {
+  abandon();
+  if (n_ < 2 || !cmp) return;
+  if (n_ < MIN_PARALLEL) {                      // not worth the threads
+    int *rows = (int*)malloc(n_ * sizeof(int));
+    int *tmp = (int*)malloc(n_ * sizeof(int));
+    for (int t = 0; t < n_; t++) rows[t] = perm_ ? perm_[t] : t;
+    sort_rows(rows, tmp, 0, n_, cmp, data);
+    free(tmp);
+    if (perm_) free(perm_);
+    if (inv_) free(inv_);
+    perm_ = rows;
+    inv_ = 0;
+    table_->redraw();
+    return;
+  }
+  work_ = (Fl_Table_Sort_Work*)malloc(sizeof(Fl_Table_Sort_Work));
+  work_->cmp = cmp;
+  work_->data = data;
+  work_->rows = (int*)malloc(n_ * sizeof(int));
+  work_->tmp = (int*)malloc(n_ * sizeof(int));
+  work_->refs = 1;
+  for (int t = 0; t < n_; t++) work_->rows[t] = perm_ ? perm_[t] : t;
+  int k = Fl_Worker_Pool::shared()->threads();
+  if (k < 1) k = 1;
+  bounds_ = (int*)malloc((k + 1) * sizeof(int));
+  for (int i = 0; i <= k; i++)
+    bounds_[i] = (int)((double)n_ * i / k);
+  nruns_ = k;
+  pending_ = 0;
+  for (int i = 0; i < k; i++)                   // sort the chunks in parallel
+    submit(bounds_[i], -1, bounds_[i+1]);
+}
+
+/**
+  Submit a job sorting rows lo..hi-1 (mid < 0) or merging the runs
+  lo..mid-1 and mid..hi-1.
+*/
+void Fl_Table_Sort::submit(int lo, int mid, int hi) {
+  Fl_Table_Sort_Job *job = (Fl_Table_Sort_Job*)malloc(sizeof(Fl_Table_Sort_Job));
+  job->sort = this;
+  job->work = work_;
+  work_->refs++;
+  job->generation = generation_;
+  job->lo = lo;
+  job->mid = mid;
+  job->hi = hi;
+  job->next = jobs_;
+  jobs_ = job;
+  inflight_++;
+  pending_++;
+  Fl_Worker_Pool::shared()->submit(job_run, job);
+}
+
+/**
+  Abandon the sort in progress, if any: cancel its queued jobs, and
+  leave the rows to the running ones. Their results are ignored when
+  delivered, since the generation changed.
+*/
+void Fl_Table_Sort::abandon() {
+  if (!work_) return;
+  Fl_Table_Sort_Job **pj = &jobs_;
+  while (*pj) {
+    Fl_Table_Sort_Job *job = *pj;
+    if (Fl_Worker_Pool::shared()->cancel(job)) {
+      *pj = job->next;
+      release_work(job->work);
+      free(job);
+      inflight_--;
+    } else {
+      pj = &job->next;
+    }
+  }
+  release_work(work_);
+  free(bounds_);
+  work_ = 0;
+  bounds_ = 0;
+  nruns_ = pending_ = 0;
+  generation_++;
+}
+
+/**
+  All jobs of a round arrived: merge pairs of runs in parallel,
+  or use the result if there is one run left.
+*/
+void Fl_Table_Sort::next_round() {
+  if (nruns_ <= 1) {                            // done
+    if (perm_) free(perm_);
+    if (inv_) free(inv_);
+    perm_ = work_->rows;
+    inv_ = 0;
+    work_->rows = 0;
+    release_work(work_);
+    work_ = 0;
+    free(bounds_);
+    bounds_ = 0;
+    nruns_ = 0;
+    table_->redraw();
+    return;
+  }
+  int i, j;
+  for (i = 0; i + 1 < nruns_; i += 2)
+    submit(bounds_[i], bounds_[i+1], bounds_[i+2]);
+  for (i = 0, j = 0; i < nruns_; i += 2)        // an odd last run is kept as is
+    bounds_[j++] = bounds_[i];
+  bounds_[j] = bounds_[nruns_];
+  nruns_ = j;
+}
+
+/**
+  Run a job on a worker thread.
+*/
+void Fl_Table_Sort::job_run(void *v) {
+  Fl_Table_Sort_Job *job = (Fl_Table_Sort_Job*)v;
+  Fl_Table_Sort_Work *w = job->work;
+  if (job->mid < 0) {
+    sort_rows(w->rows, w->tmp, job->lo, job->hi, w->cmp, w->data);
+  } else {
+    merge_runs(w->rows, w->tmp, job->lo, job->mid, job->hi, w->cmp, w->data);
+    memcpy(w->rows + job->lo, w->tmp + job->lo, (job->hi - job->lo) * sizeof(int));
+  }
+  Fl_Worker_Pool::awake(job_done, job);
+}
+
+/**
+  A job arrived in the main thread: start the next round when the
+  current one is complete.
+*/
+void Fl_Table_Sort::job_done(void *v) {
+  Fl_Table_Sort_Job *job = (Fl_Table_Sort_Job*)v;
+  Fl_Table_Sort *s = job->sort;
+  Fl_Table_Sort_Job **pj = &s->jobs_;
+  while (*pj != job) pj = &(*pj)->next;
+  *pj = job->next;
+  s->inflight_--;
+  int current = (s->table_ && job->generation == s->generation_);
+  release_work(job->work);
+  free(job);
+  if (!s->table_) {
+    if (s->inflight_ == 0) delete s;
+    return;
+  }
+  if (current && --s->pending_ == 0)
+    s->next_round();
+}
+
+/**
+ \}
+ \endcond
+ */
@@ -0,0 +1,103 @@
+//
+// Row order for Fl_Table.
+//
+// Copyright 2002 by Greg Ercolano.
+// Copyright 2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#ifndef Fl_Table_Sort_H
+#define Fl_Table_Sort_H
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "../hdr/Fl_Table.h"
+
+struct Fl_Table_Sort_Job;
+struct Fl_Table_Sort_Work;
+
+/** \file src/Fl_Table_Sort.h
+  The order in which an Fl_Table shows the rows of its data.
+*/
+
+/**
+  Maps the rows shown by an Fl_Table (view rows) to the rows of the
+  application's data (model rows), and sorts them in the background.
+
+  Without sorting the mapping is the identity and uses no memory.
+
+  sort() copies the current order and sorts it with a stable merge sort.
+  Small tables are sorted right away. Larger ones are sorted on the
+  threads of Fl_Worker_Pool::shared(): the rows are split in one chunk
+  per thread, the chunks are sorted in parallel, then merged pairwise
+  in parallel rounds. The main thread only submits the jobs as the
+  previous ones arrive through Fl::awake(), so it is never blocked.
+  The new order replaces the old one when the sort is complete.
+
+  An abandoned sort is not waited for: its queued jobs are cancelled and
+  the results of running ones are ignored, as they belong to an older
+  generation. The running jobs work on rows they share with the sort
+  (Fl_Table_Sort_Work), freed by the last one. As with Fl_Table_Cache,
+  results may still be on their way when the table is destroyed, so
+  the object deletes itself when the last one arrives.
+
+  \note This class is only for internal use by Fl_Table.
+*/
+class FL_EXPORT Fl_Table_Sort {
+  Fl_Table *table_;             // the table, 0 once it was destroyed
+  int *perm_;                   // view row -> model row, 0: identity
+  int *inv_;                    // model row -> view row, 0 until needed
+  int n_;                       // #rows
+  // sort in progress
+  Fl_Table_Sort_Work *work_;    // the rows being sorted, shared with the jobs (0: not sorting)
+  int *bounds_;                 // sorted runs: rows[bounds_[i] .. bounds_[i+1]-1]
+  int nruns_;
+  int pending_;                 // jobs of the current round not done yet
+  int generation_;              // incremented when a sort is abandoned
+  int inflight_;                // jobs submitted but not delivered yet
+  Fl_Table_Sort_Job *jobs_;     // those jobs
+
+  ~Fl_Table_Sort();
+  void submit(int lo, int mid, int hi);
+  void abandon();
+  void next_round();
+  static void job_run(void *v);
+  static void job_done(void *v);
+
+public:
+  Fl_Table_Sort(Fl_Table *table);
+  void destroy();
+
+  /** Return the model row shown in view row \p R. */
+  int model(int R) const {
+    return (perm_ && R >= 0 && R < n_) ? perm_[R] : R;
+  }
+  int view(int M);
+  void rows(int n);
+  void sort(Fl_Table_Row_Compare *cmp, void *data);
+  void reset();
+  /** Return 1 while a sort is in progress. */
+  int sorting() const {
+    return work_ != 0;
+  }
+};
+
+/**
+ \}
+ \endcond
+ */
+
+#endif // Fl_Table_Sort_H
@@ -7,6 +7,7 @@
 #include "../hdr/Fl_Tree.h"
 #include "../hdr/Fl_Preferences.h"
 #include "../hdr/fl_string_functions.h"
+#include "../hdr/fl_utf8.h"
 
 //////////////////////
 // Fl_Tree.cxx
@@ -76,7 +77,8 @@ static int find_total_children(Fl_Tree_Item *item, int count=0) {
 
 /// Constructor.
 Fl_Tree::Fl_Tree(int X, int Y, int W, int H, const char *L) : Fl_Group(X,Y,W,H,L) {
-  _root = new Fl_Tree_Item(this);
+  _item_pool = 0;
+  _root = new(this) Fl_Tree_Item(this);
   _root->parent(0);                             // we are root of tree
   _root->label("ROOT");
   _item_focus      = 0;
@@ -85,6 +87,23 @@ Fl_Tree::Fl_Tree(int X, int Y, int W, int H, const char *L) : Fl_Group(X,Y,W,H,L
   _scrollbar_size  = 0;                         // 0: uses Fl::scrollbar_size()
 
   _lastselect       = 0;
+  _populate_cb      = 0;
+  _populate_data    = 0;
+  _unload_budget    = 0;                        // 0: never unload
+  _loaded_items     = 0;
+  _selection_sorted = 1;
+  _order_valid      = 0;
+  _label_arena      = 0;
+  _arena_blocks     = 0;
+  _arena_nblocks    = 0;
+  _arena_left       = 0;
+  _prefix_items     = 0;
+  _prefix_min       = 0;
+  _prefix_total     = 0;
+  _prefix_valid     = 0;
+  _typeahead_on     = 0;
+  _typeahead[0]     = 0;
+  _typeahead_len    = 0;
 
   box(FL_DOWN_BOX);
   color(FL_BACKGROUND2_COLOR, FL_SELECTION_COLOR);
@@ -112,6 +131,12 @@ Fl_Tree::Fl_Tree(int X, int Y, int W, int H, const char *L) : Fl_Group(X,Y,W,H,L
 /// Destructor.
 Fl_Tree::~Fl_Tree() {
   if ( _root ) { delete _root; _root = 0; }
+  arena_free();
+  Fl_Tree_Item::release_pool(_item_pool, 1);
+  free((void*)_prefix_items);
+  free((void*)_prefix_min);
+  Fl::remove_timeout(typeahead_timeout_cb, (void*)this);
+  Fl::remove_timeout(populate_timeout_cb, (void*)this);
 }
 
 /// Extend the selection between and including \p 'from' and \p 'to'
@@ -277,6 +302,15 @@ int Fl_Tree::handle(int e) {
         }
         if ( _item_focus ) {
           int ekey = Fl::event_key();
+          // Type-ahead: printable text (except SPACE, which selects)
+          //    jumps to the first item whose label starts with what was typed
+          if ( _typeahead_on && !is_command &&
+               !(Fl::event_state() & (FL_CTRL|FL_ALT|FL_META)) &&
+               Fl::event_length() > 0 && (uchar)Fl::event_text()[0] > ' ' &&
+               Fl::event_text()[0] != 0x7f ) {
+            if ( typeahead_key(Fl::event_text(), Fl::event_length()) )
+              return(1);                                        // done, we handled key
+          }
           switch (ekey) {
             case FL_Enter:      // ENTER: toggle open/close
             case FL_KP_Enter: {
@@ -722,6 +756,9 @@ void Fl_Tree::draw() {
       W += _prefs.openicon_w();
     }
     // Draw entire tree, starting with root
+    //     Open unloaded items that scrolled into view are queued for
+    //     populate_timeout_cb(); drawing never changes the tree.
+    //
     fl_push_clip(_tix,_tiy,_tiw,_tih);
     {
       int xmax = 0;
@@ -798,8 +835,14 @@ Fl_Tree_Item* Fl_Tree::root() {
 /// \version 1.3.3
 ///
 void Fl_Tree::root(Fl_Tree_Item *newitem) {
-  if ( _root ) clear();
+  if ( _root ) {
+    // newitem's subtree may have labels in the arena that clear() releases
+    if ( newitem ) newitem->unarena_labels();
+    clear();
+  }
   _root = newitem;
+  if ( newitem ) newitem->update_selection_r(1);  // clear() emptied the selection index
+  _order_valid = _prefix_valid = 0;
 }
 
 /** Adds a new item, given a menu style \p 'path'.
@@ -826,7 +869,7 @@ void Fl_Tree::root(Fl_Tree_Item *newitem) {
 Fl_Tree_Item* Fl_Tree::add(const char *path, Fl_Tree_Item *item) {
   // Tree has no root? make one
   if ( ! _root ) {
-    _root = new Fl_Tree_Item(this);
+    _root = new(this) Fl_Tree_Item(this);
     _root->parent(0);
     _root->label("ROOT");
   }
@@ -937,6 +980,11 @@ void Fl_Tree::clear() {
   delete _root; _root = 0;
   _item_focus = 0;
   _lastselect = 0;
+  _loaded_items = 0;
+  _order_valid = 0;
+  _prefix_valid = 0;
+  arena_free();                                 // all labels in it are gone
+  Fl_Tree_Item::release_pool(_item_pool, 0);    // all slabs at once
 }
 
 /// Clear all the children for \p 'item'.
@@ -1360,6 +1408,10 @@ Fl_Tree_Item *Fl_Tree::next_item(Fl_Tree_Item *item, int dir, bool visible) {
  If \p 'item' is 0, search starts at either first() or last(), depending on \p 'dir':
  first() if \p 'dir' is FL_Down (default), last() if \p 'dir' is FL_Up.
 
+ The tree keeps an index of its selected items, so this does not walk
+ the unselected items in between; a full walk is only needed once after
+ items were added, removed or moved.
+
  Use this to walk the tree looking for all the selected items, e.g.
  \par
  \code
@@ -1385,27 +1437,25 @@ Fl_Tree_Item *Fl_Tree::next_item(Fl_Tree_Item *item, int dir, bool visible) {
  \version 1.3.3
 */
 Fl_Tree_Item *Fl_Tree::next_selected_item(Fl_Tree_Item *item, int dir) {
-  switch (dir) {
-    case FL_Down:
-      if ( ! item ) {
-        if ( ! (item = first()) ) return(0);
-        if ( item->is_selected() ) return(item);
-      }
-      while ( (item = item->next()) )
-        if ( item->is_selected() )
-          return(item);
-      return(0);
-    case FL_Up:
-      if ( ! item ) {
-        if ( ! (item = last()) ) return(0);
-        if ( item->is_selected() ) return(item);
-      }
-      while ( (item = item->prev()) )
-        if ( item->is_selected() )
-          return(item);
-      return(0);
+  if ( dir != FL_Down && dir != FL_Up ) return(0);
+  int total = _selection.total();
+  if ( total == 0 ) return(0);                  // nothing selected
+  sort_selection();                             // _selection now in tree order
+  int index;
+  if ( ! item ) {                               // NULL? start at first() or last()
+    index = (dir == FL_Up) ? total-1 : 0;
+  } else if ( item->is_selected() ) {           // selected? neighbor in index
+    index = item->_selindex + ((dir == FL_Up) ? -1 : 1);
+  } else {                                      // binary search item's position
+    int lo = 0, hi = total;
+    while ( lo < hi ) {
+      int mid = (lo + hi) / 2;
+      if ( _selection[mid]->_order < item->_order ) lo = mid + 1;
+      else hi = mid;
+    }
+    index = (dir == FL_Up) ? lo-1 : lo;
   }
-  return(0);
+  return((index >= 0 && index < total) ? _selection[index] : 0);
 }
 
 /**
@@ -1432,8 +1482,9 @@ Fl_Tree_Item *Fl_Tree::next_selected_item(Fl_Tree_Item *item, int dir) {
 */
 int Fl_Tree::get_selected_items(Fl_Tree_Item_Array &ret_items) {
   ret_items.clear();
-  for ( Fl_Tree_Item *i=first_selected_item(); i; i=next_selected_item(i) ) {
-    ret_items.add(i);
+  sort_selection();
+  for ( int t=0; t<_selection.total(); t++ ) {
+    ret_items.add(_selection[t]);
   }
   return ret_items.total();
 }
@@ -1816,13 +1867,21 @@ int Fl_Tree::deselect_all(Fl_Tree_Item *item, int docallback) {
   item = item ? item : first();                 // NULL? use first()
   if ( ! item ) return(0);
   int count = 0;
-  // Deselect item
-  if ( item->is_selected() )
-    if ( deselect(item, docallback) )
-      ++count;
-  // Deselect its children
-  for ( int t=0; t<item->children(); t++ ) {
-    count += deselect_all(item->child(t), docallback);  // recurse
+  // Visit only the selected items (in tree order), not the whole hierarchy.
+  //    Work on a copy; deselect() modifies the selection index.
+  //
+  Fl_Tree_Item_Array items;
+  get_selected_items(items);
+  for ( int t=0; t<items.total(); t++ ) {
+    Fl_Tree_Item *i = items[t];
+    if ( item != _root ) {                      // only 'item' and its children
+      Fl_Tree_Item *p = i;
+      while ( p && p != item ) p = p->parent();
+      if ( ! p ) continue;
+    }
+    if ( i->is_selected() )
+      if ( deselect(i, docallback) )
+        ++count;
   }
   return(count);
 }
@@ -1851,8 +1910,12 @@ int Fl_Tree::select_only(Fl_Tree_Item *selitem, int docallback) {
   int changed = 0;
   // Deselect everything first.
   //    Prevents callbacks from seeing more than one item selected.
+  //    Only the selected items are visited, not the whole tree.
   //
-  for ( Fl_Tree_Item *item = first(); item; item = item->next() ) {
+  Fl_Tree_Item_Array items;
+  get_selected_items(items);
+  for ( int t=0; t<items.total(); t++ ) {
+    Fl_Tree_Item *item = items[t];
     if ( item == selitem ) continue;            // don't do anything to selitem yet..
     if ( item->is_selected() ) {
       deselect(item, docallback);
@@ -2241,6 +2304,7 @@ int Fl_Tree::showroot() const {
 ///
 void Fl_Tree::showroot(int val) {
   _prefs.showroot(val);
+  _prefix_valid = 0;                            // root's type-ahead status changed
   redraw();
   recalc_tree();
 }
@@ -2689,3 +2753,464 @@ void Fl_Tree::fix_scrollbar_order() {
 void Fl_Tree::recalc_tree() {
   _tree_w = _tree_h = -1;
 }
+
+/// Create the children of an item whose children_unloaded() flag is set.
+///
+/// Called by Fl_Tree_Item::load_children() when such an item is opened,
+/// or right after an open item with unloaded children scrolled into view.
+/// The default implementation invokes the populate_callback(), if any.
+/// Subclasses can override this to create children from their own model,
+/// typically with add(Fl_Tree_Item*,const char*).
+///
+/// \param[in] item The item whose children should be created.
+/// \see populate_callback(), Fl_Tree_Item::children_unloaded()
+///
+void Fl_Tree::populate(Fl_Tree_Item *item) {
+  if ( _populate_cb ) _populate_cb(item, _populate_data);
+}
+
+/// Set the callback that creates the children of unloaded items (virtual tree).
+///
+/// \param[in] cb   The callback, or 0 for none.
+/// \param[in] data Optional user data passed to the callback.
+/// \see populate(), Fl_Tree_Item::children_unloaded()
+///
+void Fl_Tree::populate_callback(Fl_Tree_Populate_Callback *cb, void *data) {
+  _populate_cb   = cb;
+  _populate_data = data;
+}
+
+/// Get the callback that creates the children of unloaded items, or 0 if none.
+Fl_Tree_Populate_Callback* Fl_Tree::populate_callback() const {
+  return(_populate_cb);
+}
+
+/// Get the user data passed to the populate_callback().
+void* Fl_Tree::populate_user_data() const {
+  return(_populate_data);
+}
+
+/// Get the maximum number of populated items kept loaded.
+/// \see unload_budget(int)
+///
+int Fl_Tree::unload_budget() const {
+  return(_unload_budget);
+}
+
+/// Set the maximum number of items created by populate() that are kept loaded.
+///
+/// When more items are loaded, the children of closed populated items are
+/// unloaded again (oldest closed first) until the tree is back within budget.
+/// After opening, closing or loading items this happens from a timeout, so
+/// items the program is working with aren't deleted under it.
+/// Open items are never unloaded, so the budget can be exceeded by what
+/// the user currently has expanded.
+///
+/// \param[in] nitems Number of items, or 0 to never unload (default).
+/// \see loaded_items(), Fl_Tree_Item::unload_children()
+///
+void Fl_Tree::unload_budget(int nitems) {
+  _unload_budget = nitems < 0 ? 0 : nitems;
+  enforce_unload_budget();
+}
+
+/// Get the number of items currently loaded by populate().
+int Fl_Tree::loaded_items() const {
+  return(_loaded_items);
+}
+
+// INTERNAL: Unload closed populated items, oldest first, until within unload_budget()
+void Fl_Tree::enforce_unload_budget() {
+  if ( _unload_budget <= 0 ) return;
+  int unloaded = 0;
+  while ( _loaded_items > _unload_budget && _unload_queue.total() > 0 ) {
+    unloaded += _unload_queue[0]->unload_children();    // removes itself from queue
+  }
+  if ( unloaded ) redraw();
+}
+
+// INTERNAL: Load the children of an open unloaded 'item' that draw() found
+//    in view. Drawing must not change the tree, so this is done from a timeout.
+//
+void Fl_Tree::populate_later(Fl_Tree_Item *item) {
+  if ( item->is_flag(Fl_Tree_Item::POPULATE_QUEUED) ) return;
+  item->_flags |= Fl_Tree_Item::POPULATE_QUEUED;
+  _populate_queue.add(item);
+  unload_later();                               // same timeout
+}
+
+// INTERNAL: Enforce unload_budget() from a timeout.
+//    Items opened, closed or loaded may be descendents of the oldest
+//    closed items, so unloading right away could delete them under the
+//    caller (e.g. open("A/B") with "A" closed).
+//
+void Fl_Tree::unload_later() {
+  if ( !Fl::has_timeout(populate_timeout_cb, (void*)this) )
+    Fl::add_timeout(0.0, populate_timeout_cb, (void*)this);
+}
+
+// INTERNAL: Load the items queued by populate_later(), then unload
+//    closed items beyond unload_budget().
+//
+void Fl_Tree::populate_timeout_cb(void *data) {
+  Fl_Tree *tree = (Fl_Tree*)data;
+  while ( tree->_populate_queue.total() > 0 ) {
+    Fl_Tree_Item *item = tree->_populate_queue[0];
+    tree->_populate_queue.remove(0);
+    item->_flags &= ~Fl_Tree_Item::POPULATE_QUEUED;
+    if ( item->is_open() ) item->load_children();
+  }
+  tree->enforce_unload_budget();                // nothing is in use by a caller here
+  tree->redraw();
+}
+
+// INTERNAL: Add newly selected 'item' to the selection index.
+//    Called by Fl_Tree_Item::set_flag() via update_selection().
+//
+void Fl_Tree::selection_add(Fl_Tree_Item *item) {
+  int total = _selection.total();
+  int index = item->_selindex;
+  if ( index >= 0 && index < total && _selection[index] == item ) return;  // already in
+  // Appending in tree order (e.g. select_all()) keeps the index sorted,
+  //    which can only be told while the items' numbers are current
+  if ( total && (!_order_valid || _selection[total-1]->_order > item->_order) )
+    _selection_sorted = 0;
+  item->_selindex = total;
+  _selection.add(item);
+}
+
+// INTERNAL: Remove deselected (or destroyed) 'item' from the selection index.
+//    O(1): the last entry is moved into the vacated slot.
+//
+void Fl_Tree::selection_remove(Fl_Tree_Item *item) {
+  int index = item->_selindex;
+  int last  = _selection.total() - 1;
+  if ( index < 0 || index > last || _selection[index] != item ) return;
+  if ( index != last ) {
+    Fl_Tree_Item *moved = _selection[last];
+    _selection.replace(index, moved);
+    moved->_selindex = index;
+    _selection_sorted = 0;
+  }
+  _selection.remove(last);
+  item->_selindex = -1;
+}
+
+// INTERNAL: qsort() element for sort_selection()
+struct Fl_Tree_Selection_Order {
+  int order;
+  Fl_Tree_Item *item;
+};
+
+// INTERNAL: qsort() compare for sort_selection(), by tree order
+static int compare_selection_order(const void *a, const void *b) {
+  return(((const Fl_Tree_Selection_Order*)a)->order -
+         ((const Fl_Tree_Selection_Order*)b)->order);
+}
+
+// INTERNAL: Make sure the selection index is sorted in tree order.
+//
+//    Items are numbered with a single walk of the tree only after the
+//    tree's structure changed (see Fl_Tree_Item::update_prev_next()),
+//    so repeated selection queries cost O(selected), not O(tree).
+//
+void Fl_Tree::sort_selection() {
+  renumber_items();
+  if ( _selection_sorted ) return;
+  int total = _selection.total();
+  Fl_Tree_Selection_Order *arr =
+    (Fl_Tree_Selection_Order*)malloc(sizeof(Fl_Tree_Selection_Order) * (total ? total : 1));
+  int t;
+  for ( t=0; t<total; t++ ) {
+    arr[t].order = _selection[t]->_order;
+    arr[t].item  = _selection[t];
+  }
+  qsort(arr, total, sizeof(Fl_Tree_Selection_Order), compare_selection_order);
+  for ( t=0; t<total; t++ ) {
+    _selection.replace(t, arr[t].item);
+    arr[t].item->_selindex = t;
+  }
+  free((void*)arr);
+  _selection_sorted = 1;
+}
+
+/// Enable or disable storing item labels in a tree-wide string arena.
+///
+/// Normally each item's label is a separate allocation. With the arena
+/// enabled, labels set afterwards are packed into large blocks owned by
+/// the tree, which saves the per-allocation overhead in trees with very
+/// many items. Arena memory is only released by clear() (or when the tree
+/// is destroyed); relabeling or removing items does not give it back,
+/// so it suits trees that are built once rather than ones that keep
+/// loading and unloading children (see unload_budget()).
+///
+/// \note Items must not outlive their tree's clear() with an arena label,
+/// e.g. items deparent()ed from the tree and kept elsewhere.
+///
+/// \param[in] val 1 to enable, 0 to disable (default).
+/// \see Fl_Tree_Item::label(const char*)
+///
+void Fl_Tree::label_arena(int val) {
+  _label_arena = val ? 1 : 0;
+}
+
+/// Returns 1 if item labels are stored in the tree's label arena.
+/// \see label_arena(int)
+///
+int Fl_Tree::label_arena() const {
+  return(_label_arena);
+}
+
+// INTERNAL: Copy string 's' into the label arena
+const char *Fl_Tree::arena_strdup(const char *s) {
+  const int blocksize = 64 * 1024;
+  int len = (int)strlen(s) + 1;
+  char *dst;
+  if ( len > blocksize / 4 ) {                  // long label? give it its own block..
+    dst = (char*)malloc(len);
+    _arena_blocks = (char**)realloc((void*)_arena_blocks, sizeof(char*) * (_arena_nblocks+1));
+    if ( _arena_nblocks > 0 ) {                 // ..keeping the partly used block last
+      _arena_blocks[_arena_nblocks] = _arena_blocks[_arena_nblocks-1];
+      _arena_blocks[_arena_nblocks-1] = dst;
+    } else {
+      _arena_blocks[0] = dst;
+      _arena_left = 0;
+    }
+    _arena_nblocks++;
+  } else {
+    if ( len > _arena_left ) {                  // start a new block
+      _arena_blocks = (char**)realloc((void*)_arena_blocks, sizeof(char*) * (_arena_nblocks+1));
+      _arena_blocks[_arena_nblocks++] = (char*)malloc(blocksize);
+      _arena_left = blocksize;
+    }
+    dst = _arena_blocks[_arena_nblocks-1] + (blocksize - _arena_left);
+    _arena_left -= len;
+  }
+  memcpy(dst, s, len);
+  return(dst);
+}
+
+// INTERNAL: Release all label arena blocks
+void Fl_Tree::arena_free() {
+  for ( int t=0; t<_arena_nblocks; t++ )
+    free((void*)_arena_blocks[t]);
+  free((void*)_arena_blocks);
+  _arena_blocks  = 0;
+  _arena_nblocks = 0;
+  _arena_left    = 0;
+}
+
+// INTERNAL: Number all items in tree order (see Fl_Tree_Item::_order).
+//    Only walks the tree if its structure changed since the last call.
+//
+void Fl_Tree::renumber_items() {
+  if ( _order_valid ) return;
+  int n = 0;
+  for ( Fl_Tree_Item *i = _root; i; i = i->next() )
+    i->_order = n++;
+  _order_valid = 1;
+  _selection_sorted = 0;                        // sorted by old numbers
+}
+
+// INTERNAL: qsort() element for build_prefix_index()
+struct Fl_Tree_Prefix_Slot {
+  const char   *label;
+  int           order;
+  Fl_Tree_Item *item;
+};
+
+// INTERNAL: qsort() compare for build_prefix_index(): by label, then tree order
+static int compare_prefix_slot(const void *a, const void *b) {
+  const Fl_Tree_Prefix_Slot *sa = (const Fl_Tree_Prefix_Slot*)a;
+  const Fl_Tree_Prefix_Slot *sb = (const Fl_Tree_Prefix_Slot*)b;
+  int cmp = fl_utf_strcasecmp(sa->label, sb->label);
+  return(cmp ? cmp : sa->order - sb->order);
+}
+
+// INTERNAL: Of label index slots 'a' and 'b', pick the one whose item
+//    comes first in the tree (-1: none)
+//
+int Fl_Tree::prefix_first(int a, int b) const {
+  if ( a < 0 ) return(b);
+  if ( b < 0 ) return(a);
+  return(_prefix_items[a]->_order <= _prefix_items[b]->_order ? a : b);
+}
+
+// INTERNAL: Build the label index used by find_prefix().
+//
+//    All items are sorted by label (case insensitive) so a prefix match is
+//    a contiguous range found by binary search. On top of that a segment
+//    tree gives, for any range, the displayed item that comes first in the
+//    tree, so a lookup is O(log n). Opening or closing items only updates
+//    the segment tree for the items that appear or disappear.
+//
+void Fl_Tree::build_prefix_index() {
+  renumber_items();
+  int n = 0;
+  Fl_Tree_Item *i;
+  for ( i = _root; i; i = i->next() ) ++n;
+  free((void*)_prefix_items);
+  free((void*)_prefix_min);
+  _prefix_total = n;
+  _prefix_items = (Fl_Tree_Item**)malloc(sizeof(Fl_Tree_Item*) * (n ? n : 1));
+  _prefix_min   = (int*)malloc(sizeof(int) * (n ? 2*n : 1));
+  Fl_Tree_Prefix_Slot *arr = (Fl_Tree_Prefix_Slot*)malloc(sizeof(Fl_Tree_Prefix_Slot) * (n ? n : 1));
+  int t = 0;
+  for ( i = _root; i; i = i->next(), t++ ) {
+    arr[t].label = i->label() ? i->label() : "";
+    arr[t].order = i->_order;
+    arr[t].item  = i;
+  }
+  qsort(arr, n, sizeof(Fl_Tree_Prefix_Slot), compare_prefix_slot);
+  for ( t=0; t<n; t++ ) {
+    _prefix_items[t] = arr[t].item;
+    arr[t].item->_prefixslot = t;
+  }
+  free((void*)arr);
+  _prefix_valid = 1;
+  if ( n == 0 ) return;
+  // Leaves: which items are displayed. Then fill in the inner nodes.
+  for ( t=0; t<n; t++ ) _prefix_min[n+t] = -1;
+  prefix_index_set(_root, _root->is_visible() && _prefs.showroot(), 0);
+  prefix_index_walk(_root, _root->is_visible() && _root->is_open(), 0);
+  for ( t=n-1; t>0; t-- )
+    _prefix_min[t] = prefix_first(_prefix_min[2*t], _prefix_min[2*t+1]);
+}
+
+// INTERNAL: Set whether 'item' is displayed in the label index.
+void Fl_Tree::prefix_index_set(Fl_Tree_Item *item, int displayed, int propagate) {
+  int t = item->_prefixslot + _prefix_total;
+  _prefix_min[t] = displayed ? item->_prefixslot : -1;
+  if ( !propagate ) return;
+  for ( t /= 2; t > 0; t /= 2 )
+    _prefix_min[t] = prefix_first(_prefix_min[2*t], _prefix_min[2*t+1]);
+}
+
+// INTERNAL: Update the label index for the children of 'item', given whether
+//    'item' shows its children. Closed children's descendants are hidden
+//    either way, so only open branches are walked.
+//
+void Fl_Tree::prefix_index_walk(Fl_Tree_Item *item, int shown, int propagate) {
+  for ( int t=0; t<item->children(); t++ ) {
+    Fl_Tree_Item *c = item->child(t);
+    int cshown = shown && c->is_visible();
+    prefix_index_set(c, cshown, propagate);
+    if ( c->is_open() )
+      prefix_index_walk(c, cshown, propagate);
+  }
+}
+
+// INTERNAL: 'item' was opened/closed or shown/hidden: update the label index
+void Fl_Tree::prefix_index_display(Fl_Tree_Item *item) {
+  if ( !_prefix_valid || item->_prefixslot < 0 ) return;      // rebuilt on next use
+  int shown = 1;                                // do item's parents show it?
+  for ( Fl_Tree_Item *p = item->parent(); p; p = p->parent() )
+    if ( !p->is_open() || !p->is_visible() ) { shown = 0; break; }
+  prefix_index_set(item, shown && item->is_visible() &&
+                         (item != _root || _prefs.showroot()));
+  prefix_index_walk(item, shown && item->is_visible() && item->is_open());
+}
+
+/// Find the first displayed item whose label starts with \p 'prefix'.
+///
+/// 'Displayed' items are those whose parents are all open,
+/// i.e. the items a user can scroll to. Matching is case insensitive,
+/// and 'first' means closest to the top of the tree.
+///
+/// Uses a label index that is built on first use and rebuilt after items
+/// are added, removed, moved or relabeled; opening and closing items
+/// keeps it current. Lookups are O(log n), so this is suitable for
+/// searching on each keystroke (see typeahead()).
+///
+/// \param[in] prefix The text the label must start with.
+/// \returns The item found, or 0 if none (or \p 'prefix' is empty).
+/// \see typeahead(int)
+///
+Fl_Tree_Item *Fl_Tree::find_prefix(const char *prefix) {
+  if ( !prefix || !*prefix || !_root ) return(0);
+  if ( !_prefix_valid ) build_prefix_index();
+  int nchars = fl_utf_nb_char((const unsigned char*)prefix, (int)strlen(prefix));
+  // Binary search for the range of labels starting with prefix
+  int lo = 0, hi = _prefix_total;
+  while ( lo < hi ) {                           // first label >= prefix
+    int mid = (lo + hi) / 2;
+    const char *l = _prefix_items[mid]->label() ? _prefix_items[mid]->label() : "";
+    if ( fl_utf_strncasecmp(l, prefix, nchars) < 0 ) lo = mid + 1; else hi = mid;
+  }
+  int end = lo;
+  hi = _prefix_total;
+  while ( end < hi ) {                          // first label past prefix
+    int mid = (end + hi) / 2;
+    const char *l = _prefix_items[mid]->label() ? _prefix_items[mid]->label() : "";
+    if ( fl_utf_strncasecmp(l, prefix, nchars) <= 0 ) end = mid + 1; else hi = mid;
+  }
+  // Segment tree query: displayed slot in [lo,end) that comes first in the tree
+  int best = -1;
+  for ( int l = lo + _prefix_total, r = end + _prefix_total; l < r; l /= 2, r /= 2 ) {
+    if ( l & 1 ) best = prefix_first(best, _prefix_min[l++]);
+    if ( r & 1 ) best = prefix_first(best, _prefix_min[--r]);
+  }
+  return(best < 0 ? 0 : _prefix_items[best]);
+}
+
+/// Enable or disable type-ahead navigation.
+///
+/// When enabled and the tree has keyboard focus, typing text
+/// moves the focus to the first displayed item whose label starts with
+/// what was typed (see find_prefix()), scrolling it into view.
+/// Keys typed within a second of each other accumulate; after a pause,
+/// or when nothing matches, the search starts over with the last key.
+/// Keys that match nothing are passed on, e.g. to shortcuts.
+///
+/// Disabled by default, so keys reach shortcuts and the tree's callback
+/// as before; apps opt in with typeahead(1).
+///
+/// \param[in] val 1 to enable, 0 to disable.
+///
+void Fl_Tree::typeahead(int val) {
+  _typeahead_on = val ? 1 : 0;
+  _typeahead_len = 0;
+  _typeahead[0] = 0;
+}
+
+/// Returns 1 if type-ahead navigation is enabled.
+/// \see typeahead(int)
+///
+int Fl_Tree::typeahead() const {
+  return(_typeahead_on);
+}
+
+// INTERNAL: Type-ahead pause: start the next search over
+void Fl_Tree::typeahead_timeout_cb(void *data) {
+  Fl_Tree *tree = (Fl_Tree*)data;
+  tree->_typeahead_len = 0;
+  tree->_typeahead[0] = 0;
+}
+
+// INTERNAL: Handle a typed key for type-ahead navigation.
+//    Returns 1 if an item matched (and got the focus), 0 if not.
+//
+int Fl_Tree::typeahead_key(const char *text, int len) {
+  Fl::remove_timeout(typeahead_timeout_cb, (void*)this);
+  if ( len >= (int)sizeof(_typeahead) ) return(0);
+  if ( _typeahead_len + len >= (int)sizeof(_typeahead) ) _typeahead_len = 0;
+  memcpy(_typeahead + _typeahead_len, text, len);
+  _typeahead_len += len;
+  _typeahead[_typeahead_len] = 0;
+  Fl_Tree_Item *item = find_prefix(_typeahead);
+  if ( !item && _typeahead_len > len ) {        // no match? start over with this key
+    memcpy(_typeahead, text, len);
+    _typeahead_len = len;
+    _typeahead[len] = 0;
+    item = find_prefix(_typeahead);
+  }
+  if ( !item ) {
+    _typeahead_len = 0;
+    _typeahead[0] = 0;
+    return(0);
+  }
+  Fl::add_timeout(1.0, typeahead_timeout_cb, (void*)this);
+  set_item_focus(item);
+  show_item(item);
+  return(1);
+}
@@ -35,6 +35,244 @@ static int event_inside(const int xywh[4]) {
   return(Fl::event_inside(xywh[0],xywh[1],xywh[2],xywh[3]));
 }
 
+// INTERNAL: Shared (flyweight) item styling.
+//
+//    Almost all items of a tree are styled alike, so instead of each
+//    item carrying its own font, size, colors and icons, items refer to
+//    an interned style record by index. Records are never modified:
+//    changing e.g. an item's labelfont() interns a modified copy and
+//    repoints only that item (copy-on-write). Records are refcounted by
+//    the items using them; unused records are recycled (and forget their
+//    icons, which the app may have deleted by now), and the whole table
+//    is freed when the last item is destroyed, e.g. with the last tree.
+//
+struct Fl_Tree_Item_Style {
+  Fl_Font     labelfont;        // label's font face
+  Fl_Fontsize labelsize;        // label's font size
+  Fl_Color    labelfgcolor;     // label's fg color
+  Fl_Color    labelbgcolor;     // label's bg color (0xffffffff is 'transparent')
+  Fl_Image   *usericon;         // item's user-specific icon (optional)
+  Fl_Image   *userdeicon;       // deactivated usericon
+  unsigned int refs;            // #items using this record (0=free)
+  unsigned int nextfree;        // free: next free record index+1 (0=end)
+};
+
+static Fl_Tree_Item_Style *style_recs  = 0;     // interned records
+static unsigned int        style_total = 0;     // #records used so far (incl. free ones)
+static unsigned int        style_alloc = 0;     // #records allocated
+static unsigned int        style_live  = 0;     // #records in use (refs > 0)
+static unsigned int        style_free  = 0;     // free record list: index+1, 0=empty
+static unsigned int       *style_hash  = 0;     // open addressing: record index+1, 0=empty
+static unsigned int        style_hsize = 0;     // #hash slots (power of 2)
+static unsigned int        style_last  = 0;     // last interned record (fast path)
+
+static int style_equal(const Fl_Tree_Item_Style &a, const Fl_Tree_Item_Style &b) {
+  return(a.labelfont    == b.labelfont    &&
+         a.labelsize    == b.labelsize    &&
+         a.labelfgcolor == b.labelfgcolor &&
+         a.labelbgcolor == b.labelbgcolor &&
+         a.usericon     == b.usericon     &&
+         a.userdeicon   == b.userdeicon);
+}
+
+static unsigned int style_hashval(const Fl_Tree_Item_Style &s) {
+  unsigned int h = (unsigned int)s.labelfont;
+  h = h * 31 + (unsigned int)s.labelsize;
+  h = h * 31 + (unsigned int)s.labelfgcolor;
+  h = h * 31 + (unsigned int)s.labelbgcolor;
+  h = h * 31 + (unsigned int)((size_t)s.usericon >> 4);
+  h = h * 31 + (unsigned int)((size_t)s.userdeicon >> 4);
+  return(h ^ (h >> 16));
+}
+
+// INTERNAL: Return the index of the record equal to 's', adding it if new.
+//    The caller holds a reference to the record; see style_release().
+//
+static unsigned int style_intern(const Fl_Tree_Item_Style &s) {
+  if ( style_last < style_total && style_recs[style_last].refs &&
+       style_equal(style_recs[style_last], s) ) {
+    style_recs[style_last].refs++;
+    return(style_last);
+  }
+  unsigned int h;
+  if ( style_hsize ) {
+    for ( h = style_hashval(s) & (style_hsize-1); style_hash[h]; h = (h+1) & (style_hsize-1) ) {
+      if ( style_equal(style_recs[style_hash[h]-1], s) ) {
+        style_last = style_hash[h]-1;
+        style_recs[style_last].refs++;
+        return(style_last);
+      }
+    }
+  }
+  // Not found: reuse a free record, or add one
+  unsigned int idx;
+  if ( style_free ) {
+    idx = style_free - 1;
+    style_free = style_recs[idx].nextfree;
+  } else {
+    if ( style_total >= style_alloc ) {
+      style_alloc = style_alloc ? style_alloc * 2 : 16;
+      style_recs = (Fl_Tree_Item_Style*)realloc((void*)style_recs,
+                                                style_alloc * sizeof(Fl_Tree_Item_Style));
+    }
+    idx = style_total++;
+  }
+  style_recs[idx] = s;
+  style_recs[idx].refs = 1;
+  style_recs[idx].nextfree = 0;
+  style_live++;
+  // Grow the hash table to stay under half full
+  if ( style_live * 2 > style_hsize ) {
+    free((void*)style_hash);
+    style_hsize = style_hsize ? style_hsize * 2 : 64;
+    style_hash  = (unsigned int*)calloc(style_hsize, sizeof(unsigned int));
+    for ( unsigned int t=0; t<style_total; t++ ) {
+      if ( !style_recs[t].refs || t == idx ) continue;
+      for ( h = style_hashval(style_recs[t]) & (style_hsize-1); style_hash[h]; h = (h+1) & (style_hsize-1) ) { }
+      style_hash[h] = t+1;
+    }
+  }
+  for ( h = style_hashval(s) & (style_hsize-1); style_hash[h]; h = (h+1) & (style_hsize-1) ) { }
+  style_hash[h] = idx+1;
+  return(style_last = idx);
+}
+
+// INTERNAL: Drop a reference to record 'idx'.
+//    When no item uses it anymore, the record leaves the hash table
+//    (backward-shift deletion keeps the probe chains intact) and goes
+//    on the free list. When no record is in use at all, the table is freed.
+//
+static void style_release(unsigned int idx) {
+  Fl_Tree_Item_Style &s = style_recs[idx];
+  if ( --s.refs ) return;
+  unsigned int mask = style_hsize - 1;
+  unsigned int h = style_hashval(s) & mask;
+  while ( style_hash[h] != idx+1 ) h = (h+1) & mask;
+  for ( unsigned int j = (h+1) & mask; style_hash[j]; j = (j+1) & mask ) {
+    unsigned int k = style_hashval(style_recs[style_hash[j]-1]) & mask;  // j's home slot
+    if ( h <= j ? (h < k && k <= j) : (h < k || k <= j) ) continue;    // can't move before home
+    style_hash[h] = style_hash[j];
+    h = j;
+  }
+  style_hash[h] = 0;
+  s.usericon = s.userdeicon = 0;                // don't keep pointers to the app's images
+  s.nextfree = style_free;
+  style_free = idx+1;
+  if ( --style_live == 0 ) {                    // last item is gone: free the table
+    free((void*)style_recs); style_recs = 0;
+    free((void*)style_hash); style_hash = 0;
+    style_total = style_alloc = style_hsize = 0;
+    style_free = style_last = 0;
+  }
+}
+
+// INTERNAL: Repoint 'idx' to the record equal to 's', releasing the old one.
+static void style_change(unsigned int &idx, const Fl_Tree_Item_Style &s) {
+  unsigned int old = idx;
+  idx = style_intern(s);                        // first: may be the same record
+  style_release(old);
+}
+
+// INTERNAL: Slab allocator for the items of one Fl_Tree.
+//
+//    Items are carved out of slabs that double in size, and deleted items
+//    go on a free list for reuse, so building a big tree doesn't call
+//    malloc() per item. Each allocation is preceded by a header pointing
+//    to its pool (0 for plain heap allocations) so operator delete knows
+//    where the memory goes back to. Once no pooled item is alive (e.g.
+//    after Fl_Tree::clear()), all slabs are released at once.
+//
+struct Fl_Tree_Item_Pool {
+  char  **slabs;                // slab memory
+  int     nslabs;               // #slabs
+  void   *freelist;             // free chunks, linked through their first word
+  int     live;                 // #items currently allocated from pool
+  char    orphaned;             // tree is gone: free pool when last item is deleted
+};
+
+// INTERNAL: Allocation header; union keeps the item after it aligned
+union Fl_Tree_Item_Header {
+  Fl_Tree_Item_Pool *pool;      // owning pool, or 0 if allocated from heap
+  double             align;
+};
+
+static void pool_destroy(Fl_Tree_Item_Pool *pool) {
+  for ( int t=0; t<pool->nslabs; t++ )
+    ::operator delete((void*)pool->slabs[t]);
+  free((void*)pool->slabs);
+  free((void*)pool);
+}
+
+/// Allocate an item from the heap.
+void *Fl_Tree_Item::operator new(size_t size) {
+  Fl_Tree_Item_Header *h = (Fl_Tree_Item_Header*)::operator new(sizeof(Fl_Tree_Item_Header) + size);
+  h->pool = 0;
+  return((void*)(h+1));
+}
+
+/// Allocate an item from \p 'tree's item pool, e.g.
+/// \code
+///     Fl_Tree_Item *item = new(tree) Fl_Tree_Item(tree);
+/// \endcode
+/// This is how the tree creates its own items. Only plain Fl_Tree_Item's
+/// are pooled; derived classes of a different size come from the heap.
+///
+void *Fl_Tree_Item::operator new(size_t size, Fl_Tree *tree) {
+  if ( !tree || size != sizeof(Fl_Tree_Item) )
+    return(operator new(size));
+  // Chunk size: header + item, rounded up to keep alignment
+  const size_t hsize = sizeof(Fl_Tree_Item_Header);
+  const size_t csize = (hsize + size + hsize - 1) / hsize * hsize;
+  Fl_Tree_Item_Pool *&pool = tree->_item_pool;
+  if ( !pool )
+    pool = (Fl_Tree_Item_Pool*)calloc(1, sizeof(Fl_Tree_Item_Pool));
+  if ( !pool->freelist ) {                      // out of chunks? add a slab
+    int nchunks = 64 << (pool->nslabs < 10 ? pool->nslabs : 10);
+    char *slab = (char*)::operator new(csize * nchunks);
+    pool->slabs = (char**)realloc((void*)pool->slabs, sizeof(char*) * (pool->nslabs+1));
+    pool->slabs[pool->nslabs++] = slab;
+    for ( int t=nchunks-1; t>=0; t-- ) {        // chain chunks in address order
+      void *chunk = (void*)(slab + t * csize);
+      *(void**)chunk = pool->freelist;
+      pool->freelist = chunk;
+    }
+  }
+  Fl_Tree_Item_Header *h = (Fl_Tree_Item_Header*)pool->freelist;
+  pool->freelist = *(void**)pool->freelist;
+  h->pool = pool;
+  pool->live++;
+  return((void*)(h+1));
+}
+
+/// Return an item's memory to its tree's item pool, or to the heap.
+void Fl_Tree_Item::operator delete(void *p) {
+  if ( !p ) return;
+  Fl_Tree_Item_Header *h = ((Fl_Tree_Item_Header*)p) - 1;
+  Fl_Tree_Item_Pool *pool = h->pool;
+  if ( !pool ) { ::operator delete((void*)h); return; }
+  *(void**)h = pool->freelist;
+  pool->freelist = (void*)h;
+  if ( --pool->live == 0 && pool->orphaned )    // last item of a destroyed tree?
+    pool_destroy(pool);
+}
+
+/// Placement delete matching operator new(size_t, Fl_Tree*).
+void Fl_Tree_Item::operator delete(void *p, Fl_Tree *) {
+  operator delete(p);
+}
+
+// INTERNAL: Release the tree's item pool if no pooled items are alive.
+//    If items are still alive (e.g. deparent()ed and kept) and the tree is
+//    going away, the pool frees itself when the last of them is deleted.
+//
+void Fl_Tree_Item::release_pool(Fl_Tree_Item_Pool *&pool, int tree_gone) {
+  if ( !pool ) return;
+  if ( pool->live == 0 ) pool_destroy(pool);
+  else if ( tree_gone ) pool->orphaned = 1;
+  else return;                                  // keep using it
+  pool = 0;
+}
+
 /// Constructor.
 /// Makes a new instance of Fl_Tree_Item using defaults from \p 'prefs'.
 /// \deprecated in 1.3.3 ABI -- you must use Fl_Tree_Item(Fl_Tree*) for proper horizontal scrollbar behavior.
@@ -49,10 +287,14 @@ Fl_Tree_Item::Fl_Tree_Item(const Fl_Tree_Prefs &prefs) {
 void Fl_Tree_Item::_Init(const Fl_Tree_Prefs &prefs, Fl_Tree *tree) {
   _tree         = tree;
   _label        = 0;
-  _labelfont    = prefs.labelfont();
-  _labelsize    = prefs.labelsize();
-  _labelfgcolor = prefs.labelfgcolor();
-  _labelbgcolor = prefs.labelbgcolor();
+  Fl_Tree_Item_Style style;
+  style.labelfont    = prefs.labelfont();
+  style.labelsize    = prefs.labelsize();
+  style.labelfgcolor = prefs.labelfgcolor();
+  style.labelbgcolor = prefs.labelbgcolor();
+  style.usericon     = 0;
+  style.userdeicon   = 0;
+  _style        = style_intern(style);
   _widget       = 0;
   _flags        = OPEN|VISIBLE|ACTIVE;
   _xywh[0]      = 0;
@@ -67,13 +309,14 @@ void Fl_Tree_Item::_Init(const Fl_Tree_Prefs &prefs, Fl_Tree *tree) {
   _label_xywh[1]    = 0;
   _label_xywh[2]    = 0;
   _label_xywh[3]    = 0;
-  _usericon         = 0;
-  _userdeicon       = 0;
   _userdata         = 0;
   _parent           = 0;
   _children.manage_item_destroy(1);     // let array's dtor manage destroying Fl_Tree_Items
   _prev_sibling     = 0;
   _next_sibling     = 0;
+  _selindex         = -1;
+  _order            = 0;
+  _prefixslot       = -1;
 }
 
 /// Constructor.
@@ -91,15 +334,32 @@ Fl_Tree_Item::Fl_Tree_Item(Fl_Tree *tree) {
 // DTOR
 Fl_Tree_Item::~Fl_Tree_Item() {
   if ( _label ) {
-    free((void*)_label);
+    if ( !is_flag(LABEL_IN_ARENA) )             // arena labels are freed by the tree
+      free((void*)_label);
     _label = 0;
   }
   _widget = 0;                  // Fl_Group will handle destruction
-  _usericon = 0;                // user handled allocation
-  _userdeicon = 0;              // user handled allocation
   // focus item? set to null
   if ( _tree && this == _tree->_item_focus )
     { _tree->_item_focus = 0; }
+  if ( _tree && this == _tree->_lastselect )
+    { _tree->_lastselect = 0; }
+  // waiting to be unloaded? leave the queue
+  if ( _tree && is_flag(UNLOAD_QUEUED) )
+    { _tree->_unload_queue.remove(this); }
+  // waiting to be loaded? leave that queue too
+  if ( _tree && is_flag(POPULATE_QUEUED) )
+    { _tree->_populate_queue.remove(this); }
+  // created by populate()? no longer loaded
+  if ( _tree && is_flag(LOADED) && _tree->_loaded_items > 0 )
+    { _tree->_loaded_items--; }
+  // selected? leave the tree's selection index
+  if ( is_selected() )
+    { update_selection(0); }
+  // tree's label index may point to us: rebuild it
+  if ( _tree )
+    { _tree->_prefix_valid = 0; }
+  style_release(_style);
   //_children.clear();          // array's destructor handles itself
 }
 
@@ -107,12 +367,11 @@ Fl_Tree_Item::~Fl_Tree_Item() {
 Fl_Tree_Item::Fl_Tree_Item(const Fl_Tree_Item *o) {
   _tree             = o->_tree;
   _label        = o->label() ? fl_strdup(o->label()) : 0;
-  _labelfont    = o->labelfont();
-  _labelsize    = o->labelsize();
-  _labelfgcolor = o->labelfgcolor();
-  _labelbgcolor = o->labelbgcolor();
+  _style        = o->_style;                      // shares o's style record
+  style_recs[_style].refs++;
   _widget       = o->widget();
-  _flags        = o->_flags;
+  // Not queued, not counted as loaded (has no children), own copy of label
+  _flags        = o->_flags & ~(UNLOAD_QUEUED|LABEL_IN_ARENA|LOADED|POPULATE_QUEUED|POPULATED);
   _xywh[0]      = o->_xywh[0];
   _xywh[1]      = o->_xywh[1];
   _xywh[2]      = o->_xywh[2];
@@ -125,11 +384,14 @@ Fl_Tree_Item::Fl_Tree_Item(const Fl_Tree_Item *o) {
   _label_xywh[1]    = o->_label_xywh[1];
   _label_xywh[2]    = o->_label_xywh[2];
   _label_xywh[3]    = o->_label_xywh[3];
-  _usericon         = o->usericon();
   _userdata         = o->user_data();
   _parent           = o->_parent;
   _prev_sibling     = 0;                // do not copy ptrs! use update_prev_next()
   _next_sibling     = 0;                // do not copy ptrs! use update_prev_next()
+  _selindex         = -1;
+  _order            = o->_order;
+  _prefixslot       = -1;
+  // A selected copy joins the tree's selection index once it is parented
 }
 
 /// Print the tree as 'ascii art' to stdout.
@@ -155,9 +417,24 @@ void Fl_Tree_Item::show_self(const char *indent) const {
 /// Set the label to \p 'name'.
 /// Makes and manages an internal copy of \p 'name'.
 ///
+/// If the tree's label_arena() is enabled, the copy is made in the tree's
+/// label arena instead of with its own allocation.
+///
+/// \see Fl_Tree::label_arena(int)
+///
 void Fl_Tree_Item::label(const char *name) {
-  if ( _label ) { free((void*)_label); _label = 0; }
-  _label = name ? fl_strdup(name) : 0;
+  if ( _label && !is_flag(LABEL_IN_ARENA) ) free((void*)_label);
+  _label = 0;
+  _flags &= ~LABEL_IN_ARENA;
+  if ( name ) {
+    if ( _tree && _tree->label_arena() ) {
+      _label = _tree->arena_strdup(name);
+      _flags |= LABEL_IN_ARENA;
+    } else {
+      _label = fl_strdup(name);
+    }
+  }
+  if ( _tree ) _tree->_prefix_valid = 0;     // label index needs re-sorting
   recalc_tree();                // may change label geometry
 }
 
@@ -166,6 +443,123 @@ const char *Fl_Tree_Item::label() const {
   return(_label);
 }
 
+/// Set item's label font face.
+///
+/// Styling is stored in records shared with other items styled alike;
+/// this gives the item its own record only if no item uses this style yet.
+///
+void Fl_Tree_Item::labelfont(Fl_Font val) {
+  Fl_Tree_Item_Style style = style_recs[_style];
+  style.labelfont = val;
+  style_change(_style, style);
+  recalc_tree();              // may change tree geometry
+}
+
+/// Get item's label font face.
+Fl_Font Fl_Tree_Item::labelfont() const {
+  return(style_recs[_style].labelfont);
+}
+
+/// Set item's label font size.
+void Fl_Tree_Item::labelsize(Fl_Fontsize val) {
+  Fl_Tree_Item_Style style = style_recs[_style];
+  style.labelsize = val;
+  style_change(_style, style);
+  recalc_tree();              // may change tree geometry
+}
+
+/// Get item's label font size.
+Fl_Fontsize Fl_Tree_Item::labelsize() const {
+  return(style_recs[_style].labelsize);
+}
+
+/// Set item's label foreground text color.
+void Fl_Tree_Item::labelfgcolor(Fl_Color val) {
+  Fl_Tree_Item_Style style = style_recs[_style];
+  style.labelfgcolor = val;
+  style_change(_style, style);
+}
+
+/// Return item's label foreground text color.
+Fl_Color Fl_Tree_Item::labelfgcolor() const {
+  return(style_recs[_style].labelfgcolor);
+}
+
+/// Set item's label background color.
+/// A special case is made for color 0xffffffff which uses the parent tree's bg color.
+void Fl_Tree_Item::labelbgcolor(Fl_Color val) {
+  Fl_Tree_Item_Style style = style_recs[_style];
+  style.labelbgcolor = val;
+  style_change(_style, style);
+}
+
+/// Return item's label background text color.
+/// If the color is 0xffffffff, the default behavior is the parent tree's
+/// bg color will be used. (An overloaded draw_item_content() can override
+/// this behavior.)
+Fl_Color Fl_Tree_Item::labelbgcolor() const {
+  return(style_recs[_style].labelbgcolor);
+}
+
+/// Set the item's user icon to an Fl_Image. Use '0' to disable.
+/// No internal copy is made, caller must manage icon's memory.
+///
+/// Note, if you expect your items to be deactivated(),
+/// use userdeicon(Fl_Image*) to set up a 'grayed out' version of your icon
+/// to be used for display.
+///
+/// \see userdeicon(Fl_Image*)
+///
+void Fl_Tree_Item::usericon(Fl_Image *val) {
+  Fl_Tree_Item_Style style = style_recs[_style];
+  style.usericon = val;
+  style_change(_style, style);
+  recalc_tree();              // may change tree geometry
+}
+
+/// Get the item's user icon as an Fl_Image. Returns '0' if disabled.
+Fl_Image *Fl_Tree_Item::usericon() const {
+  return(style_recs[_style].usericon);
+}
+
+/// Set the usericon to draw when the item is deactivated. Use '0' to disable.
+/// No internal copy is made; caller must manage icon's memory.
+///
+/// To create a typical 'grayed out' version of your usericon image,
+/// you can do the following:
+///
+/// \code
+///      // Create tree + usericon for items
+///      Fl_Tree *tree = new Fl_Tree(..);
+///      Fl_Image *usr_icon = new Fl_Pixmap(..); // your usericon
+///      Fl_Image *de_icon  = usr_icon->copy();  // make a copy, and..
+///      de_icon->inactive();                    // make it 'grayed out'
+///      ...
+///      for ( .. ) {                 // item loop..
+///        item = tree->add("...");   // create new item
+///        item->usericon(usr_icon);  // assign usericon to items
+///        item->userdeicon(de_icon); // assign userdeicon to items
+///        ..
+///      }
+/// \endcode
+///
+/// In the above example, the app should 'delete' the two icons
+/// when they're no longer needed (e.g. after the tree is destroyed)
+///
+/// \version 1.3.4
+///
+void Fl_Tree_Item::userdeicon(Fl_Image* val) {
+  Fl_Tree_Item_Style style = style_recs[_style];
+  style.userdeicon = val;
+  style_change(_style, style);
+}
+
+/// Return the deactivated version of the user icon, if any.
+/// Returns 0 if none.
+Fl_Image* Fl_Tree_Item::userdeicon() const {
+  return(style_recs[_style].userdeicon);
+}
+
 /// Return const child item for the specified 'index'.
 const Fl_Tree_Item *Fl_Tree_Item::child(int index) const {
   return(_children[index]);
@@ -177,6 +571,87 @@ void Fl_Tree_Item::clear_children() {
   recalc_tree();                // may change tree geometry
 }
 
+// Count all of 'item's descendents
+static int count_descendents(const Fl_Tree_Item *item) {
+  int count = item->children();
+  for ( int t=0; t<item->children(); t++ )
+    count += count_descendents(item->child(t));
+  return(count);
+}
+
+// Set or clear the LOADED flag of 'item' and its descendents,
+//    returning how many items changed.
+//
+int Fl_Tree_Item::mark_loaded(int val) {
+  int count = 0;
+  if ( is_flag(LOADED) != (val ? 1 : 0) ) {
+    set_flag(LOADED, val);
+    count++;
+  }
+  for ( int t=0; t<children(); t++ )
+    count += _children[t]->mark_loaded(val);
+  return(count);
+}
+
+// Give 'item' and its descendents their own copy of labels stored in the
+//    tree's label arena, so the subtree survives the arena being freed.
+//
+void Fl_Tree_Item::unarena_labels() {
+  if ( is_flag(LABEL_IN_ARENA) ) {
+    _label = _label ? fl_strdup(_label) : 0;
+    set_flag(LABEL_IN_ARENA, 0);
+  }
+  for ( int t=0; t<children(); t++ )
+    _children[t]->unarena_labels();
+}
+
+/// Load this item's children now if they're not loaded yet.
+///
+/// Calls the tree's Fl_Tree::populate() to create the children, and
+/// clears children_unloaded(). Normally called automatically by open(),
+/// or by the tree right after an open item with unloaded children
+/// scrolled into view.
+///
+/// \returns the number of items created, or 0 if nothing was unloaded.
+/// \see children_unloaded(), unload_children()
+///
+int Fl_Tree_Item::load_children() {
+  if ( !_tree || !children_unloaded() ) return(0);
+  set_flag(UNLOADED, 0);                // clear first: populate() may add() to us
+  _tree->populate(this);
+  int count = 0;
+  for ( int t=0; t<children(); t++ )
+    count += _children[t]->mark_loaded(1);
+  if ( count ) {
+    set_flag(POPULATED, 1);
+    _tree->_loaded_items += count;
+  }
+  recalc_tree();                        // may change tree geometry
+  if ( count ) _tree->unload_later();   // not now: may unload our ancestors
+  return(count);
+}
+
+/// Destroy this item's children and mark them as unloaded again,
+/// so that they'll be recreated by Fl_Tree::populate() when needed.
+///
+/// Called by the tree when its unload_budget() is exceeded; widgets
+/// assigned to the destroyed items are not deleted.
+///
+/// \returns the number of items destroyed.
+/// \see children_unloaded(), load_children(), Fl_Tree::unload_budget()
+///
+int Fl_Tree_Item::unload_children() {
+  if ( !_tree ) return(0);
+  int count = count_descendents(this);  // loaded descendents uncount themselves
+  if ( is_flag(UNLOAD_QUEUED) ) {
+    _tree->_unload_queue.remove(this);
+  }
+  _flags &= ~(POPULATED|UNLOAD_QUEUED);
+  clear_children();                     // descendents leave the unload queue in their dtors
+  set_flag(UNLOADED, 1);
+  return(count);
+}
+
 /// Return the index of the immediate child of this item
 /// that has the label \p 'name'.
 ///
@@ -305,7 +780,9 @@ Fl_Tree_Item *Fl_Tree_Item::add(const Fl_Tree_Prefs &prefs,
                                 const char *new_label,
                                 Fl_Tree_Item *item) {
   if ( !item )
-    { item = new Fl_Tree_Item(_tree); item->label(new_label); }
+    { item = new(_tree) Fl_Tree_Item(_tree); item->label(new_label); }
+  else
+    { item->update_selection_r(1); }    // given item's selected items join the selection index
   recalc_tree();                // may change tree geometry
   item->_parent = this;
   switch ( prefs.sortorder() ) {
@@ -401,7 +878,7 @@ Fl_Tree_Item *Fl_Tree_Item::add(const Fl_Tree_Prefs &prefs,
 */
 Fl_Tree_Item *Fl_Tree_Item::insert(const Fl_Tree_Prefs &prefs, const char *new_label, int pos) {
   (void)prefs;                 // quiet warnings unused params
-  Fl_Tree_Item *item = new Fl_Tree_Item(_tree);
+  Fl_Tree_Item *item = new(_tree) Fl_Tree_Item(_tree);
   item->label(new_label);
   item->_parent = this;
   _children.insert(pos, item);
@@ -441,6 +918,13 @@ Fl_Tree_Item *Fl_Tree_Item::insert_above(const Fl_Tree_Prefs &prefs, const char
 Fl_Tree_Item* Fl_Tree_Item::deparent(int pos) {
   Fl_Tree_Item *orphan = _children[pos];
   if ( _children.deparent(pos) < 0 ) return NULL;
+  // The orphan is not in tree order anymore: leave the selection index
+  orphan->update_selection_r(0);
+  // Items moved out of a populated subtree are no longer unloaded with it
+  if ( _tree ) {
+    _tree->_loaded_items -= orphan->mark_loaded(0);
+    if ( _tree->_loaded_items < 0 ) _tree->_loaded_items = 0;
+  }
   return orphan;
 }
 
@@ -456,6 +940,7 @@ int Fl_Tree_Item::reparent(Fl_Tree_Item *newchild, int pos) {
   int ret;
   if ( (ret = _children.reparent(newchild, this, pos)) < 0 ) return ret;
   newchild->parent(this);               // take custody
+  newchild->update_selection_r(1);      // selected items rejoin the selection index
   return 0;
 }
 
@@ -631,6 +1116,7 @@ Fl_Tree_Item *Fl_Tree_Item::replace_child(Fl_Tree_Item *olditem,
   int pos = find_child(olditem);        // find our index for olditem
   if ( pos == -1 ) return(NULL);
   newitem->_parent = this;
+  newitem->update_selection_r(1);       // selected items join the selection index
   // replace in array (handles stitching neighboring items)
   _children.replace(pos, newitem);
   recalc_tree();                        // newitem may have changed tree geometry
@@ -813,15 +1299,16 @@ int Fl_Tree_Item::calc_item_height(const Fl_Tree_Prefs &prefs) const {
   if ( ! is_visible() ) return(0);
   int H = 0;
   if ( _label ) {
-    fl_font(_labelfont, _labelsize);    // fl_descent() needs this :/
-    H = _labelsize + fl_descent() + 1;  // at least one pixel space below descender
+    const Fl_Tree_Item_Style &style = style_recs[_style];
+    fl_font(style.labelfont, style.labelsize);  // fl_descent() needs this :/
+    H = style.labelsize + fl_descent() + 1;     // at least one pixel space below descender
   }
   if ( widget() &&
        (prefs.item_draw_mode() & FL_TREE_ITEM_HEIGHT_FROM_WIDGET) &&
        H < widget()->h()) {
     H = widget()->h();
   }
-  if ( has_children() && H < prefs.openicon_h() )
+  if ( (has_children() || children_unloaded()) && H < prefs.openicon_h() )
     H = prefs.openicon_h();
   if ( usericon() && H<usericon()->h() )
     H = usericon()->h();
@@ -835,9 +1322,10 @@ int Fl_Tree_Item::calc_item_height(const Fl_Tree_Prefs &prefs) const {
 /// \version 1.3.3 ABI ABI
 ///
 Fl_Color Fl_Tree_Item::drawfgcolor() const {
-  return is_selected() ? fl_contrast(_labelfgcolor, tree()->selection_color())
-                       : (is_active() && tree()->active_r()) ? _labelfgcolor
-                                                             : fl_inactive(_labelfgcolor);
+  Fl_Color fg = labelfgcolor();
+  return is_selected() ? fl_contrast(fg, tree()->selection_color())
+                       : (is_active() && tree()->active_r()) ? fg
+                                                             : fl_inactive(fg);
 }
 
 /// Returns the recommended background color used for drawing this item.
@@ -848,8 +1336,8 @@ Fl_Color Fl_Tree_Item::drawbgcolor() const {
   const Fl_Color unspecified = 0xffffffff;
   return is_selected() ? is_active() && tree()->active_r() ? tree()->selection_color()
                                                            : fl_inactive(tree()->selection_color())
-                       : _labelbgcolor == unspecified ? tree()->color()
-                                                      : _labelbgcolor;
+                       : labelbgcolor() == unspecified ? tree()->color()
+                                                       : labelbgcolor();
 }
 
 /// Draw the item content
@@ -941,10 +1429,10 @@ int Fl_Tree_Item::draw_item_content(int render) {
          (prefs.item_draw_mode() & FL_TREE_ITEM_DRAW_LABEL_AND_WIDGET) ) ) {
     if ( render ) {
       fl_color(fg);
-      fl_font(_labelfont, _labelsize);
+      fl_font(labelfont(), labelsize());
     }
     int lx = label_x()+(_label ? prefs.labelmarginleft() : 0);
-    int ly = label_y()+(label_h()/2)+(_labelsize/2)-fl_descent()/2;
+    int ly = label_y()+(label_h()/2)+(labelsize()/2)-fl_descent()/2;
     int lw=0, lh=0;
     fl_measure(_label, lw, lh);         // get box around text (including white space)
     if ( render ) fl_draw(_label, lx, ly);
@@ -1038,7 +1526,7 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
              ? widget()->h() : H;
     if ( _label &&
          (prefs.item_draw_mode() & FL_TREE_ITEM_DRAW_LABEL_AND_WIDGET) ) {
-      fl_font(_labelfont, _labelsize);  // fldescent() needs this
+      fl_font(labelfont(), labelsize());        // fldescent() needs this
       int lw=0, lh=0;
       fl_measure(_label,lw,lh);         // get box around text (including white space)
       wx += (lw + prefs.widgetmarginleft());
@@ -1075,7 +1563,7 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
           }
         }
         // Draw collapse icon
-        if ( render && has_children() && prefs.showcollapse() ) {
+        if ( render && (has_children() || children_unloaded()) && prefs.showcollapse() ) {
           // Draw icon image
           if ( is_open() ) {
             if ( prefs.closeicon() ) {
@@ -1130,6 +1618,13 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
   // Manage tree_item_xmax
   if ( xmax > tree_item_xmax )
     tree_item_xmax = xmax;
+  // Virtual tree: an open item whose children aren't loaded yet
+  //     loads them as soon as the item scrolls into view.
+  //
+  if ( is_open() && children_unloaded() && _tree &&
+       (_xywh[1]+H) >= tree_top && _xywh[1] <= tree_bot ) {
+    _tree->populate_later(this);
+  }
   // Draw child items (if any)
   if ( has_children() && is_open() ) {
     int child_x = drawthis ? (hconn_x_center - (icon_w/2) + 1)  // offset children to right,
@@ -1180,7 +1675,7 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
 /// Was the event on the 'collapse' button of this item?
 ///
 int Fl_Tree_Item::event_on_collapse_icon(const Fl_Tree_Prefs &prefs) const {
-  if ( is_visible() && is_active() && has_children() && prefs.showcollapse() ) {
+  if ( is_visible() && is_active() && (has_children() || children_unloaded()) && prefs.showcollapse() ) {
     return(event_inside(_collapse_xywh) ? 1 : 0);
   } else {
     return(0);
@@ -1251,7 +1746,13 @@ void Fl_Tree_Item::hide_widgets() {
 }
 
 /// Open this item and all its children.
+/// If the item's children are not loaded yet, they're loaded first.
 void Fl_Tree_Item::open() {
+  if ( children_unloaded() ) load_children();   // virtual tree: create children on demand
+  if ( is_flag(UNLOAD_QUEUED) ) {               // reopened before being unloaded?
+    _tree->_unload_queue.remove(this);
+    _flags &= ~UNLOAD_QUEUED;
+  }
   set_flag(OPEN,1);
   // Tell children to show() their widgets
   for ( int t=0; t<_children.total(); t++ ) {
@@ -1261,6 +1762,8 @@ void Fl_Tree_Item::open() {
 }
 
 /// Close this item and all its children.
+/// If the children were created by Fl_Tree::populate(), they become
+/// candidates for unloading when the tree's unload_budget() is exceeded.
 void Fl_Tree_Item::close() {
   set_flag(OPEN,0);
   // Tell children to hide() their widgets
@@ -1268,6 +1771,11 @@ void Fl_Tree_Item::close() {
     _children[t]->hide_widgets();
   }
   recalc_tree();                // may change tree geometry
+  if ( _tree && is_flag(POPULATED) && !is_flag(UNLOAD_QUEUED) ) {
+    _flags |= UNLOAD_QUEUED;
+    _tree->_unload_queue.add(this);
+    _tree->unload_later();              // not now: may unload us or our ancestors
+  }
 }
 
 /// Returns how many levels deep this item is in the hierarchy.
@@ -1392,6 +1900,34 @@ void Fl_Tree_Item::update_prev_next(int index) {
   // Adjust neighbors to point to us
   if ( item_prev ) item_prev->_next_sibling = this;
   if ( item_next ) item_next->_prev_sibling = this;
+  // Tree order changed: renumber before next ordered selection query
+  if ( _tree ) _tree->_order_valid = _tree->_prefix_valid = 0;
+}
+
+// Internal: Our OPEN or VISIBLE flag changed; update which of our
+//    descendants the tree's label index considers displayed.
+//
+void Fl_Tree_Item::update_displayed() {
+  if ( _tree ) _tree->prefix_index_display(this);
+}
+
+// Internal: Add/remove ourself to/from the tree's selection index.
+//    Called by set_flag() just before the SELECTED flag changes to 'val'.
+//
+void Fl_Tree_Item::update_selection(int val) {
+  if ( !_tree ) return;
+  if ( val ) _tree->selection_add(this);
+  else       _tree->selection_remove(this);
+}
+
+// Internal: Add/remove our selected descendants and ourself to/from the
+//    tree's selection index, keeping their SELECTED flags.
+//    Used when a subtree is orphaned or reparented.
+//
+void Fl_Tree_Item::update_selection_r(int val) {
+  if ( is_selected() ) update_selection(val);
+  for ( int t=0; t<_children.total(); t++ )
+    _children[t]->update_selection_r(val);
 }
 
 /// Return the next open(), visible() item.
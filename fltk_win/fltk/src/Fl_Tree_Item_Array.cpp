@@ -27,8 +27,10 @@
 
 /// Constructor; creates an empty array.
 ///
-///     The optional 'chunksize' can be specified to optimize
-///     memory allocation for potentially large arrays. Default chunksize is 10.
+///     The optional 'chunksize' is the minimum number of items the array
+///     grows by. Beyond that the allocation doubles, so appending is amortized
+///     O(1) however large the array gets. Default chunksize is 10.
+///     Use reserve() when the final size is known in advance.
 ///
 Fl_Tree_Item_Array::Fl_Tree_Item_Array(int new_chunksize) {
   _items     = 0;
@@ -84,26 +86,33 @@ void Fl_Tree_Item_Array::clear() {
 // Internal: Enlarge the items array.
 //
 //    Adjusts size/items memory allocation as needed.
+//    Grows geometrically (doubling, but at least by chunksize)
+//    so repeated appends don't reallocate and copy each time.
 //    Does NOT change total.
 //
 void Fl_Tree_Item_Array::enlarge(int count) {
   int newtotal = _total + count;        // new total
-  if ( newtotal >= _size ) {            // more than we have allocated?
-    if ( (newtotal/150) > _chunksize ) _chunksize *= 10;
-    // Increase size of array
-    int newsize = _size + _chunksize;
-    Fl_Tree_Item **newitems = (Fl_Tree_Item**)malloc(newsize * sizeof(Fl_Tree_Item*));
-    if ( _items ) {
-      // Copy old array -> new, delete old
-      memmove(newitems, _items, _size * sizeof(Fl_Tree_Item*));
-      free((void*)_items); _items = 0;
-    }
-    // Adjust items/sizeitems
-    _items = newitems;
-    _size = newsize;
+  if ( newtotal > _size ) {             // more than we have allocated?
+    int newsize = _size * 2;
+    if ( newsize < _size + _chunksize ) newsize = _size + _chunksize;
+    if ( newsize < newtotal ) newsize = newtotal;
+    reserve(newsize);
   }
 }
 
+/// Make sure the array has room for at least \p 'count' items
+/// without reallocating.
+///
+///     Use this before adding many items at once, e.g. when populating
+///     a directory whose number of entries is known.
+///     Never shrinks the array; total() is unchanged.
+///
+void Fl_Tree_Item_Array::reserve(int count) {
+  if ( count <= _size ) return;
+  _items = (Fl_Tree_Item**)realloc((void*)_items, count * sizeof(Fl_Tree_Item*));
+  _size  = count;
+}
+
 /// Insert an item at index position \p pos.
 ///
 ///     Handles enlarging array if needed, total increased by 1.
@@ -0,0 +1,365 @@
+//
+// Background worker threads for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "Fl_Worker_Pool.h"
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+// Platform data of a pool
+struct Fl_Worker_Pool_Sys {
+  CRITICAL_SECTION lock;        // protects the queue and counters
+  HANDLE sem;                   // counts jobs submitted to the threads
+  HANDLE idle;                  // manual reset: set if nothing queued or running
+  HANDLE *threads;
+  int live;                     // #threads not exited yet (once detached)
+};
+
+// A result handed to the main thread by awake()
+struct Fl_Worker_Result {
+  Fl_Awake_Handler cb;
+  void *data;
+  Fl_Worker_Result *next;
+};
+
+// Results not delivered yet, oldest first, shared by all pools
+static CRITICAL_SECTION result_lock;
+static Fl_Worker_Result *result_first = 0;
+static Fl_Worker_Result *result_last = 0;
+static int result_init = 0;
+
+#define SYS ((Fl_Worker_Pool_Sys*)sys_)
+#define LOCK() EnterCriticalSection(&SYS->lock)
+#define UNLOCK() LeaveCriticalSection(&SYS->lock)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif // _WIN32
+
+static const int MAX_THREADS = 16;
+
+/**
+  Create a pool with \p nthreads worker threads.
+  Zero (the default) uses one thread per processor.
+*/
+Fl_Worker_Pool::Fl_Worker_Pool(int nthreads) {
+  job_ = 0;
+  data_ = 0;
+  head_ = count_ = alloc_ = 0;
+  running_ = 0;
+  stop_ = 0;
+  sys_ = 0;
+#ifdef _WIN32
+  if (nthreads <= 0) {
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    nthreads = (int)si.dwNumberOfProcessors;
+  }
+  if (nthreads < 1) nthreads = 1;
+  if (nthreads > MAX_THREADS) nthreads = MAX_THREADS;
+  Fl_Worker_Pool_Sys *sys = (Fl_Worker_Pool_Sys*)malloc(sizeof(Fl_Worker_Pool_Sys));
+  InitializeCriticalSection(&sys->lock);
+  sys->sem = CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+  sys->idle = CreateEvent(NULL, TRUE, TRUE, NULL);
+  sys->threads = (HANDLE*)malloc(nthreads * sizeof(HANDLE));
+  sys_ = sys;
+  if (!result_init) {                           // before any thread can deliver
+    InitializeCriticalSection(&result_lock);
+    Fl::add_check(deliver_cb);                  // in case Fl::awake()'s queue was full
+    result_init = 1;
+  }
+  nthreads_ = 0;
+  for (int t = 0; t < nthreads; t++) {
+    HANDLE h = CreateThread(NULL, 0, thread_main, this, 0, NULL);
+    if (h) sys->threads[nthreads_++] = h;
+  }
+  sys->live = nthreads_;
+#else
+  (void)nthreads;
+  nthreads_ = 0;                // jobs run in the main thread
+#endif // _WIN32
+}
+
+/**
+  Destroy the pool.
+  Jobs still queued are discarded (callers should cancel() their own
+  jobs first to free their data); running jobs are waited for.
+  Use detach() instead to not block the main thread.
+*/
+Fl_Worker_Pool::~Fl_Worker_Pool() {
+#ifdef _WIN32
+  if (stop_ != 2) {                             // not detached: stop the threads
+    LOCK();
+    stop_ = 1;
+    count_ = 0;
+    UNLOCK();
+    ReleaseSemaphore(SYS->sem, nthreads_, NULL);
+    for (int t = 0; t < nthreads_; t++)
+      WaitForSingleObject(SYS->threads[t], INFINITE);
+  }
+  for (int t = 0; t < nthreads_; t++)
+    CloseHandle(SYS->threads[t]);
+  CloseHandle(SYS->sem);
+  CloseHandle(SYS->idle);
+  DeleteCriticalSection(&SYS->lock);
+  free(SYS->threads);
+  free(sys_);
+#else
+  Fl::remove_timeout(run_cb, this);
+#endif // _WIN32
+  if (job_) free(job_);
+  if (data_) free(data_);
+}
+
+/**
+  Return a pool shared by all widgets, created on first use.
+  The shared pool lives until the program exits.
+*/
+Fl_Worker_Pool *Fl_Worker_Pool::shared() {
+  static Fl_Worker_Pool *pool = 0;
+  if (!pool) pool = new Fl_Worker_Pool();
+  return pool;
+}
+
+/**
+  Take the oldest job from the queue.
+  Private: must be called with the lock held. Returns 0 if none.
+*/
+int Fl_Worker_Pool::pop(Fl_Worker_Job &job, void *&data) {
+  if (count_ == 0) return 0;
+  job = job_[head_];
+  data = data_[head_];
+  head_ = (head_ + 1) % alloc_;
+  count_--;
+  return 1;
+}
+
+/**
+  Queue \p job to be run with \p data on a worker thread.
+  Jobs are started in the order they were submitted.
+*/
+void Fl_Worker_Pool::submit(Fl_Worker_Job job, void *data) {
+  LOCK();
+  if (count_ == alloc_) {                       // grow the ring, oldest first
+    int newalloc = alloc_ ? alloc_ * 2 : 16;
+    Fl_Worker_Job *newjob = (Fl_Worker_Job*)malloc(newalloc * sizeof(Fl_Worker_Job));
+    void **newdata = (void**)malloc(newalloc * sizeof(void*));
+    for (int t = 0; t < count_; t++) {
+      newjob[t] = job_[(head_ + t) % alloc_];
+      newdata[t] = data_[(head_ + t) % alloc_];
+    }
+    if (job_) free(job_);
+    if (data_) free(data_);
+    job_ = newjob;
+    data_ = newdata;
+    head_ = 0;
+    alloc_ = newalloc;
+  }
+  int slot = (head_ + count_) % alloc_;
+  job_[slot] = job;
+  data_[slot] = data;
+  count_++;
+#ifdef _WIN32
+  ResetEvent(SYS->idle);
+  UNLOCK();
+  ReleaseSemaphore(SYS->sem, 1, NULL);
+#else
+  if (!Fl::has_timeout(run_cb, this))
+    Fl::add_timeout(0.0, run_cb, this);
+#endif // _WIN32
+}
+
+/**
+  Remove all queued jobs whose data is \p data.
+  Jobs already running are not affected.
+  \returns the number of jobs removed; their data is up to the caller
+*/
+int Fl_Worker_Pool::cancel(void *data) {
+  int removed = 0;
+  LOCK();
+  int kept = 0;
+  for (int t = 0; t < count_; t++) {
+    int from = (head_ + t) % alloc_;
+    if (data_[from] == data) { removed++; continue; }
+    int to = (head_ + kept) % alloc_;
+    job_[to] = job_[from];
+    data_[to] = data_[from];
+    kept++;
+  }
+  count_ = kept;
+#ifdef _WIN32
+  if (count_ == 0 && running_ == 0) SetEvent(SYS->idle);
+#endif
+  UNLOCK();
+  return removed;
+}
+
+/**
+  Wait until all submitted jobs have finished.
+  Must not be called from a job.
+*/
+void Fl_Worker_Pool::wait() {
+#ifdef _WIN32
+  for (;;) {
+    LOCK();
+    int busy = count_ || running_;
+    UNLOCK();
+    if (!busy) return;
+    WaitForSingleObject(SYS->idle, INFINITE);
+  }
+#else
+  Fl_Worker_Job job;
+  void *data;
+  while (pop(job, data))                        // run the rest right now
+    job(data);
+#endif // _WIN32
+}
+
+/**
+  Delete the pool without waiting for its running jobs.
+  Jobs still queued are discarded, as for the destructor; the pool is
+  deleted by its last thread once the running jobs have finished.
+  Their results are still delivered, so callers must keep the data the
+  jobs use until then. The pool must not be used after this call.
+*/
+void Fl_Worker_Pool::detach() {
+#ifdef _WIN32
+  LOCK();
+  stop_ = 2;
+  count_ = 0;
+  if (SYS->live == 0) {                         // no thread could be started
+    UNLOCK();
+    delete this;
+    return;
+  }
+  ReleaseSemaphore(SYS->sem, nthreads_, NULL);  // threads exit once we unlock
+  UNLOCK();
+#else
+  delete this;
+#endif // _WIN32
+}
+
+/**
+  Call \p cb with \p data in the main thread, holding the FLTK lock.
+  Use this from a job to deliver its results. Results are queued and
+  delivered in order by a single Fl::awake() callback, so unlike
+  Fl::awake() this never drops a result and never waits for the main
+  thread, even when the awake queue is full.
+*/
+void Fl_Worker_Pool::awake(Fl_Awake_Handler cb, void *data) {
+#ifdef _WIN32
+  Fl_Worker_Result *r = (Fl_Worker_Result*)malloc(sizeof(Fl_Worker_Result));
+  r->cb = cb;
+  r->data = data;
+  r->next = 0;
+  EnterCriticalSection(&result_lock);
+  int first = (result_first == 0);
+  if (result_last) result_last->next = r;
+  else result_first = r;
+  result_last = r;
+  LeaveCriticalSection(&result_lock);
+  if (first)                                    // one post per batch; if the awake
+    Fl::awake(deliver_cb, 0);                   // queue is full the check delivers
+#else
+  Fl::add_timeout(0.0, cb, data);
+#endif // _WIN32
+}
+
+#ifdef _WIN32
+
+/**
+  Main loop of a worker thread.
+  Private: runs queued jobs until the pool is destroyed.
+*/
+unsigned long __stdcall Fl_Worker_Pool::thread_main(void *v) {
+  Fl_Worker_Pool *pool = (Fl_Worker_Pool*)v;
+  Fl_Worker_Pool_Sys *sys = (Fl_Worker_Pool_Sys*)pool->sys_;
+  for (;;) {
+    WaitForSingleObject(sys->sem, INFINITE);
+    EnterCriticalSection(&sys->lock);
+    if (pool->stop_) {
+      int last = (pool->stop_ == 2 && --sys->live == 0);
+      LeaveCriticalSection(&sys->lock);
+      if (last) delete pool;                    // detached: last thread cleans up
+      break;
+    }
+    Fl_Worker_Job job;
+    void *data;
+    if (!pool->pop(job, data)) {                // cancelled meanwhile
+      LeaveCriticalSection(&sys->lock);
+      continue;
+    }
+    pool->running_++;
+    LeaveCriticalSection(&sys->lock);
+    job(data);
+    EnterCriticalSection(&sys->lock);
+    pool->running_--;
+    if (pool->running_ == 0 && pool->count_ == 0) SetEvent(sys->idle);
+    LeaveCriticalSection(&sys->lock);
+  }
+  return 0;
+}
+
+/**
+  Call the results queued by awake(), in order.
+  Private: runs in the main thread from Fl::awake() and as a check.
+*/
+void Fl_Worker_Pool::deliver_cb(void *) {
+  EnterCriticalSection(&result_lock);
+  Fl_Worker_Result *r = result_first;
+  result_first = result_last = 0;
+  LeaveCriticalSection(&result_lock);
+  while (r) {
+    Fl_Worker_Result *next = r->next;
+    Fl_Awake_Handler cb = r->cb;
+    void *data = r->data;
+    free(r);
+    cb(data);
+    r = next;
+  }
+}
+
+#else
+
+/**
+  Timeout callback running one queued job in the main thread.
+  Private: used on platforms without worker threads.
+*/
+void Fl_Worker_Pool::run_cb(void *v) {
+  Fl_Worker_Pool *pool = (Fl_Worker_Pool*)v;
+  Fl_Worker_Job job;
+  void *data;
+  if (!pool->pop(job, data)) return;
+  pool->running_++;
+  job(data);
+  pool->running_--;
+  if (pool->count_ && !Fl::has_timeout(run_cb, pool))
+    Fl::add_timeout(0.0, run_cb, pool);
+}
+
+#endif // _WIN32
+
+/**
+ \}
+ \endcond
+ */
@@ -0,0 +1,99 @@
+//
+// Background worker threads for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2023 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#ifndef Fl_Worker_Pool_H
+#define Fl_Worker_Pool_H
+
+/**
+ \cond DriverDev
+ \addtogroup DriverDeveloper
+ \{
+ */
+
+#include "../hdr/Fl_Export.h"
+#include "../hdr/Fl.h"
+
+/** \file src/Fl_Worker_Pool.h
+  A small pool of worker threads running queued jobs.
+*/
+
+/** A job run by Fl_Worker_Pool; \p data is the pointer given to submit(). */
+typedef void (*Fl_Worker_Job)(void *data);
+
+/**
+  A pool of worker threads running queued jobs in FIFO order.
+
+  Widgets use this to move slow work (reading files, decoding images,
+  fetching data) off the main thread. A job must not call FLTK
+  functions other than Fl::awake(); it hands its results back to the
+  main thread with Fl_Worker_Pool::awake(), which calls a handler with
+  the FLTK lock held. Results are queued and delivered in order, so a
+  job never waits for the main thread.
+
+  The main thread never needs to wait for a job either: a widget going
+  away cancels its queued jobs and detach()es its pool, which then
+  deletes itself once the running jobs have finished.
+
+  As for all threaded FLTK programs, the application must call Fl::lock()
+  before Fl::run() for results to be delivered promptly.
+
+  On platforms without thread support in this file the jobs are run one
+  by one from timeouts in the main thread, so callers need not care.
+
+  \note This class is only for internal use by FLTK widgets.
+*/
+class FL_EXPORT Fl_Worker_Pool {
+  Fl_Worker_Job *job_;          // ring buffer of queued jobs..
+  void **data_;                 // ..and their data
+  int head_;                    // index of the oldest queued job
+  int count_;                   // #jobs queued
+  int alloc_;                   // #jobs allocated
+  int running_;                 // #jobs being run
+  int nthreads_;                // #worker threads
+  int stop_;                    // 1: the pool is being destroyed, 2: detached
+  void *sys_;                   // platform specific data
+  int pop(Fl_Worker_Job &job, void *&data);
+#ifdef _WIN32
+  static unsigned long __stdcall thread_main(void *v);
+  static void deliver_cb(void *v);
+#else
+  static void run_cb(void *v);
+#endif
+  Fl_Worker_Pool(const Fl_Worker_Pool&);        // not copyable
+  Fl_Worker_Pool& operator=(const Fl_Worker_Pool&);
+
+public:
+  Fl_Worker_Pool(int nthreads = 0);
+  ~Fl_Worker_Pool();
+  static Fl_Worker_Pool *shared();
+
+  /** Return the number of worker threads. */
+  int threads() const {
+    return nthreads_;
+  }
+  void submit(Fl_Worker_Job job, void *data);
+  int cancel(void *data);
+  void wait();
+  void detach();
+  static void awake(Fl_Awake_Handler cb, void *data);
+};
+
+/**
+ \}
+ \endcond
+ */
+
+#endif // Fl_Worker_Pool_H